@@ -44,6 +44,12 @@ android {
             isMinifyEnabled = false
             enableUnitTestCoverage = true
             enableAndroidTestCoverage = true
+
+            externalNativeBuild {
+                cmake {
+                    arguments += "-DWALLET_TEST_NODES=ON"
+                }
+            }
         }
 
         getByName("release") {
@@ -77,6 +83,11 @@ android {
         buildConfig = true
     }
 
+    androidResources {
+        // Block time tables are mapped straight from the APK.
+        noCompress += "mbtt"
+    }
+
     packaging {
         resources {
             excludes += "/META-INF/{AL2.0,LGPL2.1}"
@@ -68,4 +68,24 @@ class NativeWalletTest {
             assertThat(isBalanceZero).isTrue()
         }
     }
+
+    @Test
+    fun statsReportSampledLockSites() = runTest {
+        val wallet = NativeWallet.localSyncWallet(
+            networkId = Mainnet.id,
+            secretSpendKey = randomSecretKey(),
+        )
+
+        NativeLockProfiler.setSamplePeriod(1)
+        try {
+            wallet.getBalance()
+        } finally {
+            NativeLockProfiler.setSamplePeriod(0)
+        }
+
+        val stats = wallet.dumpStats().lines()
+        assertThat(stats.any { it.startsWith("lock.tx_history.queryBalance.wait count=") }).isTrue()
+        assertThat(stats.any { it.startsWith("lock.tx_history.queryBalance.hold count=") }).isTrue()
+        assertThat(stats.any { it.startsWith("transport.bytes_sent ") }).isTrue()
+    }
 }
@@ -0,0 +1,113 @@
+package im.molly.monero.sdk.internal
+
+import android.os.ParcelFileDescriptor
+import com.google.common.truth.Truth.assertThat
+import im.molly.monero.sdk.Mainnet
+import im.molly.monero.sdk.MoneroNodeClient
+import im.molly.monero.sdk.RemoteNode
+import im.molly.monero.sdk.singleNodeClient
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeout
+import org.junit.After
+import org.junit.Before
+import org.junit.Test
+import java.io.ByteArrayOutputStream
+import java.net.InetAddress
+import java.net.ServerSocket
+import java.util.zip.GZIPInputStream
+import java.util.zip.GZIPOutputStream
+import kotlin.concurrent.thread
+import kotlin.time.Duration.Companion.seconds
+
+class RpcClientContentEncodingTest {
+
+    private val payload = ByteArray(64 * 1024) { (it % 7).toByte() }
+
+    private val gzippedPayload = ByteArrayOutputStream().also { out ->
+        GZIPOutputStream(out).use { it.write(payload) }
+    }.toByteArray()
+
+    /** Answers every request with the gzipped payload. */
+    private lateinit var gzipServer: ServerSocket
+
+    private lateinit var nodeClient: MoneroNodeClient
+
+    @Before
+    fun setUp() {
+        gzipServer = ServerSocket(0, 0, InetAddress.getLoopbackAddress())
+        thread(isDaemon = true) {
+            runCatching {
+                while (true) {
+                    gzipServer.accept().use { socket ->
+                        val input = socket.getInputStream().bufferedReader()
+                        while (input.readLine().isNotEmpty()) continue
+                        val out = socket.getOutputStream()
+                        out.write(
+                            ("HTTP/1.1 200 OK\r\n" +
+                                    "Content-Type: application/octet-stream\r\n" +
+                                    "Content-Encoding: gzip\r\n" +
+                                    "Content-Length: ${gzippedPayload.size}\r\n" +
+                                    "Connection: close\r\n\r\n").toByteArray()
+                        )
+                        out.write(gzippedPayload)
+                        out.flush()
+                    }
+                }
+            }
+        }
+        val node = RemoteNode("http://127.0.0.1:${gzipServer.localPort}", Mainnet)
+        nodeClient = node.singleNodeClient()
+    }
+
+    @After
+    fun tearDown() {
+        nodeClient.close()
+        gzipServer.close()
+    }
+
+    private class ResultCallback : IHttpRequestCallback.Stub() {
+        val result = CompletableDeferred<Pair<HttpResponse, ByteArray>?>()
+
+        override fun onResponse(response: HttpResponse) {
+            val body = response.body?.let { fd ->
+                ParcelFileDescriptor.AutoCloseInputStream(fd).use { it.readBytes() }
+            } ?: ByteArray(0)
+            result.complete(response to body)
+        }
+
+        override fun onError() {
+            result.complete(null)
+        }
+
+        override fun onRequestCanceled() {
+            result.complete(null)
+        }
+    }
+
+    private suspend fun call(header: String?): Pair<HttpResponse, ByteArray> {
+        val callback = ResultCallback()
+        val request = HttpRequest("GET", "/get_info", header, null, 0)
+        nodeClient.httpRpcClient.callAsync(request, callback, 1)
+        val result = withTimeout(10.seconds) { callback.result.await() }
+        assertThat(result).isNotNull()
+        return result!!
+    }
+
+    @Test
+    fun acceptEncodingPassesCompressedBodyThrough() = runBlocking {
+        val (response, body) = call("Accept-Encoding: gzip, deflate\r\n")
+
+        assertThat(response.contentEncoding).isEqualTo("gzip")
+        assertThat(body).isEqualTo(gzippedPayload)
+        assertThat(GZIPInputStream(body.inputStream()).readBytes()).isEqualTo(payload)
+    }
+
+    @Test
+    fun withoutAcceptEncodingBodyIsDecoded() = runBlocking {
+        val (response, body) = call(null)
+
+        assertThat(response.contentEncoding).isNull()
+        assertThat(body).isEqualTo(payload)
+    }
+}
@@ -0,0 +1,114 @@
+package im.molly.monero.sdk.internal
+
+import com.google.common.truth.Truth.assertThat
+import im.molly.monero.sdk.Mainnet
+import im.molly.monero.sdk.MoneroNodeClient
+import im.molly.monero.sdk.RemoteNode
+import im.molly.monero.sdk.singleNodeClient
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeout
+import org.junit.After
+import org.junit.Before
+import org.junit.Test
+import java.io.IOException
+import java.net.InetAddress
+import java.net.ServerSocket
+import java.net.Socket
+import java.net.SocketTimeoutException
+import java.util.concurrent.LinkedBlockingQueue
+import java.util.concurrent.TimeUnit
+import kotlin.concurrent.thread
+import kotlin.time.Duration.Companion.seconds
+
+class RpcClientTimeoutTest {
+
+    /** Accepts connections and never answers. */
+    private lateinit var stallingServer: ServerSocket
+
+    private val acceptedSockets = LinkedBlockingQueue<Socket>()
+
+    private lateinit var nodeClient: MoneroNodeClient
+
+    @Before
+    fun setUp() {
+        stallingServer = ServerSocket(0, 0, InetAddress.getLoopbackAddress())
+        thread(isDaemon = true) {
+            runCatching {
+                while (true) {
+                    acceptedSockets.add(stallingServer.accept())
+                }
+            }
+        }
+        val node = RemoteNode("http://127.0.0.1:${stallingServer.localPort}", Mainnet)
+        nodeClient = node.singleNodeClient()
+    }
+
+    @After
+    fun tearDown() {
+        nodeClient.close()
+        stallingServer.close()
+        acceptedSockets.forEach { it.close() }
+    }
+
+    private fun request(timeoutMillis: Long) =
+        HttpRequest("POST", "/getblocks.bin", null, ByteArray(0), timeoutMillis)
+
+    private class ResultCallback : IHttpRequestCallback.Stub() {
+        val result = CompletableDeferred<HttpResponse?>()
+        var canceled = false
+
+        override fun onResponse(response: HttpResponse) {
+            result.complete(response)
+        }
+
+        override fun onError() {
+            result.complete(null)
+        }
+
+        override fun onRequestCanceled() {
+            canceled = true
+            result.complete(null)
+        }
+    }
+
+    @Test
+    fun stalledCallReportsTimeout() = runBlocking {
+        val callback = ResultCallback()
+
+        nodeClient.httpRpcClient.callAsync(request(timeoutMillis = 500), callback, 1)
+
+        val response = withTimeout(10.seconds) { callback.result.await() }
+        assertThat(response?.code).isEqualTo(HttpResponse.CODE_TIMEOUT)
+    }
+
+    @Test
+    fun canceledCallAbortsConnection() = runBlocking {
+        val callback = ResultCallback()
+
+        nodeClient.httpRpcClient.callAsync(request(timeoutMillis = 0), callback, 1)
+        val socket = withTimeout(10.seconds) {
+            acceptedSockets.poll(10, TimeUnit.SECONDS)
+        }
+        assertThat(socket).isNotNull()
+
+        nodeClient.httpRpcClient.cancelAsync(1)
+
+        withTimeout(10.seconds) { callback.result.await() }
+        assertThat(callback.canceled).isTrue()
+
+        // Drain the request and expect the client to have closed its end.
+        socket!!.soTimeout = 10_000
+        val input = socket.getInputStream()
+        val buffer = ByteArray(4096)
+        val closedByClient = try {
+            while (input.read(buffer) >= 0) continue
+            true
+        } catch (e: SocketTimeoutException) {
+            false
+        } catch (e: IOException) {
+            true
+        }
+        assertThat(closedByClient).isTrue()
+    }
+}
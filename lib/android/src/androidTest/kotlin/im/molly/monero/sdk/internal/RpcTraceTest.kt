@@ -0,0 +1,140 @@
+package im.molly.monero.sdk.internal
+
+import com.google.common.truth.Truth.assertThat
+import im.molly.monero.sdk.BlockchainTime
+import im.molly.monero.sdk.Mainnet
+import im.molly.monero.sdk.MoneroNodeClient
+import im.molly.monero.sdk.RemoteNode
+import im.molly.monero.sdk.randomSecretKey
+import im.molly.monero.sdk.singleNodeClient
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeout
+import org.junit.After
+import org.junit.Before
+import org.junit.Test
+import java.io.File
+import java.net.InetAddress
+import java.net.ServerSocket
+import java.util.concurrent.atomic.AtomicInteger
+import kotlin.concurrent.thread
+import kotlin.time.Duration.Companion.seconds
+
+class RpcTraceTest {
+
+    /** Stand-in node answering every JSON-RPC call with the same canned result. */
+    private lateinit var nodeServer: ServerSocket
+
+    private val requestCount = AtomicInteger()
+
+    private lateinit var nodeClient: MoneroNodeClient
+
+    // Holds the fields of both get_info and get_fee_estimate, whichever wallet2 asks for.
+    private val cannedResponse = """
+        {
+          "jsonrpc": "2.0",
+          "id": "0",
+          "result": {
+            "status": "OK",
+            "untrusted": false,
+            "height": 3000000,
+            "target_height": 0,
+            "fee": 20000,
+            "fees": [20000, 80000, 320000, 4000000],
+            "quantization_mask": 10000
+          }
+        }
+    """.trimIndent()
+
+    @Before
+    fun setUp() {
+        nodeServer = ServerSocket(0, 0, InetAddress.getLoopbackAddress())
+        thread(isDaemon = true) {
+            runCatching {
+                while (true) {
+                    nodeServer.accept().use { socket ->
+                        val input = socket.getInputStream().bufferedReader()
+                        input.readLine()
+                        var contentLength = 0
+                        while (true) {
+                            val line = input.readLine()
+                            if (line.isEmpty()) break
+                            if (line.startsWith("Content-Length:", ignoreCase = true)) {
+                                contentLength = line.substringAfter(":").trim().toInt()
+                            }
+                        }
+                        input.read(CharArray(contentLength))
+                        requestCount.incrementAndGet()
+                        val response = cannedResponse.toByteArray()
+                        val out = socket.getOutputStream()
+                        out.write(
+                            ("HTTP/1.1 200 OK\r\n" +
+                                    "Content-Type: application/json\r\n" +
+                                    "Content-Length: ${response.size}\r\n" +
+                                    "Connection: close\r\n\r\n").toByteArray()
+                        )
+                        out.write(response)
+                        out.flush()
+                    }
+                }
+            }
+        }
+        val node = RemoteNode("http://127.0.0.1:${nodeServer.localPort}", Mainnet)
+        nodeClient = node.singleNodeClient()
+    }
+
+    @After
+    fun tearDown() {
+        nodeClient.close()
+        nodeServer.close()
+    }
+
+    @Test
+    fun recordedCallsReplayWithoutNode() = runBlocking {
+        val secretSpendKey = randomSecretKey()
+        val trace = File.createTempFile("rpc", ".trace")
+
+        suspend fun requestFees(): List<Long>? {
+            val wallet = NativeWallet.localSyncWallet(
+                networkId = Mainnet.id,
+                rpcClient = nodeClient.httpRpcClient,
+                secretSpendKey = secretSpendKey,
+                restorePoint = 0,
+            )
+            val result = CompletableDeferred<List<Long>?>()
+            wallet.requestFees(object : IWalletCallbacks.Stub() {
+                override fun onFeesReceived(fees: LongArray?) {
+                    result.complete(fees?.toList())
+                }
+
+                override fun onRefreshResult(blockchainTime: BlockchainTime, status: Int) {}
+                override fun onCommitResult(success: Boolean) {}
+                override fun onSubAddressReady(subAddress: String?) {}
+                override fun onSubAddressListReceived(subAddresses: Array<out String>?) {}
+                override fun onAccountNotFound(accountIndex: Int) {}
+            })
+            return withTimeout(30.seconds) { result.await() }.also { wallet.close() }
+        }
+
+        try {
+            assertThat(NativeRpcTrace.startRecording(trace)).isTrue()
+            val recorded = requestFees()
+            assertThat(NativeRpcTrace.stop()).isTrue()
+
+            assertThat(recorded).isNotEmpty()
+            assertThat(requestCount.get()).isGreaterThan(0)
+
+            nodeServer.close()
+            requestCount.set(0)
+
+            assertThat(NativeRpcTrace.startReplay(trace)).isTrue()
+            val replayed = requestFees()
+
+            assertThat(replayed).isEqualTo(recorded)
+            assertThat(requestCount.get()).isEqualTo(0)
+        } finally {
+            NativeRpcTrace.stop()
+            trace.delete()
+        }
+    }
+}
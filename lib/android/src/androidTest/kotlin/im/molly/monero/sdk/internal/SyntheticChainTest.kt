@@ -0,0 +1,220 @@
+package im.molly.monero.sdk.internal
+
+import androidx.test.filters.LargeTest
+import com.google.common.truth.Truth.assertThat
+import im.molly.monero.sdk.BlockchainTime
+import im.molly.monero.sdk.HistoryQuery
+import im.molly.monero.sdk.Stagenet
+import im.molly.monero.sdk.randomSecretKey
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeout
+import org.junit.After
+import org.junit.Test
+import kotlin.time.Duration.Companion.minutes
+
+class SyntheticChainTest {
+
+    @After
+    fun tearDown() {
+        NativeSyntheticChain.stop()
+    }
+
+    private class RefreshCallback : IWalletCallbacks.Stub() {
+        val result = CompletableDeferred<Pair<BlockchainTime, Int>>()
+
+        override fun onRefreshResult(blockchainTime: BlockchainTime, status: Int) {
+            result.complete(blockchainTime to status)
+        }
+
+        override fun onCommitResult(success: Boolean) {}
+        override fun onSubAddressReady(subAddress: String?) {}
+        override fun onSubAddressListReceived(subAddresses: Array<out String>?) {}
+        override fun onAccountNotFound(accountIndex: Int) {}
+        override fun onFeesReceived(fees: LongArray?) {}
+    }
+
+    /** Keeps the history as a ledger flow would, from full and incremental exports. */
+    private class HistoryListener : IBalanceListener.Stub() {
+        var txList = emptyList<TxInfo>()
+        val replacedFromHeights = mutableListOf<Long>()
+        private val buffer = mutableListOf<TxInfo>()
+
+        override fun onBalanceUpdateFinalized(
+            txBatch: List<TxInfo>,
+            replacedFromHeight: Long,
+            allSubAddresses: Array<out String>?,
+            blockchainTime: BlockchainTime?,
+        ) {
+            buffer.addAll(txBatch)
+            txList = txList.replaceFrom(replacedFromHeight, buffer)
+            replacedFromHeights.add(replacedFromHeight)
+            buffer.clear()
+        }
+
+        override fun onBalanceUpdateChunk(txBatch: List<TxInfo>) {
+            buffer.addAll(txBatch)
+        }
+
+        override fun onWalletRefreshed(blockchainTime: BlockchainTime?) {}
+        override fun onSubAddressListUpdated(allSubAddresses: Array<out String>?) {}
+    }
+
+    private suspend fun NativeWallet.refresh(): Int {
+        val callback = RefreshCallback()
+        resumeRefresh(false, false, callback)
+        return withTimeout(5.minutes) { callback.result.await() }.second
+    }
+
+    /** Serves a chain paying a new wallet, and returns the wallet in sync with it. */
+    private suspend fun syncedWallet(params: NativeSyntheticChain.Params): NativeWallet {
+        val secretSpendKey = randomSecretKey()
+
+        NativeWallet.localSyncWallet(
+            networkId = Stagenet.id,
+            secretSpendKey = secretSpendKey,
+            restorePoint = 0,
+        ).use { keys ->
+            assertThat(
+                NativeSyntheticChain.serve(
+                    Stagenet.id, keys.getPublicAddress(), keys.getViewSecretKey(), params,
+                )
+            ).isTrue()
+        }
+
+        val wallet = NativeWallet.localSyncWallet(
+            networkId = Stagenet.id,
+            secretSpendKey = secretSpendKey,
+            restorePoint = 0,
+        )
+        assertThat(wallet.refresh()).isEqualTo(NativeWallet.Status.OK)
+        return wallet
+    }
+
+    @LargeTest
+    @Test
+    fun walletFindsGeneratedOutputsAcrossReorg() = runBlocking {
+        val wallet = syncedWallet(
+            NativeSyntheticChain.Params(
+                blocks = 300,
+                txsPerBlock = 8,
+                outputsPerTx = 4,
+                subAddressesPerAccount = 20,
+            )
+        )
+
+        val before = NativeSyntheticChain.getStats()
+        assertThat(before.ownedOutputs).isGreaterThan(0L)
+        assertThat(wallet.getBalance().totalAmount.atomicUnits).isEqualTo(before.ownedAmount)
+
+        NativeSyntheticChain.reorg(depth = 40, newBlocks = 50)
+
+        assertThat(wallet.refresh()).isEqualTo(NativeWallet.Status.OK)
+        val after = NativeSyntheticChain.getStats()
+        assertThat(after.ownedAmount).isNotEqualTo(before.ownedAmount)
+        assertThat(wallet.getBalance().totalAmount.atomicUnits).isEqualTo(after.ownedAmount)
+
+        wallet.close()
+    }
+
+    @LargeTest
+    @Test
+    fun historyQueriesFilterOrderAndPage() = runBlocking {
+        val wallet = syncedWallet(
+            NativeSyntheticChain.Params(blocks = 200, accounts = 3, subAddressesPerAccount = 4)
+        )
+        val history = wallet.getTxHistorySnapshot()
+
+        val query = HistoryQuery(accountIndex = 1, incoming = true, heightRange = 50L..150L)
+        val expected = history.filter {
+            it.incoming && it.subAddressMajor == 1 && it.height in 50..150
+        }
+        assertThat(expected.size).isGreaterThan(7)
+
+        val pages = mutableListOf<TxHistoryPage>()
+        var cursor: Long? = TxHistoryPage.CURSOR_START
+        while (cursor != null) {
+            val page = wallet.queryTxHistory(query, cursor, limit = 7)
+            assertThat(page).isNotNull()
+            assertThat(page!!.txs.size).isAtMost(7)
+            pages.add(page)
+            cursor = page.nextCursor
+        }
+        val txs = pages.flatMap { it.txs }
+        assertThat(pages.size).isGreaterThan(1)
+        assertThat(txs).containsExactlyElementsIn(expected)
+        assertThat(txs.map { it.height }).isInOrder(Comparator.reverseOrder<Int>())
+
+        val byTimestamp = wallet.queryTxHistory(
+            HistoryQuery(order = HistoryQuery.Order.TIMESTAMP_ASCENDING),
+            TxHistoryPage.CURSOR_START,
+            limit = history.size,
+        )
+        assertThat(byTimestamp!!.nextCursor).isNull()
+        assertThat(byTimestamp.txs).containsExactlyElementsIn(history)
+        assertThat(byTimestamp.txs.map { it.timestamp }).isInOrder()
+
+        // Cursors from an earlier snapshot are rejected.
+        NativeSyntheticChain.reorg(depth = 10, newBlocks = 20)
+        assertThat(wallet.refresh()).isEqualTo(NativeWallet.Status.OK)
+        assertThat(wallet.queryTxHistory(query, pages.first().nextCursor!!, limit = 7)).isNull()
+
+        wallet.close()
+    }
+
+    @LargeTest
+    @Test
+    fun balancesSumPerSubAddress() = runBlocking {
+        val wallet = syncedWallet(
+            NativeSyntheticChain.Params(blocks = 200, accounts = 3, subAddressesPerAccount = 4)
+        )
+        val history = wallet.getTxHistorySnapshot()
+        val ledger = wallet.getLedger()
+        val now = wallet.getCurrentBlockchainTime()
+
+        var walletTotal = 0L
+        for (account in 0 until 3) {
+            var accountTotal = 0L
+            for (subAddress in 0 until 4) {
+                // The generated chain never spends, so every received amount counts.
+                val received = history.filter {
+                    it.incoming && it.subAddressMajor == account && it.subAddressMinor == subAddress
+                }.sumOf { it.amount }
+                val balance = wallet.getBalance(account, subAddress)
+                assertThat(balance.totalAmount.atomicUnits).isEqualTo(received)
+                accountTotal += received
+            }
+            val balance = wallet.getBalance(account)
+            assertThat(balance.totalAmount.atomicUnits).isEqualTo(accountTotal)
+            assertThat(balance.unlockedAmountAt(now))
+                .isEqualTo(ledger.getBalanceForAccount(account).unlockedAmountAt(now))
+            walletTotal += accountTotal
+        }
+        assertThat(walletTotal).isGreaterThan(0L)
+        assertThat(walletTotal).isEqualTo(NativeSyntheticChain.getStats().ownedAmount)
+        assertThat(wallet.getBalance().totalAmount.atomicUnits).isEqualTo(walletTotal)
+        assertThat(ledger.getBalance().totalAmount.atomicUnits).isEqualTo(walletTotal)
+
+        wallet.close()
+    }
+
+    @LargeTest
+    @Test
+    fun balanceListenersReceiveOnlyChangedEntries() = runBlocking {
+        val wallet = syncedWallet(NativeSyntheticChain.Params(blocks = 200))
+        val listener = HistoryListener()
+
+        wallet.addBalanceListener(listener)
+        assertThat(listener.replacedFromHeights).containsExactly(0L)
+        assertThat(listener.txList).isEqualTo(wallet.getTxHistorySnapshot())
+
+        NativeSyntheticChain.reorg(depth = 20, newBlocks = 30)
+        assertThat(wallet.refresh()).isEqualTo(NativeWallet.Status.OK)
+
+        assertThat(listener.replacedFromHeights.drop(1).min()).isGreaterThan(150L)
+        assertThat(listener.txList).isEqualTo(wallet.getTxHistorySnapshot())
+
+        wallet.removeBalanceListener(listener)
+        wallet.close()
+    }
+}
@@ -0,0 +1,23 @@
+# Definitions for host builds of the wallet core with the system toolchain.
+# The NDK_* names are kept so that external projects build the same way.
+
+set(SYSROOT "${CMAKE_SYSROOT}")
+
+execute_process(
+    COMMAND "${CMAKE_C_COMPILER}" -dumpmachine
+    OUTPUT_VARIABLE TARGET_HOST
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+)
+
+set(NDK_AR     "${CMAKE_AR}")
+set(NDK_CC     "${CMAKE_C_COMPILER}")
+set(NDK_AS     "${CMAKE_C_COMPILER}")
+set(NDK_CXX    "${CMAKE_CXX_COMPILER}")
+set(NDK_LD     "${CMAKE_LINKER}")
+set(NDK_RANLIB "${CMAKE_RANLIB}")
+set(NDK_STRIP  "${CMAKE_STRIP}")
+find_program(NDK_MAKE make REQUIRED)
+
+# Common compiler flags for current build config (debug or release)
+string(TOUPPER "${CMAKE_BUILD_TYPE}" CMAKE_BUILD_TYPE_UPPER)
+set(NDK_C_FLAGS "${CMAKE_C_FLAGS} ${CMAKE_C_FLAGS_${CMAKE_BUILD_TYPE_UPPER}} -fPIC")
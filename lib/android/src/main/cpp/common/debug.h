@@ -2,13 +2,55 @@
 #define COMMON_DEBUG_H_
 
 #include <stddef.h>
+
+#ifdef __ANDROID__
 #include <android/log.h>
+#else
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#endif
 
 // Default local tag
 #ifndef LOG_TAG
 #define LOG_TAG "MoneroJNI"
 #endif
 
+// Host builds of the wallet core have no logcat; messages go to stderr.
+#ifndef __ANDROID__
+#define ANDROID_LOG_VERBOSE 'V'
+#define ANDROID_LOG_DEBUG 'D'
+#define ANDROID_LOG_INFO 'I'
+#define ANDROID_LOG_WARN 'W'
+#define ANDROID_LOG_ERROR 'E'
+
+__attribute__((format(printf, 3, 4)))
+static inline int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "%c/%s: ", prio, tag);
+  int n = vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+  return n;
+}
+
+__attribute__((noreturn, format(printf, 3, 4)))
+static inline void __android_log_assert(const char* cond, const char* tag, const char* fmt, ...) {
+  fprintf(stderr, "F/%s: ", tag);
+  if (fmt != NULL) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+  } else {
+    fprintf(stderr, "Assertion failed: %s", cond != NULL ? cond : "");
+  }
+  fputc('\n', stderr);
+  abort();
+}
+#endif
+
 // Low-level debug macros.  Log messages are not scrubbed.
 #define LOGD(...) ((void)__android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__))
 #define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
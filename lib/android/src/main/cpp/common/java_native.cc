@@ -116,6 +116,16 @@ std::vector<char> JavaToNativeByteArray(JNIEnv* env, jbyteArray j_array) {
   return v;
 }
 
+SecretBuffer JavaToNativeSecretByteArray(JNIEnv* env, jbyteArray j_array) {
+  const jsize len = env->GetArrayLength(j_array);
+  LOG_FATAL_IF(CheckException(env));
+  SecretBuffer v(len);
+  env->GetByteArrayRegion(j_array, 0, len,
+                          reinterpret_cast<jbyte*>(v.data()));
+  LOG_FATAL_IF(CheckException(env));
+  return v;
+}
+
 std::vector<int32_t> JavaToNativeIntArray(JNIEnv* env, jintArray j_array) {
   const jsize len = env->GetArrayLength(j_array);
   LOG_FATAL_IF(CheckException(env));
@@ -6,6 +6,7 @@
 
 #include "common/jvm.h"
 #include "common/scoped_java_ref.h"
+#include "common/secret_arena.h"
 
 namespace monero {
 
@@ -45,6 +46,8 @@ jobject NewObject(JNIEnv* env, jclass clazz, jmethodID method_id, ...);
 std::string JavaToNativeString(JNIEnv* env, jstring j_string);
 
 std::vector<char> JavaToNativeByteArray(JNIEnv* env, jbyteArray j_array);
+// Same as above, for key material.  The copy lives in the secret arena.
+SecretBuffer JavaToNativeSecretByteArray(JNIEnv* env, jbyteArray j_array);
 std::vector<int32_t> JavaToNativeIntArray(JNIEnv* env, jintArray j_array);
 std::vector<int64_t> JavaToNativeLongArray(JNIEnv* env, jlongArray j_array);
 
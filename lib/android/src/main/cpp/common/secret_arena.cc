@@ -0,0 +1,142 @@
+#include "common/secret_arena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <new>
+
+#include <openssl/crypto.h>
+
+#include "common/debug.h"
+
+namespace monero {
+
+constexpr size_t SecretArena::kNumClasses;
+constexpr size_t SecretArena::kClassSizes[];
+constexpr size_t SecretArena::kSlabSizes[];
+
+namespace {
+
+size_t RoundUp(size_t size, size_t page_size) {
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+}  // namespace
+
+SecretArena& SecretArena::instance() {
+  // Never destroyed, so that buffers freed by static destructors still find
+  // their arena.
+  static SecretArena* arena = new SecretArena();
+  return *arena;
+}
+
+SecretArena::SecretArena()
+    : m_classes(), m_mapping_begin(0), m_mapping_end(0), m_stats() {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  // Layout: guard, slab 0, guard, slab 1, ..., slab N-1, guard.
+  size_t slab_bytes = 0;
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    slab_bytes += RoundUp(kSlabSizes[i], page_size);
+  }
+  const size_t total = slab_bytes + (kNumClasses + 1) * page_size;
+  void* mapping = mmap(nullptr, total, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    LOGE("Cannot map secret arena: errno=%d", errno);
+    return;
+  }
+  m_mapping_begin = reinterpret_cast<uintptr_t>(mapping);
+  m_mapping_end = m_mapping_begin + total;
+  uintptr_t slab = m_mapping_begin + page_size;
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    const size_t slab_size = RoundUp(kSlabSizes[i], page_size);
+    void* p = reinterpret_cast<void*>(slab);
+    LOG_FATAL_IF(mprotect(p, slab_size, PROT_READ | PROT_WRITE) != 0,
+                 "Cannot unprotect secret arena: errno=%d", errno);
+#ifdef MADV_DONTDUMP
+    madvise(p, slab_size, MADV_DONTDUMP);
+#endif
+    if (mlock(p, slab_size) == 0) {
+      m_stats.locked_bytes += slab_size;
+    }
+    m_classes[i].begin = slab;
+    m_classes[i].end = slab + slab_size;
+    m_classes[i].bump = slab;
+    m_classes[i].free_list = nullptr;
+    slab += slab_size + page_size;
+  }
+  if (m_stats.locked_bytes < slab_bytes) {
+    LOGW("Secret arena partially locked: %zu bytes", m_stats.locked_bytes);
+  }
+}
+
+int SecretArena::findClass(const void* p) const {
+  const auto addr = reinterpret_cast<uintptr_t>(p);
+  if (addr < m_mapping_begin || addr >= m_mapping_end) {
+    return -1;
+  }
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    if (addr >= m_classes[i].begin && addr < m_classes[i].end) {
+      return static_cast<int>(i);
+    }
+  }
+  LOG_FATAL("Pointer into a secret arena guard page");
+  return -1;
+}
+
+void* SecretArena::allocate(size_t size) {
+  if (m_mapping_begin != 0) {
+    for (size_t i = 0; i < kNumClasses; ++i) {
+      if (size > kClassSizes[i]) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(m_mutex);
+      SizeClass& sc = m_classes[i];
+      void* p = nullptr;
+      if (sc.free_list != nullptr) {
+        p = sc.free_list;
+        sc.free_list = *static_cast<void**>(p);
+        *static_cast<void**>(p) = nullptr;
+      } else if (sc.bump + kClassSizes[i] <= sc.end) {
+        p = reinterpret_cast<void*>(sc.bump);
+        sc.bump += kClassSizes[i];
+      }
+      if (p != nullptr) {
+        ++m_stats.in_use;
+        return p;
+      }
+      // Exhausted; larger classes are kept for larger secrets.
+      break;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.fallbacks;
+  }
+  return ::operator new(size);
+}
+
+void SecretArena::deallocate(void* p, size_t size) {
+  if (p == nullptr) {
+    return;
+  }
+  int i = findClass(p);
+  if (i < 0) {
+    OPENSSL_cleanse(p, size);
+    ::operator delete(p);
+    return;
+  }
+  OPENSSL_cleanse(p, kClassSizes[i]);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  SizeClass& sc = m_classes[i];
+  *static_cast<void**>(p) = sc.free_list;
+  sc.free_list = p;
+  --m_stats.in_use;
+}
+
+SecretArena::Stats SecretArena::stats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+}  // namespace monero
@@ -0,0 +1,104 @@
+#ifndef COMMON_SECRET_ARENA_H_
+#define COMMON_SECRET_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace monero {
+
+// Process-wide pool of locked memory for the copies of secret material made
+// at the library boundaries: spend keys, view keys and mnemonic entropy on
+// their way from Java or the C API into the wallet.  Keys held by wallet2
+// are not drawn from here; epee's mlocker still locks their pages itself.
+//
+// A single mapping is reserved on first use and split into one slab per
+// size class, each fenced by PROT_NONE guard pages so that an overrun faults
+// instead of reaching the next slab.  Slabs are mlock'd and left out of core
+// dumps once, up front.  Blocks are zeroed as they are freed.
+//
+// Requests larger than the largest class, or made while their class is
+// exhausted, are served by the heap and still zeroed on free.  If the pages
+// cannot be locked (RLIMIT_MEMLOCK is small on some devices), the arena is
+// used unlocked.
+//
+// Thread-safe.
+class SecretArena {
+ public:
+  static constexpr size_t kNumClasses = 6;
+  static constexpr size_t kClassSizes[kNumClasses] = {32, 64, 128, 256, 1024, 4096};
+  // Bytes of each slab before rounding up to whole pages.
+  static constexpr size_t kSlabSizes[kNumClasses] = {
+      4096, 4096, 4096, 4096, 4096, 8192};
+
+  struct Stats {
+    size_t in_use;     // Blocks handed out and not yet freed.
+    size_t fallbacks;  // Requests served by the heap.
+    size_t locked_bytes;
+  };
+
+  static SecretArena& instance();
+
+  void* allocate(size_t size);
+  void deallocate(void* p, size_t size);
+
+  Stats stats();
+
+ private:
+  struct SizeClass {
+    uintptr_t begin;
+    uintptr_t end;
+    uintptr_t bump;   // Next never-used block.
+    void* free_list;  // Freed blocks, linked through their first word.
+  };
+
+  SecretArena();
+
+  int findClass(const void* p) const;
+
+  SizeClass m_classes[kNumClasses];
+  uintptr_t m_mapping_begin;
+  uintptr_t m_mapping_end;
+
+  std::mutex m_mutex;
+  Stats m_stats;
+
+ private:
+  SecretArena(const SecretArena&) = delete;
+  SecretArena& operator=(const SecretArena&) = delete;
+};
+
+// Allocator drawing from SecretArena, for containers holding secrets.
+template<typename T>
+class SecretAllocator {
+ public:
+  using value_type = T;
+
+  SecretAllocator() = default;
+
+  template<typename U>
+  SecretAllocator(const SecretAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(SecretArena::instance().allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    SecretArena::instance().deallocate(p, n * sizeof(T));
+  }
+};
+
+template<typename T, typename U>
+bool operator==(const SecretAllocator<T>&, const SecretAllocator<U>&) { return true; }
+
+template<typename T, typename U>
+bool operator!=(const SecretAllocator<T>&, const SecretAllocator<U>&) { return false; }
+
+// Byte buffer for secrets, wiped when its storage is released.  Growing the
+// buffer wipes the old storage too.
+using SecretBuffer = std::vector<char, SecretAllocator<char>>;
+
+}  // namespace monero
+
+#endif  // COMMON_SECRET_ARENA_H_
@@ -1,11 +1,29 @@
-#include "common/eraser.h"
-
 #include "jni_cache.h"
 
+#include "common/debug.h"
+
 #include "electrum-words.h"
 
 namespace monero {
 
+namespace {
+
+// Copies the array straight into the string type electrum-words reads, so
+// that no second copy of the secret is made.  A wipeable_string cannot draw
+// from SecretArena, but it is wiped when released.
+epee::wipeable_string JavaToNativeWipeableString(JNIEnv* env, jbyteArray j_array) {
+  const jsize len = env->GetArrayLength(j_array);
+  LOG_FATAL_IF(CheckException(env));
+  epee::wipeable_string str;
+  str.resize(len);
+  env->GetByteArrayRegion(j_array, 0, len,
+                          reinterpret_cast<jbyte*>(str.data()));
+  LOG_FATAL_IF(CheckException(env));
+  return str;
+}
+
+}  // namespace
+
 extern "C"
 JNIEXPORT jobject JNICALL
 Java_im_molly_monero_sdk_mnemonics_MoneroMnemonicKt_nativeElectrumWordsGenerateMnemonic(
@@ -13,8 +31,7 @@ Java_im_molly_monero_sdk_mnemonics_MoneroMnemonicKt_nativeElectrumWordsGenerateM
     jclass clazz,
     jbyteArray j_entropy,
     jstring j_language) {
-  std::vector<char> entropy = JavaToNativeByteArray(env, j_entropy);
-  Eraser entropy_eraser(entropy);
+  SecretBuffer entropy = JavaToNativeSecretByteArray(env, j_entropy);
 
   std::string language = JavaToNativeString(env, j_language);
 
@@ -43,13 +60,12 @@ Java_im_molly_monero_sdk_mnemonics_MoneroMnemonicKt_nativeElectrumWordsRecoverEn
     jclass clazz,
     jbyteArray j_source
 ) {
-  std::vector<char> words = JavaToNativeByteArray(env, j_source);
-  Eraser words_eraser(words);
+  epee::wipeable_string words = JavaToNativeWipeableString(env, j_source);
 
-  epee::wipeable_string entropy, w_words(words.data(), words.size());
+  epee::wipeable_string entropy;
   std::string language;
   bool success =
-      crypto::ElectrumWords::words_to_bytes(w_words,
+      crypto::ElectrumWords::words_to_bytes(words,
                                             entropy,
                                             0,    /* len */
                                             true, /* duplicate */
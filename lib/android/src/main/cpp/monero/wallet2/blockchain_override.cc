@@ -0,0 +1,16 @@
+#include "cryptonote_core/blockchain.h"
+
+namespace cryptonote {
+
+// get_block_longhash() asks a Blockchain for the RandomX seed of the block
+// it hashes.  The wallet never has one to pass, so these are unreachable.
+
+crypto::hash Blockchain::get_pending_block_id_by_height(uint64_t height) const {
+  return crypto::null_hash;
+}
+
+uint64_t Blockchain::get_current_blockchain_height() const {
+  return 0;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,9 @@
+#include "CryptonightR_JIT.h"
+
+// Slim builds ship no JIT: slow-hash.c then runs the CryptonightR program
+// with the interpreter.  The wallet never checks proof of work anyway.
+int v4_generate_JIT_code(const struct V4_Instruction* code,
+                         v4_random_math_JIT_func buf,
+                         const size_t buf_size) {
+  return -1;
+}
@@ -0,0 +1,19 @@
+#include <map>
+#include <memory>
+#include <string>
+
+#include "device/device.hpp"
+
+namespace hw {
+namespace trezor {
+
+void register_all() {
+  // No-op.
+}
+
+void register_all(std::map<std::string, std::unique_ptr<device>>& registry) {
+  // No-op.
+}
+
+}  // namespace trezor
+}  // namespace hw
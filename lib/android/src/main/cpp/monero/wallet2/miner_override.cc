@@ -0,0 +1,15 @@
+#include "cryptonote_basic/miner.h"
+
+namespace cryptonote {
+
+// Only generate_genesis_block() mines, at difficulty 1, where every hash
+// passes: the nonce it starts with is the one it would return.
+bool miner::find_nonce_for_given_block(const get_block_hash_t& gbh,
+                                       block& bl,
+                                       const difficulty_type& diffic,
+                                       uint64_t height,
+                                       const crypto::hash* seed_hash) {
+  return true;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,113 @@
+#include "balance_tracker.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cryptonote_config.h"
+
+namespace monero {
+
+void BalanceAggregate::merge(const BalanceAggregate& other) {
+  pending += other.pending;
+  unlocked += other.unlocked;
+  for (const auto& bucket: other.locked_until_height) {
+    locked_until_height[bucket.first] += bucket.second;
+  }
+  for (const auto& bucket: other.locked_until_timestamp) {
+    locked_until_timestamp[bucket.first] += bucket.second;
+  }
+}
+
+void BalanceTracker::rebuild(const TxHistory& history, uint64_t height, uint64_t timestamp) {
+  m_subaddresses.clear();
+  m_height_unlocks = UnlockHeap();
+  m_timestamp_unlocks = UnlockHeap();
+
+  const size_t n = history.size();
+  std::unordered_set<crypto::key_image> spent_key_images;
+  std::unordered_map<crypto::hash, uint64_t> tx_unlock_times;
+  for (size_t i = 0; i < n; ++i) {
+    if (history.type(i) == TxInfo::OUTGOING && history.key_image_known(i)) {
+      spent_key_images.insert(history.key_image(i));
+    }
+    if (history.unlock_time(i) != 0) {
+      uint64_t& unlock_time = tx_unlock_times[history.tx_hash(i)];
+      unlock_time = std::max(unlock_time, history.unlock_time(i));
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    if (history.type(i) != TxInfo::INCOMING || history.state(i) == TxInfo::FAILED) {
+      continue;
+    }
+    if (history.key_image_known(i) && spent_key_images.count(history.key_image(i))) {
+      continue;
+    }
+    const cryptonote::subaddress_index index = {history.subaddress_major(i),
+                                                history.subaddress_minor(i)};
+    BalanceAggregate& balance = m_subaddresses[index];
+    const uint64_t amount = history.amount(i);
+    if (history.height(i) == 0) {
+      balance.pending += amount;
+      continue;
+    }
+    uint64_t unlock_height = history.height(i) + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE - 1;
+    auto it = tx_unlock_times.find(history.tx_hash(i));
+    if (it != tx_unlock_times.end()) {
+      if (it->second >= CRYPTONOTE_MAX_BLOCK_NUMBER) {
+        // Timestamp locks are tracked by timestamp alone.
+        auto& bucket = balance.locked_until_timestamp[it->second];
+        if (bucket == 0) {
+          m_timestamp_unlocks.push({it->second, index});
+        }
+        bucket += amount;
+        continue;
+      }
+      unlock_height = std::max(unlock_height, it->second);
+    }
+    auto& bucket = balance.locked_until_height[unlock_height];
+    if (bucket == 0) {
+      m_height_unlocks.push({unlock_height, index});
+    }
+    bucket += amount;
+  }
+
+  advanceTo(height, timestamp);
+}
+
+void BalanceTracker::advanceTo(uint64_t height, uint64_t timestamp) {
+  releaseDue(&m_height_unlocks, height, true);
+  releaseDue(&m_timestamp_unlocks, timestamp, false);
+}
+
+void BalanceTracker::releaseDue(UnlockHeap* heap, uint64_t point, bool by_height) {
+  while (!heap->empty() && heap->top().unlock_at <= point) {
+    const PendingUnlock& due = heap->top();
+    BalanceAggregate& balance = m_subaddresses[due.index];
+    auto& buckets = by_height ? balance.locked_until_height : balance.locked_until_timestamp;
+    auto it = buckets.find(due.unlock_at);
+    if (it != buckets.end()) {
+      balance.unlocked += it->second;
+      buckets.erase(it);
+    }
+    heap->pop();
+  }
+}
+
+BalanceAggregate BalanceTracker::query(uint32_t account) const {
+  BalanceAggregate total;
+  for (const auto& entry: m_subaddresses) {
+    if (account == static_cast<uint32_t>(-1) || entry.first.major == account) {
+      total.merge(entry.second);
+    }
+  }
+  return total;
+}
+
+BalanceAggregate BalanceTracker::query(const cryptonote::subaddress_index& index) const {
+  auto it = m_subaddresses.find(index);
+  return it != m_subaddresses.end() ? it->second : BalanceAggregate();
+}
+
+}  // namespace monero
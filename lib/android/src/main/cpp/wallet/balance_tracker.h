@@ -0,0 +1,68 @@
+#ifndef WALLET_BALANCE_TRACKER_H_
+#define WALLET_BALANCE_TRACKER_H_
+
+#include <map>
+#include <queue>
+#include <vector>
+
+#include "tx_history.h"
+
+#include "cryptonote_basic/subaddress_index.h"
+
+namespace monero {
+
+// Balance of a subaddress or an account, split the same way as the Kotlin
+// Balance class.  Confirmed amounts still locked are bucketed by the height
+// or timestamp at which they unlock.
+struct BalanceAggregate {
+  uint64_t pending = 0;
+  uint64_t unlocked = 0;
+  std::map<uint64_t, uint64_t> locked_until_height;
+  std::map<uint64_t, uint64_t> locked_until_timestamp;
+
+  void merge(const BalanceAggregate& other);
+};
+
+// Per-subaddress balances derived from the tx history snapshot, with the
+// same rules as the Kotlin ledger: unspent incoming entries of non-failed
+// txs, pool entries counted as pending, and a spendable age applied on top
+// of the tx unlock time.
+//
+// rebuild() runs whenever a new snapshot is installed.  Between snapshots,
+// advanceTo() moves amounts whose unlock point has been reached into the
+// unlocked total, popping a min-heap of pending unlocks, so new blocks that
+// cross no unlock point cost nothing.
+class BalanceTracker {
+ public:
+  void rebuild(const TxHistory& history, uint64_t height, uint64_t timestamp);
+  void advanceTo(uint64_t height, uint64_t timestamp);
+
+  // Sums the subaddresses of `account`, or of every account if it is -1.
+  BalanceAggregate query(uint32_t account) const;
+
+  // As query(), for one subaddress.
+  BalanceAggregate query(const cryptonote::subaddress_index& index) const;
+
+ private:
+  struct PendingUnlock {
+    uint64_t unlock_at;
+    cryptonote::subaddress_index index;
+
+    bool operator>(const PendingUnlock& other) const { return unlock_at > other.unlock_at; }
+  };
+
+  using UnlockHeap = std::priority_queue<PendingUnlock,
+                                         std::vector<PendingUnlock>,
+                                         std::greater<PendingUnlock>>;
+
+  // Moves every bucket of `heap` due at or before `point` to unlocked.
+  void releaseDue(UnlockHeap* heap, uint64_t point, bool by_height);
+
+  std::map<cryptonote::subaddress_index, BalanceAggregate> m_subaddresses;
+  UnlockHeap m_height_unlocks;
+  UnlockHeap m_timestamp_unlocks;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_BALANCE_TRACKER_H_
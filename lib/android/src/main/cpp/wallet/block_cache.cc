@@ -0,0 +1,445 @@
+#include "block_cache.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "common/debug.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "storages/portable_storage_template_helper.h"
+
+namespace monero {
+
+namespace {
+
+struct CachedBlock {
+  cryptonote::block_complete_entry block;
+  cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices indices;
+
+  BEGIN_KV_SERIALIZE_MAP()
+    KV_SERIALIZE(block)
+    KV_SERIALIZE(indices)
+  END_KV_SERIALIZE_MAP()
+};
+
+// Block values are prefixed with the block hash and its parent hash.
+const size_t kLinkSize = 2 * sizeof(crypto::hash);
+
+struct RangeInfo {
+  uint64_t last_access;
+  uint64_t bytes;
+};
+
+// Big-endian keys keep heights in ascending order under LMDB's default
+// lexicographic comparison.
+struct HeightKey {
+  unsigned char data[8];
+
+  explicit HeightKey(uint64_t height) {
+    for (int i = 7; i >= 0; --i) {
+      data[i] = height & 0xff;
+      height >>= 8;
+    }
+  }
+
+  static uint64_t decode(const MDB_val& val) {
+    auto p = static_cast<const unsigned char*>(val.mv_data);
+    uint64_t height = 0;
+    for (int i = 0; i < 8; ++i) {
+      height = (height << 8) | p[i];
+    }
+    return height;
+  }
+
+  MDB_val val() { return {sizeof(data), data}; }
+};
+
+MDB_val ToVal(const void* data, size_t size) {
+  return {size, const_cast<void*>(data)};
+}
+
+const char* NetworkName(cryptonote::network_type nettype) {
+  switch (nettype) {
+    case cryptonote::MAINNET:
+      return "mainnet";
+    case cryptonote::TESTNET:
+      return "testnet";
+    case cryptonote::STAGENET:
+      return "stagenet";
+    default:
+      return nullptr;
+  }
+}
+
+// Aborts the transaction unless it has been committed.
+class ScopedTxn {
+ public:
+  ScopedTxn(MDB_env* env, unsigned int flags) : m_txn(nullptr) {
+    if (mdb_txn_begin(env, nullptr, flags, &m_txn) != MDB_SUCCESS) {
+      m_txn = nullptr;
+    }
+  }
+
+  ~ScopedTxn() {
+    if (m_txn) mdb_txn_abort(m_txn);
+  }
+
+  bool valid() const { return m_txn != nullptr; }
+
+  MDB_txn* get() const { return m_txn; }
+
+  bool commit() {
+    int rc = mdb_txn_commit(m_txn);
+    m_txn = nullptr;
+    return rc == MDB_SUCCESS;
+  }
+
+ private:
+  MDB_txn* m_txn;
+};
+
+std::mutex g_config_mutex;
+std::string g_cache_dir;
+uint64_t g_max_bytes = 0;
+std::map<cryptonote::network_type, std::unique_ptr<BlockCache>> g_caches;
+
+}  // namespace
+
+bool BlockCache::configure(const std::string& dir, uint64_t max_bytes) {
+  std::lock_guard<std::mutex> lock(g_config_mutex);
+  if (!g_cache_dir.empty()) {
+    return g_cache_dir == dir;
+  }
+  if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+    LOGW("Cannot create block cache directory: %s", strerror(errno));
+    return false;
+  }
+  g_cache_dir = dir;
+  g_max_bytes = max_bytes;
+  return true;
+}
+
+BlockCache* BlockCache::forNetwork(cryptonote::network_type nettype) {
+  std::lock_guard<std::mutex> lock(g_config_mutex);
+  if (g_cache_dir.empty() || NetworkName(nettype) == nullptr) {
+    return nullptr;
+  }
+  auto it = g_caches.find(nettype);
+  if (it != g_caches.end()) {
+    return it->second.get();
+  }
+  std::string path = g_cache_dir + "/" + NetworkName(nettype);
+  if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST) {
+    return nullptr;
+  }
+  MDB_env* env;
+  if (mdb_env_create(&env) != MDB_SUCCESS) {
+    return nullptr;
+  }
+  // Leave room for LMDB's page overhead and for growth before eviction.
+  int rc = mdb_env_set_maxdbs(env, 4);
+  if (rc == MDB_SUCCESS) rc = mdb_env_set_mapsize(env, 2 * g_max_bytes);
+  // The cache can be rebuilt from the network, so durability is traded for
+  // write speed.  MDB_NOTLS because JNI calls come from arbitrary threads.
+  if (rc == MDB_SUCCESS) rc = mdb_env_open(env, path.c_str(),
+                                           MDB_NOTLS | MDB_NOSYNC | MDB_NOMETASYNC, 0600);
+  if (rc != MDB_SUCCESS) {
+    LOGW("Cannot open block cache: %s", mdb_strerror(rc));
+    mdb_env_close(env);
+    return nullptr;
+  }
+  std::unique_ptr<BlockCache> cache(new BlockCache(env, g_max_bytes));
+  if (!cache->openDatabases()) {
+    return nullptr;
+  }
+  return (g_caches[nettype] = std::move(cache)).get();
+}
+
+BlockCache::BlockCache(MDB_env* env, uint64_t max_bytes)
+    : m_env(env),
+      m_max_bytes(max_bytes),
+      m_hits(0),
+      m_misses(0) {}
+
+BlockCache::~BlockCache() {
+  mdb_env_close(m_env);
+}
+
+bool BlockCache::openDatabases() {
+  ScopedTxn txn(m_env, 0);
+  if (!txn.valid()) {
+    return false;
+  }
+  if (mdb_dbi_open(txn.get(), "blocks", MDB_CREATE, &m_blocks) != MDB_SUCCESS
+      || mdb_dbi_open(txn.get(), "hashes", MDB_CREATE, &m_hashes) != MDB_SUCCESS
+      || mdb_dbi_open(txn.get(), "ranges", MDB_CREATE, &m_ranges) != MDB_SUCCESS
+      || mdb_dbi_open(txn.get(), "meta", MDB_CREATE, &m_meta) != MDB_SUCCESS) {
+    return false;
+  }
+  return txn.commit();
+}
+
+uint64_t BlockCache::getMeta(MDB_txn* txn, const char* name) {
+  MDB_val key = ToVal(name, strlen(name));
+  MDB_val val;
+  uint64_t value = 0;
+  if (mdb_get(txn, m_meta, &key, &val) == MDB_SUCCESS && val.mv_size == sizeof(value)) {
+    memcpy(&value, val.mv_data, sizeof(value));
+  }
+  return value;
+}
+
+void BlockCache::putMeta(MDB_txn* txn, const char* name, uint64_t value) {
+  MDB_val key = ToVal(name, strlen(name));
+  MDB_val val = ToVal(&value, sizeof(value));
+  mdb_put(txn, m_meta, &key, &val, 0);
+}
+
+bool BlockCache::lookup(const GetBlocksRequest& req, GetBlocksResponse* res) {
+  if (!req.prune || req.block_ids.empty()) {
+    return false;
+  }
+  uint64_t start_height;
+  {
+    ScopedTxn txn(m_env, MDB_RDONLY);
+    if (!txn.valid()) {
+      return false;
+    }
+    const crypto::hash& top_hash = req.block_ids.front();
+    MDB_val key = ToVal(&top_hash, sizeof(top_hash));
+    MDB_val val;
+    if (mdb_get(txn.get(), m_hashes, &key, &val) != MDB_SUCCESS
+        || val.mv_size != sizeof(start_height)) {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    memcpy(&start_height, val.mv_data, sizeof(start_height));
+    if (req.start_height > start_height) {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    // The chain height recorded from the last node response is only a lower
+    // bound of the current one.  Cached runs stop short of it, so that the
+    // requester never takes the last cached block for the chain tip and the
+    // request after the run goes to the node, which refreshes the record.
+    const uint64_t chain_height = getMeta(txn.get(), "chain_height");
+    if (start_height + 2 >= chain_height) {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    // Like the node, start with the requester's top block and follow the
+    // cached chain from there.
+    MDB_cursor* cursor;
+    if (mdb_cursor_open(txn.get(), m_blocks, &cursor) != MDB_SUCCESS) {
+      return false;
+    }
+    HeightKey height_key(start_height);
+    key = height_key.val();
+    int rc = mdb_cursor_get(cursor, &key, &val, MDB_SET_KEY);
+    crypto::hash expected_hash = top_hash;
+    uint64_t height = start_height;
+    res->blocks.clear();
+    res->output_indices.clear();
+    while (rc == MDB_SUCCESS
+           && res->blocks.size() < kMaxBlocksPerResponse
+           && height + 1 < chain_height) {
+      if (HeightKey::decode(key) != height || val.mv_size < kLinkSize) {
+        break;
+      }
+      auto data = static_cast<const uint8_t*>(val.mv_data);
+      crypto::hash hash, prev_hash;
+      memcpy(&hash, data, sizeof(hash));
+      memcpy(&prev_hash, data + sizeof(hash), sizeof(prev_hash));
+      if (height == start_height ? hash != expected_hash : prev_hash != expected_hash) {
+        break;
+      }
+      CachedBlock entry;
+      if (!epee::serialization::load_t_from_binary(
+          entry, epee::span<const uint8_t>(data + kLinkSize, val.mv_size - kLinkSize))) {
+        break;
+      }
+      res->blocks.push_back(std::move(entry.block));
+      res->output_indices.push_back(std::move(entry.indices));
+      expected_hash = hash;
+      ++height;
+      rc = mdb_cursor_get(cursor, &key, &val, MDB_NEXT);
+    }
+    mdb_cursor_close(cursor);
+    // The first block is already known to the requester, so a single block
+    // carries no new information.
+    if (res->blocks.size() < 2) {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    res->start_height = start_height;
+    res->current_height = chain_height;
+    res->pool_info_extent = cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::NONE;
+    res->status = CORE_RPC_STATUS_OK;
+    res->untrusted = false;
+  }
+
+  ScopedTxn txn(m_env, 0);
+  if (txn.valid()) {
+    uint64_t end_height = start_height + res->blocks.size() - 1;
+    for (uint64_t range = start_height / kRangeSize; range <= end_height / kRangeSize; ++range) {
+      touchRange(txn.get(), range, 0);
+    }
+    txn.commit();
+  }
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void BlockCache::insert(const GetBlocksRequest& req, const GetBlocksResponse& res) {
+  // Blocks fetched without the miner tx cannot serve other requests.
+  if (!req.prune || req.no_miner_tx || res.blocks.size() != res.output_indices.size()) {
+    return;
+  }
+  ScopedTxn txn(m_env, 0);
+  if (!txn.valid()) {
+    return;
+  }
+  // Size changes per range, applied once the blocks are written.
+  std::map<uint64_t, int64_t> range_deltas;
+  for (size_t i = 0; i < res.blocks.size(); ++i) {
+    const auto& bce = res.blocks[i];
+    uint64_t height = res.start_height + i;
+    cryptonote::block block;
+    crypto::hash hash;
+    if (!cryptonote::parse_and_validate_block_from_blob(bce.block, block, hash)) {
+      LOGW("Failed to parse block at height %" PRIu64, height);
+      return;
+    }
+
+    HeightKey height_key(height);
+    MDB_val key = height_key.val();
+    MDB_val val;
+    int64_t& bytes_delta = range_deltas[height / kRangeSize];
+    if (mdb_get(txn.get(), m_blocks, &key, &val) == MDB_SUCCESS) {
+      if (val.mv_size >= kLinkSize && memcmp(val.mv_data, &hash, sizeof(hash)) == 0) {
+        continue;
+      }
+      // Replaced after a reorg.
+      MDB_val old_hash = ToVal(val.mv_data, sizeof(crypto::hash));
+      mdb_del(txn.get(), m_hashes, &old_hash, nullptr);
+      bytes_delta -= val.mv_size;
+    }
+
+    CachedBlock entry{bce, res.output_indices[i]};
+    epee::byte_slice blob;
+    if (!epee::serialization::store_t_to_binary(entry, blob)) {
+      return;
+    }
+    std::string value;
+    value.reserve(kLinkSize + blob.size());
+    value.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+    value.append(reinterpret_cast<const char*>(&block.prev_id), sizeof(block.prev_id));
+    value.append(reinterpret_cast<const char*>(blob.data()), blob.size());
+
+    val = ToVal(value.data(), value.size());
+    MDB_val hash_key = ToVal(&hash, sizeof(hash));
+    MDB_val height_val = ToVal(&height, sizeof(height));
+    int rc = mdb_put(txn.get(), m_blocks, &key, &val, 0);
+    if (rc == MDB_SUCCESS) rc = mdb_put(txn.get(), m_hashes, &hash_key, &height_val, 0);
+    if (rc != MDB_SUCCESS) {
+      LOGW("Block cache write failed: %s", mdb_strerror(rc));
+      return;
+    }
+    bytes_delta += value.size();
+  }
+  for (const auto& entry: range_deltas) {
+    touchRange(txn.get(), entry.first, entry.second);
+  }
+  putMeta(txn.get(), "chain_height",
+          std::max(getMeta(txn.get(), "chain_height"), res.current_height));
+  evictIfNeeded(txn.get());
+  txn.commit();
+}
+
+void BlockCache::touchRange(MDB_txn* txn, uint64_t range, int64_t bytes_delta) {
+  HeightKey range_key(range);
+  MDB_val key = range_key.val();
+  MDB_val val;
+  RangeInfo info = {0, 0};
+  if (mdb_get(txn, m_ranges, &key, &val) == MDB_SUCCESS && val.mv_size == sizeof(info)) {
+    memcpy(&info, val.mv_data, sizeof(info));
+  }
+  info.last_access = time(nullptr);
+  info.bytes += bytes_delta;
+  val = ToVal(&info, sizeof(info));
+  mdb_put(txn, m_ranges, &key, &val, 0);
+  if (bytes_delta != 0) {
+    putMeta(txn, "bytes", getMeta(txn, "bytes") + bytes_delta);
+  }
+}
+
+void BlockCache::evictIfNeeded(MDB_txn* txn) {
+  while (getMeta(txn, "bytes") > m_max_bytes) {
+    MDB_cursor* cursor;
+    if (mdb_cursor_open(txn, m_ranges, &cursor) != MDB_SUCCESS) {
+      return;
+    }
+    MDB_val key, val;
+    bool found = false;
+    uint64_t lru_range = 0;
+    uint64_t lru_access = UINT64_MAX;
+    int rc = mdb_cursor_get(cursor, &key, &val, MDB_FIRST);
+    while (rc == MDB_SUCCESS) {
+      RangeInfo info;
+      memcpy(&info, val.mv_data, sizeof(info));
+      if (info.last_access < lru_access) {
+        lru_access = info.last_access;
+        lru_range = HeightKey::decode(key);
+        found = true;
+      }
+      rc = mdb_cursor_get(cursor, &key, &val, MDB_NEXT);
+    }
+    mdb_cursor_close(cursor);
+    if (!found) {
+      return;
+    }
+    evictRange(txn, lru_range);
+  }
+}
+
+void BlockCache::evictRange(MDB_txn* txn, uint64_t range) {
+  MDB_cursor* cursor;
+  if (mdb_cursor_open(txn, m_blocks, &cursor) != MDB_SUCCESS) {
+    return;
+  }
+  HeightKey first_key(range * kRangeSize);
+  MDB_val key = first_key.val();
+  MDB_val val;
+  int rc = mdb_cursor_get(cursor, &key, &val, MDB_SET_RANGE);
+  while (rc == MDB_SUCCESS && HeightKey::decode(key) / kRangeSize == range) {
+    MDB_val hash = ToVal(val.mv_data, sizeof(crypto::hash));
+    mdb_del(txn, m_hashes, &hash, nullptr);
+    mdb_cursor_del(cursor, 0);
+    // After a delete the cursor already refers to the following record.
+    rc = mdb_cursor_get(cursor, &key, &val, MDB_NEXT);
+  }
+  mdb_cursor_close(cursor);
+
+  HeightKey range_key(range);
+  key = range_key.val();
+  RangeInfo info = {0, 0};
+  if (mdb_get(txn, m_ranges, &key, &val) == MDB_SUCCESS && val.mv_size == sizeof(info)) {
+    memcpy(&info, val.mv_data, sizeof(info));
+  }
+  mdb_del(txn, m_ranges, &key, nullptr);
+  uint64_t total = getMeta(txn, "bytes");
+  putMeta(txn, "bytes", total > info.bytes ? total - info.bytes : 0);
+  LOGD("Evicted block cache range %" PRIu64 "-%" PRIu64,
+       range * kRangeSize, (range + 1) * kRangeSize - 1);
+}
+
+}  // namespace monero
@@ -0,0 +1,77 @@
+#ifndef WALLET_BLOCK_CACHE_H_
+#define WALLET_BLOCK_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <lmdb.h>
+
+#include "rpc/core_rpc_server_commands_defs.h"
+
+namespace monero {
+
+using GetBlocksRequest = cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::request;
+using GetBlocksResponse = cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response;
+
+// On-disk cache of getblocks.bin results, shared by all wallets of a network
+// in the process.
+//
+// Blocks are keyed by height together with their hash and parent hash, so
+// that a cached run is only served if it links to the requester's top block.
+// Disk usage is capped by evicting the least recently used range of
+// kRangeSize heights.
+//
+// The cache is not keyed by node: blocks fetched from one node are served to
+// every wallet of the network that enabled the cache, whatever node it uses.
+// Linking to the requester's top block keeps a cached run from being spliced
+// onto another chain, but past that point a wallet using the cache trusts
+// the nodes of the other wallets using it as much as its own.  Wallets opt in
+// with Wallet::enableBlockCache().
+class BlockCache {
+ public:
+  static constexpr uint64_t kRangeSize = 1000;
+  static constexpr size_t kMaxBlocksPerResponse = 1000;
+
+  // Enables the cache.  Each network gets its own database under `dir`.
+  static bool configure(const std::string& dir, uint64_t max_bytes);
+
+  // Returns the cache for a network, or nullptr if the cache is disabled.
+  static BlockCache* forNetwork(cryptonote::network_type nettype);
+
+  ~BlockCache();
+
+  // Builds a response from cached blocks.  Returns false on a cache miss.
+  bool lookup(const GetBlocksRequest& req, GetBlocksResponse* res);
+
+  // Adds the blocks of a response received from the node.
+  void insert(const GetBlocksRequest& req, const GetBlocksResponse& res);
+
+  uint64_t hits() const { return m_hits.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+ private:
+  BlockCache(MDB_env* env, uint64_t max_bytes);
+
+  bool openDatabases();
+  uint64_t getMeta(MDB_txn* txn, const char* name);
+  void putMeta(MDB_txn* txn, const char* name, uint64_t value);
+  void touchRange(MDB_txn* txn, uint64_t range, int64_t bytes_delta);
+  void evictIfNeeded(MDB_txn* txn);
+  void evictRange(MDB_txn* txn, uint64_t range);
+
+  MDB_env* const m_env;
+  const uint64_t m_max_bytes;
+
+  MDB_dbi m_blocks;   // height -> CachedBlock
+  MDB_dbi m_hashes;   // block hash -> height
+  MDB_dbi m_ranges;   // height / kRangeSize -> RangeInfo
+  MDB_dbi m_meta;     // name -> value
+
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_BLOCK_CACHE_H_
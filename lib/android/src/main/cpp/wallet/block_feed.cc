@@ -0,0 +1,233 @@
+#include "block_feed.h"
+
+#include "common/debug.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "storages/portable_storage_template_helper.h"
+
+namespace monero {
+
+constexpr size_t BlockFeed::kMaxRecentBytes;
+constexpr std::chrono::seconds BlockFeed::kRecentMaxIdle;
+constexpr std::chrono::seconds BlockFeed::kPoolInfoMaxAge;
+
+namespace {
+
+// Requests are shared when they go to the same node and ask for the same
+// range in the same way.  The rest of the short chain history only matters
+// if the top block is not on the node's main chain, and such responses are
+// never shared.
+std::string FeedKey(const GetBlocksRequest& req, const std::string& transport_id) {
+  std::string key(reinterpret_cast<const char*>(&req.block_ids.front()),
+                  sizeof(crypto::hash));
+  key.append(reinterpret_cast<const char*>(&req.start_height), sizeof(req.start_height));
+  key.append(reinterpret_cast<const char*>(&req.pool_info_since),
+             sizeof(req.pool_info_since));
+  key.push_back(static_cast<char>(req.requested_info));
+  key.push_back(static_cast<char>(req.prune));
+  key.push_back(static_cast<char>(req.no_miner_tx));
+  key.append(transport_id);
+  return key;
+}
+
+}  // namespace
+
+BlockFeed::Batch::Batch(std::string body, bool has_pool_info)
+    : m_body(std::move(body)),
+      m_has_pool_info(has_pool_info),
+      m_fetched_at(Clock::now()),
+      m_used_at(m_fetched_at),
+      m_first_block_hash(crypto::null_hash) {}
+
+void BlockFeed::Batch::parse() const {
+  std::call_once(m_parse_once, [this]() {
+    GetBlocksResponse res;
+    cryptonote::block block;
+    if (!epee::serialization::load_t_from_binary(res, m_body)
+        || res.status != CORE_RPC_STATUS_OK
+        || res.blocks.empty()
+        || !cryptonote::parse_and_validate_block_from_blob(res.blocks.front().block,
+                                                           block, m_first_block_hash)) {
+      m_first_block_hash = crypto::null_hash;
+    }
+  });
+}
+
+bool BlockFeed::Batch::startsAt(const crypto::hash& top_hash) const {
+  parse();
+  return m_first_block_hash != crypto::null_hash && m_first_block_hash == top_hash;
+}
+
+BlockFeed& BlockFeed::forNetwork(cryptonote::network_type nettype) {
+  static BlockFeed mainnet;
+  static BlockFeed testnet;
+  static BlockFeed stagenet;
+  switch (nettype) {
+    case cryptonote::MAINNET:
+      return mainnet;
+    case cryptonote::TESTNET:
+      return testnet;
+    case cryptonote::STAGENET:
+      return stagenet;
+    default:
+      LOG_FATAL("Unsupported network type: %d", nettype);
+  }
+}
+
+void BlockFeed::DropRecent() {
+  for (auto nettype: {cryptonote::MAINNET, cryptonote::TESTNET, cryptonote::STAGENET}) {
+    forNetwork(nettype).dropRecent();
+  }
+}
+
+void BlockFeed::join(const std::string& transport_id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_clients[transport_id]++;
+}
+
+void BlockFeed::leave(const std::string& transport_id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_clients.find(transport_id);
+  if (it != m_clients.end() && --it->second == 0) {
+    m_clients.erase(it);
+  }
+}
+
+bool BlockFeed::isShared(const std::string& transport_id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_clients.find(transport_id);
+  return it != m_clients.end() && it->second > 1;
+}
+
+std::shared_ptr<const BlockFeed::Batch> BlockFeed::fetch(const GetBlocksRequest& req,
+                                                         const std::string& transport_id,
+                                                         const Fetcher& fetcher,
+                                                         Clock::time_point deadline,
+                                                         bool* fetched) {
+  *fetched = false;
+  if (req.block_ids.empty()) {
+    return nullptr;
+  }
+  const crypto::hash& top_hash = req.block_ids.front();
+  const std::string key = FeedKey(req, transport_id);
+
+  std::shared_ptr<Flight> flight;
+  std::shared_ptr<const Batch> shared;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    shared = findRecent(key);
+    auto it = m_flights.find(key);
+    if (!shared && it != m_flights.end()) {
+      // Wait for the wallet that is already fetching this range.
+      std::shared_ptr<Flight> leader = it->second;
+      auto leader_done = [&leader]() { return leader->done; };
+      if (deadline == Clock::time_point::max()) {
+        m_flight_cond.wait(lock, leader_done);
+      } else if (!m_flight_cond.wait_until(lock, deadline, leader_done)) {
+        return nullptr;
+      }
+      if (!leader->batch) {
+        return nullptr;
+      }
+      shared = leader->batch;
+    }
+    if (!shared) {
+      flight = std::make_shared<Flight>();
+      m_flights.emplace(key, flight);
+    }
+  }
+  if (shared) {
+    // Checked out of the lock, as it parses the batch the first time.
+    if (!shared->startsAt(top_hash)) {
+      return nullptr;
+    }
+    m_shared.fetch_add(1, std::memory_order_relaxed);
+    return shared;
+  }
+
+  std::shared_ptr<const Batch> batch;
+  std::string body;
+  *fetched = true;
+  m_fetches.fetch_add(1, std::memory_order_relaxed);
+  try {
+    if (fetcher(&body)) {
+      batch = std::make_shared<Batch>(
+          std::move(body),
+          req.requested_info != cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::BLOCKS_ONLY);
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    flight->done = true;
+    m_flights.erase(key);
+    m_flight_cond.notify_all();
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    flight->done = true;
+    flight->batch = batch;
+    m_flights.erase(key);
+    if (batch) {
+      addRecent(key, batch);
+    }
+  }
+  m_flight_cond.notify_all();
+  LOGV("Block feed: fetches=%" PRIu64 ", shared=%" PRIu64, fetches(), shared());
+  return batch;
+}
+
+std::shared_ptr<const BlockFeed::Batch> BlockFeed::findRecent(const std::string& key) {
+  trimRecent();
+  for (auto it = m_recent.rbegin(); it != m_recent.rend(); ++it) {
+    if (it->first != key) {
+      continue;
+    }
+    const Batch& batch = *it->second;
+    if (batch.m_has_pool_info && Clock::now() - batch.m_fetched_at >= kPoolInfoMaxAge) {
+      return nullptr;
+    }
+    batch.m_used_at = Clock::now();
+    return it->second;
+  }
+  return nullptr;
+}
+
+void BlockFeed::addRecent(const std::string& key, const std::shared_ptr<const Batch>& batch) {
+  for (auto it = m_recent.begin(); it != m_recent.end(); ++it) {
+    if (it->first == key) {
+      m_recent_bytes -= it->second->body().size();
+      m_recent.erase(it);
+      break;
+    }
+  }
+  m_recent.emplace_back(key, batch);
+  m_recent_bytes += batch->body().size();
+  trimRecent();
+}
+
+// Drops idle batches, then the oldest ones until the rest fit in
+// kMaxRecentBytes.  The newest batch is kept even if it alone is larger.
+void BlockFeed::trimRecent() {
+  const auto now = Clock::now();
+  for (auto it = m_recent.begin(); it != m_recent.end();) {
+    if (now - it->second->m_used_at >= kRecentMaxIdle) {
+      m_recent_bytes -= it->second->body().size();
+      it = m_recent.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  while (m_recent.size() > 1 && m_recent_bytes > kMaxRecentBytes) {
+    m_recent_bytes -= m_recent.front().second->body().size();
+    m_recent.pop_front();
+  }
+}
+
+void BlockFeed::dropRecent() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_recent.clear();
+  m_recent_bytes = 0;
+}
+
+}  // namespace monero
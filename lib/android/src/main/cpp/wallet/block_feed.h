@@ -0,0 +1,132 @@
+#ifndef WALLET_BLOCK_FEED_H_
+#define WALLET_BLOCK_FEED_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "block_cache.h"
+
+namespace monero {
+
+// Shares getblocks.bin responses between the wallets of a network in the
+// process that reach the same node.
+//
+// Only the round trip to the node is shared.  Wallets whose transports have
+// the same id (see NodeTransport::id()) and that send the same request at the
+// same time, down to the top block, start height, pool info and pruning flags
+// (see FeedKey), are collapsed into a single request to the node.  The most
+// recent responses are kept in memory, up to kMaxRecentBytes, for wallets
+// that trail behind with the same request.  They are dropped once unused for
+// kRecentMaxIdle, or when no refresh is running at all.  Wallets whose
+// requests differ in any of these fetch on their own.  Every wallet still
+// parses and scans the blocks itself in wallet2.
+//
+// A transport with a single client has no one to share with.  Its requests
+// bypass the feed, so its responses are neither kept nor copied.
+//
+// The wallet that fetched a batch hands the body to wallet2 as is.  The body
+// is only parsed, once, when another wallet picks up the batch and needs to
+// check that it starts at their common top block.
+class BlockFeed {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kMaxRecentBytes = 16 * 1024 * 1024;
+  static constexpr std::chrono::seconds kRecentMaxIdle{30};
+
+  // Batches carrying pool info go stale quickly and are only reused for
+  // this long.
+  static constexpr std::chrono::seconds kPoolInfoMaxAge{2};
+
+  class Batch {
+   public:
+    Batch(std::string body, bool has_pool_info);
+
+    const std::string& body() const { return m_body; }
+
+    // Whether the first block of the batch is `top_hash`.  Only such
+    // responses can be served to other wallets with the same top block.
+    bool startsAt(const crypto::hash& top_hash) const;
+
+   private:
+    friend class BlockFeed;
+
+    void parse() const;
+
+    const std::string m_body;
+    const bool m_has_pool_info;
+    const Clock::time_point m_fetched_at;
+    mutable Clock::time_point m_used_at;  // Guarded by BlockFeed::m_mutex.
+
+    mutable std::once_flag m_parse_once;
+    mutable crypto::hash m_first_block_hash;  // Null unless a successful response.
+  };
+
+  // Fetches a raw response body from the node.  Returns false if there is
+  // nothing to share.
+  using Fetcher = std::function<bool(std::string* body)>;
+
+  static BlockFeed& forNetwork(cryptonote::network_type nettype);
+
+  // Drops the recent batches of every network.  Called when no refresh is
+  // running.
+  static void DropRecent();
+
+  // Counts the clients fetching blocks through transports with the id
+  // `transport_id`.
+  void join(const std::string& transport_id);
+  void leave(const std::string& transport_id);
+
+  // Whether another client shares the transport `transport_id`.  If not,
+  // fetch() need not be called.
+  bool isShared(const std::string& transport_id);
+
+  // Returns the batch answering `req` sent through `transport_id`.  The fetcher is called on the
+  // current thread only if no other wallet has fetched, or is fetching, the
+  // same range.  Returns nullptr if no batch could be shared, including a
+  // batch of another wallet that does not start at the top block of `req`,
+  // or if waiting for another wallet's fetch went past `deadline`; `*fetched`
+  // tells whether the fetcher ran.  A batch fetched here is not parsed.
+  std::shared_ptr<const Batch> fetch(const GetBlocksRequest& req,
+                                     const std::string& transport_id,
+                                     const Fetcher& fetcher,
+                                     Clock::time_point deadline,
+                                     bool* fetched);
+
+  uint64_t fetches() const { return m_fetches.load(std::memory_order_relaxed); }
+  uint64_t shared() const { return m_shared.load(std::memory_order_relaxed); }
+
+ private:
+  BlockFeed() : m_recent_bytes(0), m_fetches(0), m_shared(0) {}
+
+  struct Flight {
+    bool done = false;
+    std::shared_ptr<const Batch> batch;
+  };
+
+  std::shared_ptr<const Batch> findRecent(const std::string& key);
+  void addRecent(const std::string& key, const std::shared_ptr<const Batch>& batch);
+  void trimRecent();
+  void dropRecent();
+
+  std::mutex m_mutex;
+  std::condition_variable m_flight_cond;
+  std::map<std::string, std::shared_ptr<Flight>> m_flights;
+  std::deque<std::pair<std::string, std::shared_ptr<const Batch>>> m_recent;
+  size_t m_recent_bytes;
+  std::map<std::string, int> m_clients;
+
+  std::atomic<uint64_t> m_fetches;
+  std::atomic<uint64_t> m_shared;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_BLOCK_FEED_H_
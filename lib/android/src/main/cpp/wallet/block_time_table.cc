@@ -0,0 +1,381 @@
+#include "block_time_table.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "common/debug.h"
+
+namespace monero {
+
+namespace {
+
+const char kMagic[4] = {'M', 'B', 'T', 'T'};
+const uint16_t kVersion = 1;
+
+struct __attribute__((packed)) TableHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t nettype;
+  uint32_t interval;
+  uint32_t count;
+  uint64_t first_height;
+  uint64_t base_timestamp;
+};
+
+static_assert(sizeof(TableHeader) == 32, "Unexpected table header size");
+
+std::mutex g_config_mutex;
+std::string g_table_dir;
+
+std::string TablePath(const std::string& dir, cryptonote::network_type nettype) {
+  switch (nettype) {
+    case cryptonote::MAINNET:
+      return dir + "/mainnet.mbtt";
+    case cryptonote::TESTNET:
+      return dir + "/testnet.mbtt";
+    case cryptonote::STAGENET:
+      return dir + "/stagenet.mbtt";
+    default:
+      return std::string();
+  }
+}
+
+// Deltas must start at zero and never decrease, or the binary search in
+// findBracket() may step before the first sample.
+bool ValidDeltas(const uint32_t* deltas, uint32_t count) {
+  if (count == 0) {
+    return true;
+  }
+  if (deltas[0] != 0) {
+    return false;
+  }
+  for (uint32_t i = 1; i < count; ++i) {
+    if (deltas[i] < deltas[i - 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+BlockTimeTable& BlockTimeTable::forNetwork(cryptonote::network_type nettype) {
+  static BlockTimeTable mainnet(cryptonote::MAINNET);
+  static BlockTimeTable testnet(cryptonote::TESTNET);
+  static BlockTimeTable stagenet(cryptonote::STAGENET);
+  switch (nettype) {
+    case cryptonote::MAINNET:
+      return mainnet;
+    case cryptonote::TESTNET:
+      return testnet;
+    case cryptonote::STAGENET:
+      return stagenet;
+    default:
+      LOG_FATAL("Unsupported network type: %d", nettype);
+  }
+}
+
+bool BlockTimeTable::configure(const std::string& dir) {
+  std::lock_guard<std::mutex> lock(g_config_mutex);
+  if (!g_table_dir.empty()) {
+    return g_table_dir == dir;
+  }
+  if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+    LOGW("Cannot create block time table directory: %s", strerror(errno));
+    return false;
+  }
+  g_table_dir = dir;
+  for (auto nettype: {cryptonote::MAINNET, cryptonote::TESTNET, cryptonote::STAGENET}) {
+    int fd = open(TablePath(dir, nettype).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    // The mapping outlives the descriptor.
+    forNetwork(nettype).loadFrom(fd);
+    close(fd);
+  }
+  return true;
+}
+
+BlockTimeTable::BlockTimeTable(cryptonote::network_type nettype)
+    : m_nettype(nettype),
+      m_map_addr(nullptr),
+      m_map_size(0),
+      m_deltas(nullptr),
+      m_count(0),
+      m_first_height(0),
+      m_base_timestamp(0),
+      m_new_samples(0),
+      m_persisted_samples(0) {}
+
+BlockTimeTable::~BlockTimeTable() {
+  unmap();
+}
+
+void BlockTimeTable::unmap() {
+  if (m_map_addr != nullptr) {
+    munmap(m_map_addr, m_map_size);
+  }
+  m_map_addr = nullptr;
+  m_map_size = 0;
+  m_deltas = nullptr;
+  m_count = 0;
+}
+
+bool BlockTimeTable::loadFrom(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return false;
+  }
+  return loadFrom(fd, 0, st.st_size);
+}
+
+bool BlockTimeTable::loadFrom(int fd, off_t offset, size_t length) {
+  if (offset < 0 || length < sizeof(TableHeader)) {
+    return false;
+  }
+  // Bundled tables sit at an arbitrary offset inside the APK, but mappings
+  // must start on a page boundary.
+  const off_t page_offset = offset % sysconf(_SC_PAGE_SIZE);
+  const size_t size = page_offset + length;
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, offset - page_offset);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  const char* table = static_cast<const char*>(addr) + page_offset;
+  TableHeader hdr;
+  memcpy(&hdr, table, sizeof(hdr));
+  if (memcmp(hdr.magic, kMagic, sizeof(kMagic)) != 0
+      || hdr.version != kVersion
+      || hdr.nettype != m_nettype
+      || hdr.interval != kSampleInterval
+      || length < sizeof(hdr) + uint64_t(hdr.count) * sizeof(uint32_t)) {
+    LOGW("Invalid block time table");
+    munmap(addr, size);
+    return false;
+  }
+  const auto* deltas = reinterpret_cast<const uint32_t*>(table + sizeof(hdr));
+  if (!ValidDeltas(deltas, hdr.count)) {
+    LOGW("Invalid block time table: deltas not monotonic from zero");
+    munmap(addr, size);
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (hdr.first_height + uint64_t(hdr.count) * kSampleInterval
+      < m_first_height + uint64_t(m_count) * kSampleInterval) {
+    LOGD("Block time table ignored: the mapped one reaches further");
+    munmap(addr, size);
+    return false;
+  }
+  unmap();
+  m_map_addr = addr;
+  m_map_size = size;
+  m_deltas = deltas;
+  m_count = hdr.count;
+  m_first_height = hdr.first_height;
+  m_base_timestamp = hdr.base_timestamp;
+  LOGD("Loaded block time table: heights %" PRIu64 "-%" PRIu64,
+       m_first_height, m_first_height + uint64_t(m_count) * kSampleInterval);
+  return true;
+}
+
+bool BlockTimeTable::writeTo(std::ostream& output) const {
+  std::map<uint64_t, uint64_t> samples;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < m_count; ++i) {
+      samples[m_first_height + i * kSampleInterval] = m_base_timestamp + m_deltas[i];
+    }
+    for (const auto& entry: m_observed) {
+      if (entry.first % kSampleInterval == 0) {
+        samples.insert(entry);
+      }
+    }
+  }
+  if (samples.empty()) {
+    return false;
+  }
+  TableHeader hdr;
+  memcpy(hdr.magic, kMagic, sizeof(kMagic));
+  hdr.version = kVersion;
+  hdr.nettype = m_nettype;
+  hdr.interval = kSampleInterval;
+  hdr.first_height = samples.begin()->first;
+  hdr.base_timestamp = samples.begin()->second;
+  std::vector<uint32_t> deltas;
+  uint64_t next_height = hdr.first_height;
+  uint64_t max_timestamp = hdr.base_timestamp;
+  for (const auto& entry: samples) {
+    if (entry.first != next_height) {
+      break;
+    }
+    // Block timestamps are not strictly increasing; keep the series monotonic
+    // so that it can be binary searched.
+    max_timestamp = std::max(max_timestamp, entry.second);
+    uint64_t delta = max_timestamp - hdr.base_timestamp;
+    if (delta > UINT32_MAX) {
+      break;
+    }
+    deltas.push_back(static_cast<uint32_t>(delta));
+    next_height += kSampleInterval;
+  }
+  hdr.count = deltas.size();
+  output.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+  output.write(reinterpret_cast<const char*>(deltas.data()), deltas.size() * sizeof(uint32_t));
+  return output.good();
+}
+
+void BlockTimeTable::persist() {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(g_config_mutex);
+    if (g_table_dir.empty()) {
+      return;
+    }
+    path = TablePath(g_table_dir, m_nettype);
+  }
+  // Serializes writers of the same table.
+  static std::mutex write_mutex;
+  std::lock_guard<std::mutex> write_lock(write_mutex);
+  uint64_t new_samples;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_new_samples == m_persisted_samples) {
+      return;
+    }
+    new_samples = m_new_samples;
+  }
+  // The current file may still be mapped, so the new one is renamed over it
+  // rather than rewritten in place.
+  std::string tmp_path = path + ".tmp";
+  bool written;
+  {
+    std::ofstream output(tmp_path, std::ios::binary | std::ios::trunc);
+    written = writeTo(output);
+    output.close();
+    written = written && !output.fail();
+  }
+  if (!written || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOGW("Cannot persist block time table: %s", strerror(errno));
+    unlink(tmp_path.c_str());
+    // Left dirty, so the next refresh tries again.
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_persisted_samples = new_samples;
+}
+
+bool BlockTimeTable::findBracket(uint64_t timestamp, Sample* lower, Sample* upper) const {
+  bool has_lower = false;
+  bool has_upper = false;
+  auto consider = [&](uint64_t height, uint64_t ts) {
+    if (ts <= timestamp) {
+      if (!has_lower || height > lower->height) {
+        *lower = {height, ts};
+        has_lower = true;
+      }
+    } else {
+      if (!has_upper || height < upper->height) {
+        *upper = {height, ts};
+        has_upper = true;
+      }
+    }
+  };
+  if (m_count > 0 && timestamp >= m_base_timestamp) {
+    uint64_t offset = timestamp - m_base_timestamp;
+    const uint32_t* end = m_deltas + m_count;
+    const uint32_t* it = (offset > UINT32_MAX)
+                         ? end
+                         : std::upper_bound(m_deltas, end, static_cast<uint32_t>(offset));
+    uint32_t idx = it - m_deltas;
+    consider(m_first_height + (idx - 1) * kSampleInterval, m_base_timestamp + m_deltas[idx - 1]);
+    if (idx < m_count) {
+      consider(m_first_height + idx * kSampleInterval, m_base_timestamp + m_deltas[idx]);
+    }
+  } else if (m_count > 0) {
+    consider(m_first_height, m_base_timestamp);
+  }
+  for (const auto& entry: m_observed) {
+    consider(entry.first, entry.second);
+  }
+  if (has_upper && has_lower && upper->height <= lower->height) {
+    has_upper = false;
+  }
+  if (!has_upper) {
+    *upper = {0, 0};
+  }
+  return has_lower;
+}
+
+bool BlockTimeTable::estimateHeight(uint64_t timestamp, uint64_t* height) const {
+  Sample lower, upper;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!findBracket(timestamp, &lower, &upper)) {
+      return false;
+    }
+  }
+  uint64_t estimate;
+  if (upper.height > lower.height + kSampleInterval) {
+    // Too far apart to interpolate reliably.
+    return false;
+  } else if (upper.height > lower.height && upper.timestamp > lower.timestamp) {
+    // Interpolate linearly within the bracket.
+    estimate = lower.height + (timestamp - lower.timestamp) * (upper.height - lower.height)
+                              / (upper.timestamp - lower.timestamp);
+  } else {
+    // Past the last sample.  Only extrapolate over a short distance, since the
+    // actual block rate may differ from the target.
+    uint64_t blocks = (timestamp - lower.timestamp) / DIFFICULTY_TARGET_V2;
+    if (blocks > kSampleInterval) {
+      return false;
+    }
+    estimate = lower.height + blocks;
+  }
+  *height = std::max(lower.height,
+                     estimate > kSafetyMarginBlocks ? estimate - kSafetyMarginBlocks : 0);
+  return true;
+}
+
+void BlockTimeTable::observe(uint64_t height, uint64_t timestamp) {
+  if (timestamp == 0 || height % kSampleInterval != 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto ret = m_observed.insert({height, timestamp});
+  if (!ret.second) {
+    ret.first->second = timestamp;
+    return;
+  }
+  // Heights covered by the mapped table add nothing to its file.
+  if (height < m_first_height || height >= m_first_height + uint64_t(m_count) * kSampleInterval) {
+    ++m_new_samples;
+  }
+}
+
+std::vector<uint64_t> BlockTimeTable::missingSamples(uint64_t chain_height,
+                                                     size_t max_count) const {
+  std::vector<uint64_t> heights;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t height = (m_count > 0) ? m_first_height : 0;
+  while (height < chain_height && heights.size() < max_count) {
+    bool known = (m_count > 0 && height < m_first_height + uint64_t(m_count) * kSampleInterval)
+                 || m_observed.count(height) > 0;
+    if (!known) {
+      heights.push_back(height);
+    }
+    height += kSampleInterval;
+  }
+  return heights;
+}
+
+}  // namespace monero
@@ -0,0 +1,112 @@
+#ifndef WALLET_BLOCK_TIME_TABLE_H_
+#define WALLET_BLOCK_TIME_TABLE_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cryptonote_config.h"
+
+namespace monero {
+
+// Sparse index of block timestamps used to translate dates into block heights.
+//
+// Samples are taken every kSampleInterval blocks.  A table file holds a fixed
+// header followed by one 32-bit timestamp delta per sample, so it can be
+// mapped into memory and binary searched without decoding:
+//
+//   magic[4] "MBTT" | version u16 | nettype u16 | interval u32 | count u32
+//   first_height u64 | base_timestamp u64 | deltas u32[count]
+//
+// Tables bundled in the library assets (see tools/make_block_time_table.py)
+// are mapped straight from the APK, which isolated processes can read.
+// Samples observed while scanning, or fetched to fill the gap between the
+// table and the chain tip, are merged on top of them.  Once configure() has set a table directory, each
+// network's table is also loaded from there and written back after refreshes
+// that learned new samples.
+class BlockTimeTable {
+ public:
+  static constexpr uint64_t kSampleInterval = 720;
+
+  // Block timestamps may run ahead of wall time by this many blocks, so
+  // estimates are moved back by the same amount.
+  static constexpr uint64_t kSafetyMarginBlocks =
+      CRYPTONOTE_BLOCK_FUTURE_TIME_LIMIT / DIFFICULTY_TARGET_V2;
+
+  // Process-wide table shared by all wallets on the same network.
+  static BlockTimeTable& forNetwork(cryptonote::network_type nettype);
+
+  // Sets the directory of the table files and loads the table of every
+  // network found there.  Only the first call has any effect; returns false
+  // if the directory cannot be created or a different one is already set.
+  static bool configure(const std::string& dir);
+
+  ~BlockTimeTable();
+
+  // Maps the table stored at `offset` in the file `fd`, spanning `length`
+  // bytes, or the whole file.  The mapped table is only replaced by one that
+  // reaches at least as far, so a table persisted by an older release does
+  // not hide a newer bundled one.
+  bool loadFrom(int fd, off_t offset, size_t length);
+  bool loadFrom(int fd);
+
+  // Writes the lowest contiguous run of known samples in the table format.
+  bool writeTo(std::ostream& output) const;
+
+  // Writes the table back to its file in the configured directory if samples
+  // were observed since it was loaded or last persisted.
+  void persist();
+
+  // Estimates a height whose block timestamp is not later than `timestamp`.
+  // Returns false if `timestamp` is not covered by the known samples.
+  bool estimateHeight(uint64_t timestamp, uint64_t* height) const;
+
+  // Records a block timestamp seen during refresh.
+  void observe(uint64_t height, uint64_t timestamp);
+
+  // Returns up to `max_count` sample heights below `chain_height` that are
+  // not known yet, lowest first, starting at the end of the contiguous run
+  // that writeTo() would save.  Scanning only sees blocks above the restore
+  // height, so these are fetched from the node instead.
+  std::vector<uint64_t> missingSamples(uint64_t chain_height, size_t max_count) const;
+
+ private:
+  explicit BlockTimeTable(cryptonote::network_type nettype);
+
+  struct Sample {
+    uint64_t height;
+    uint64_t timestamp;
+  };
+
+  bool findBracket(uint64_t timestamp, Sample* lower, Sample* upper) const;
+  void unmap();
+
+  const cryptonote::network_type m_nettype;
+
+  mutable std::mutex m_mutex;
+
+  // Mapped table, if any.
+  void* m_map_addr;
+  size_t m_map_size;
+  const uint32_t* m_deltas;
+  uint32_t m_count;
+  uint64_t m_first_height;
+  uint64_t m_base_timestamp;
+
+  // Samples learned from scanned blocks, keyed by height.
+  std::map<uint64_t, uint64_t> m_observed;
+
+  // Count of observed samples not covered by the mapped table, and that count
+  // as of the last successful persist().
+  uint64_t m_new_samples;
+  uint64_t m_persisted_samples;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_BLOCK_TIME_TABLE_H_
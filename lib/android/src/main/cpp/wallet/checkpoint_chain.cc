@@ -0,0 +1,141 @@
+#include "checkpoint_chain.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "checkpoints/checkpoints.h"
+
+#include "common/debug.h"
+
+namespace monero {
+
+namespace {
+
+const char kMagic[4] = {'M', 'C', 'K', 'P'};
+const uint16_t kVersion = 2;
+
+struct __attribute__((packed)) FileHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t nettype;
+  uint32_t count;
+  uint32_t interval;
+  uint64_t first_height;
+};
+
+static_assert(sizeof(FileHeader) == 24, "Unexpected checkpoint header size");
+static_assert(sizeof(crypto::hash) == 32, "Unexpected block hash size");
+
+}  // namespace
+
+CheckpointChain& CheckpointChain::forNetwork(cryptonote::network_type nettype) {
+  static CheckpointChain mainnet(cryptonote::MAINNET);
+  static CheckpointChain testnet(cryptonote::TESTNET);
+  static CheckpointChain stagenet(cryptonote::STAGENET);
+  switch (nettype) {
+    case cryptonote::MAINNET:
+      return mainnet;
+    case cryptonote::TESTNET:
+      return testnet;
+    case cryptonote::STAGENET:
+      return stagenet;
+    default:
+      LOG_FATAL("Unsupported network type: %d", nettype);
+  }
+}
+
+CheckpointChain::CheckpointChain(cryptonote::network_type nettype)
+    : m_nettype(nettype),
+      m_map_addr(nullptr),
+      m_map_size(0),
+      m_hashes(nullptr),
+      m_count(0),
+      m_interval(0),
+      m_first_height(0) {
+  cryptonote::checkpoints checkpoints;
+  LOG_FATAL_IF(!checkpoints.init_default_checkpoints(nettype),
+               "Failed to initialize default checkpoints");
+  m_builtin = checkpoints.get_points();
+}
+
+CheckpointChain::~CheckpointChain() {
+  unmap();
+}
+
+void CheckpointChain::unmap() {
+  if (m_map_addr != nullptr) {
+    munmap(m_map_addr, m_map_size);
+  }
+  m_map_addr = nullptr;
+  m_map_size = 0;
+  m_hashes = nullptr;
+  m_count = 0;
+  m_interval = 0;
+  m_first_height = 0;
+}
+
+bool CheckpointChain::loadFrom(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < sizeof(FileHeader)) {
+    return false;
+  }
+  size_t size = st.st_size;
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  FileHeader hdr;
+  memcpy(&hdr, addr, sizeof(hdr));
+  if (memcmp(hdr.magic, kMagic, sizeof(kMagic)) != 0
+      || hdr.version != kVersion
+      || hdr.nettype != m_nettype
+      || hdr.interval == 0
+      || hdr.first_height + uint64_t(hdr.count) * hdr.interval >= CRYPTONOTE_MAX_BLOCK_NUMBER
+      || size < sizeof(hdr) + uint64_t(hdr.count) * sizeof(crypto::hash)) {
+    LOGW("Invalid checkpoint file");
+    munmap(addr, size);
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  unmap();
+  m_map_addr = addr;
+  m_map_size = size;
+  m_hashes = reinterpret_cast<const crypto::hash*>(static_cast<const char*>(addr) + sizeof(hdr));
+  m_count = hdr.count;
+  m_interval = hdr.interval;
+  m_first_height = hdr.first_height;
+  LOGD("Loaded %u checkpoints", m_count);
+  return true;
+}
+
+bool CheckpointChain::findAtOrBelow(uint64_t height,
+                                    uint64_t* cp_height,
+                                    crypto::hash* cp_hash) const {
+  bool found = false;
+  *cp_height = 0;
+  auto it = m_builtin.upper_bound(height);
+  if (it != m_builtin.begin()) {
+    --it;
+    if (it->first > 0) {
+      *cp_height = it->first;
+      *cp_hash = it->second;
+      found = true;
+    }
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_count > 0 && height >= m_first_height) {
+    const uint64_t idx = std::min<uint64_t>((height - m_first_height) / m_interval, m_count - 1);
+    const uint64_t rec_height = m_first_height + idx * m_interval;
+    if (rec_height > *cp_height) {
+      *cp_height = rec_height;
+      *cp_hash = m_hashes[idx];
+      found = true;
+    }
+  }
+  return found;
+}
+
+}  // namespace monero
@@ -0,0 +1,61 @@
+#ifndef WALLET_CHECKPOINT_CHAIN_H_
+#define WALLET_CHECKPOINT_CHAIN_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "crypto/hash.h"
+#include "cryptonote_config.h"
+
+namespace monero {
+
+// Known block hashes used to seed the wallet hashchain on restore, so that
+// block hashes below the restore height do not need to be downloaded.
+//
+// The checkpoints compiled into monero are always available.  Additional
+// checkpoints can be supplied in a file that is mapped into memory.  They are
+// taken at a fixed interval, so the file stores the hashes alone and a lookup
+// is a division:
+//
+//   magic[4] "MCKP" | version u16 | nettype u16 | count u32 | interval u32
+//   first_height u64 | hash u8[32][count]
+//
+// Block hashes do not compress, so this is as small as the table gets.
+class CheckpointChain {
+ public:
+  // Process-wide chain shared by all wallets on the same network.
+  static CheckpointChain& forNetwork(cryptonote::network_type nettype);
+
+  ~CheckpointChain();
+
+  // Maps a checkpoint file and replaces any previously mapped one.
+  bool loadFrom(int fd);
+
+  // Returns the highest checkpoint at or below `height`, excluding genesis.
+  bool findAtOrBelow(uint64_t height, uint64_t* cp_height, crypto::hash* cp_hash) const;
+
+ private:
+  explicit CheckpointChain(cryptonote::network_type nettype);
+
+  void unmap();
+
+  const cryptonote::network_type m_nettype;
+
+  mutable std::mutex m_mutex;
+
+  // Checkpoints built into monero's checkpoints.cpp.
+  std::map<uint64_t, crypto::hash> m_builtin;
+
+  // Mapped checkpoint file, if any.
+  void* m_map_addr;
+  size_t m_map_size;
+  const crypto::hash* m_hashes;
+  uint32_t m_count;
+  uint32_t m_interval;
+  uint64_t m_first_height;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_CHECKPOINT_CHAIN_H_
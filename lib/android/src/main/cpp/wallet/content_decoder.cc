@@ -0,0 +1,164 @@
+#include "content_decoder.h"
+
+#include <errno.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "common/debug.h"
+
+namespace monero {
+
+constexpr size_t ContentDecoder::kMaxDecodedSize;
+
+namespace {
+
+constexpr size_t kReadChunkSize = 64 * 1024;
+constexpr size_t kInflateChunkSize = 16 * 1024;
+
+// "deflate" is meant to be a zlib stream, but some servers send a raw
+// deflate stream instead.  Tell them apart by the zlib header check bits.
+// `data` must hold at least two bytes.
+bool LooksLikeZlibHeader(const char* data) {
+  auto cmf = static_cast<uint8_t>(data[0]);
+  auto flg = static_cast<uint8_t>(data[1]);
+  return (cmf & 0x0f) == Z_DEFLATED && ((cmf << 8) | flg) % 31 == 0;
+}
+
+}  // namespace
+
+ContentDecoder::Encoding ContentDecoder::ParseEncoding(const std::string& value) {
+  if (value.empty() || strcasecmp(value.c_str(), "identity") == 0) {
+    return Encoding::IDENTITY;
+  }
+  if (strcasecmp(value.c_str(), "gzip") == 0 || strcasecmp(value.c_str(), "x-gzip") == 0) {
+    return Encoding::GZIP;
+  }
+  if (strcasecmp(value.c_str(), "deflate") == 0) {
+    return Encoding::DEFLATE;
+  }
+  return Encoding::UNSUPPORTED;
+}
+
+ContentDecoder::ContentDecoder(Encoding encoding)
+    : m_encoding(encoding),
+      m_stream(),
+      m_stream_end(false),
+      m_initialized(false),
+      m_head(),
+      m_head_size(0) {
+  LOG_FATAL_IF(encoding == Encoding::UNSUPPORTED);
+}
+
+ContentDecoder::~ContentDecoder() {
+  if (m_initialized) {
+    inflateEnd(&m_stream);
+  }
+}
+
+bool ContentDecoder::update(const char* data, size_t size, std::string* out) {
+  if (m_encoding == Encoding::IDENTITY) {
+    if (out->size() + size > kMaxDecodedSize) {
+      return false;
+    }
+    out->append(data, size);
+    return true;
+  }
+  if (size == 0) {
+    return true;
+  }
+  if (m_stream_end) {
+    // Trailing garbage after the end of the stream.
+    return false;
+  }
+  if (!m_initialized) {
+    // The body may arrive a byte at a time, so wait for both header bytes
+    // before deciding between zlib and raw deflate.
+    while (m_head_size < sizeof(m_head) && size > 0) {
+      m_head[m_head_size++] = *data++;
+      size--;
+    }
+    if (m_head_size < sizeof(m_head)) {
+      return true;
+    }
+    if (!start(out)) {
+      return false;
+    }
+    if (size == 0) {
+      return true;
+    }
+    if (m_stream_end) {
+      return false;
+    }
+  }
+  return inflateInput(data, size, out);
+}
+
+bool ContentDecoder::start(std::string* out) {
+  // Window bits: +32 detects gzip or zlib headers; negative means raw.
+  int window_bits = (m_encoding == Encoding::GZIP || LooksLikeZlibHeader(m_head))
+                    ? 15 + 32 : -15;
+  if (inflateInit2(&m_stream, window_bits) != Z_OK) {
+    return false;
+  }
+  m_initialized = true;
+  return inflateInput(m_head, sizeof(m_head), out);
+}
+
+bool ContentDecoder::inflateInput(const char* data, size_t size, std::string* out) {
+  m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  m_stream.avail_in = static_cast<uInt>(size);
+  char buf[kInflateChunkSize];
+  // Keep going while the output buffer fills up, as zlib may hold decoded
+  // data back even after it has consumed all the input.
+  do {
+    m_stream.next_out = reinterpret_cast<Bytef*>(buf);
+    m_stream.avail_out = sizeof(buf);
+    int ret = inflate(&m_stream, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END) {
+      m_stream_end = true;
+    } else if (ret == Z_BUF_ERROR) {
+      // No progress possible until more input arrives.
+      break;
+    } else if (ret != Z_OK) {
+      LOGW("Failed to decode response body: %s", m_stream.msg ? m_stream.msg : "zlib error");
+      return false;
+    }
+    size_t produced = sizeof(buf) - m_stream.avail_out;
+    if (out->size() + produced > kMaxDecodedSize) {
+      LOGW("Decoded response body exceeds %zu bytes", kMaxDecodedSize);
+      return false;
+    }
+    out->append(buf, produced);
+  } while (!m_stream_end && (m_stream.avail_in > 0 || m_stream.avail_out == 0));
+  return m_stream.avail_in == 0;
+}
+
+bool ContentDecoder::finish() const {
+  return m_encoding == Encoding::IDENTITY || m_stream_end;
+}
+
+bool ContentDecoder::readFrom(int fd, std::string* out, uint64_t* wire_bytes) {
+  std::string chunk(kReadChunkSize, '\0');
+  out->clear();
+  *wire_bytes = 0;
+  while (true) {
+    ssize_t n = ::read(fd, &chunk[0], chunk.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOGW("Failed to read response body: errno=%d", errno);
+      return false;
+    }
+    if (n == 0) {
+      break;
+    }
+    *wire_bytes += n;
+    if (!update(chunk.data(), n, out)) {
+      return false;
+    }
+  }
+  return finish();
+}
+
+}  // namespace monero
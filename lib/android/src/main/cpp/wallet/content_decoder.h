@@ -0,0 +1,72 @@
+#ifndef WALLET_CONTENT_DECODER_H_
+#define WALLET_CONTENT_DECODER_H_
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <string>
+
+namespace monero {
+
+// Content encodings the wallet asks remote nodes for.  monerod does not
+// compress its replies, but reverse proxies in front of public nodes often
+// do, and block batches shrink to about half their size.
+constexpr const char* kAcceptEncoding = "gzip, deflate";
+
+// Streaming decoder for HTTP bodies sent with a Content-Encoding.  Input is
+// fed as it arrives from the pipe, so the compressed body is never held in
+// memory in full.
+class ContentDecoder {
+ public:
+  enum class Encoding {
+    IDENTITY,
+    GZIP,
+    DEFLATE,
+    UNSUPPORTED,
+  };
+
+  // Decoded bodies larger than this are rejected, so that a misbehaving
+  // node cannot make the wallet inflate a small reply without bound.
+  static constexpr size_t kMaxDecodedSize = 256 * 1024 * 1024;
+
+  // Parses the value of a Content-Encoding header.  An empty value means
+  // identity.
+  static Encoding ParseEncoding(const std::string& value);
+
+  explicit ContentDecoder(Encoding encoding);
+  ~ContentDecoder();
+
+  // Appends the decoded form of `size` input bytes to `out`.  Returns false
+  // if the input is corrupt or too large.
+  bool update(const char* data, size_t size, std::string* out);
+
+  // Returns false if the input ended before the end of the stream.
+  bool finish() const;
+
+  // Reads the body from `fd` until EOF and decodes it into `out`.
+  // `*wire_bytes` receives the number of bytes read from the pipe.
+  bool readFrom(int fd, std::string* out, uint64_t* wire_bytes);
+
+ private:
+  // Picks the window bits from the held-back header bytes and feeds them
+  // to zlib.
+  bool start(std::string* out);
+
+  bool inflateInput(const char* data, size_t size, std::string* out);
+
+  const Encoding m_encoding;
+  z_stream m_stream;
+  bool m_stream_end;
+  bool m_initialized;
+  // Leading body bytes held back until the zlib header can be checked.
+  char m_head[2];
+  size_t m_head_size;
+
+ private:
+  ContentDecoder(const ContentDecoder&) = delete;
+  ContentDecoder& operator=(const ContentDecoder&) = delete;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_CONTENT_DECODER_H_
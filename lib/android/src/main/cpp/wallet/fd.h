@@ -8,10 +8,6 @@
 #include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/iostreams/stream.hpp>
 
-#include "common/jvm.h"
-
-#include "jni_cache.h"
-
 namespace monero {
 
 // Utility class to hold a file descriptor and call 'close' automatically
@@ -26,15 +22,6 @@ class ScopedFd {
     other.m_fd = -1;
   }
 
-  ScopedFd(JNIEnv* env, const JavaRef<jobject>& parcel_file_descriptor) {
-    if (!parcel_file_descriptor.is_null()) {
-      m_fd = CallIntMethod(env, parcel_file_descriptor.obj(),
-                           ParcelFd_detachFd);
-    } else {
-      m_fd = -1;
-    }
-  }
-
   ~ScopedFd() {
     close();
   }
@@ -43,6 +30,12 @@ class ScopedFd {
 
   bool is_valid() const { return m_fd >= 0; }
 
+  // Takes ownership of `fd`, closing the one held before.
+  void reset(int fd) {
+    close();
+    m_fd = fd;
+  }
+
   void close() {
     if (is_valid()) {
       int save_errno = errno;
@@ -0,0 +1,74 @@
+#ifndef WALLET_FEE_CACHE_H_
+#define WALLET_FEE_CACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace monero {
+
+// Caches the dynamic base fee estimate for the current chain height.  The
+// estimate is recomputed by the daemon once per block, so a cached entry is
+// valid until the wallet observes a new block or the entry expires.
+class FeeEstimateCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit FeeEstimateCache(Clock::duration max_age)
+      : m_max_age(max_age),
+        m_height(0),
+        m_hits(0),
+        m_misses(0) {}
+
+  // Returns the cached fees for `height` and updates the hit/miss counters.
+  bool lookup(uint64_t height, std::vector<uint64_t>* fees) {
+    bool found = peek(height, fees);
+    (found ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+    return found;
+  }
+
+  // Same as lookup() but leaves the counters untouched.
+  bool peek(uint64_t height, std::vector<uint64_t>* fees) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fees.empty() || m_height != height || Clock::now() - m_time >= m_max_age) {
+      return false;
+    }
+    *fees = m_fees;
+    return true;
+  }
+
+  void store(uint64_t height, const std::vector<uint64_t>& fees) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_height = height;
+    m_fees = fees;
+    m_time = Clock::now();
+  }
+
+  // Drops the entry if it was computed for a height below `height`.
+  void invalidateBelow(uint64_t height) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_height < height) {
+      m_fees.clear();
+    }
+  }
+
+  uint64_t hits() const { return m_hits.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+ private:
+  const Clock::duration m_max_age;
+
+  std::mutex m_mutex;
+  uint64_t m_height;
+  std::vector<uint64_t> m_fees;
+  Clock::time_point m_time;
+
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_FEE_CACHE_H_
@@ -1,48 +1,52 @@
 #include "http_client.h"
 
+#include <strings.h>
+
 #include "common/debug.h"
 
-#include "jni_cache.h"
+#include "block_cache.h"
+#include "block_feed.h"
+#include "content_decoder.h"
 
-namespace monero {
+#ifdef WALLET_TEST_NODES
+#include "rpc_trace.h"
+#endif
 
-bool RemoteNodeClient::set_proxy(const std::string& address) {
-  // No-op.
-  return true;
-}
+#include "storages/portable_storage_template_helper.h"
 
-void RemoteNodeClient::set_server(std::string host,
-                                  std::string port,
-                                  boost::optional<epee::net_utils::http::login> user,
-                                  epee::net_utils::ssl_options_t ssl_options) {
-  // No-op.
-}
+namespace monero {
 
-void RemoteNodeClient::set_auto_connect(bool auto_connect) {
+constexpr std::chrono::hours RemoteNodeClient::kMaxTimeout;
 
-}
+namespace {
 
-bool RemoteNodeClient::connect(std::chrono::milliseconds timeout) {
+#ifdef WALLET_TEST_NODES
+// Headers carrying credentials, left out of RPC traces.
+bool IsCredentialHeader(const std::string& name) {
+  for (const char* header: {"Authorization", "Proxy-Authorization", "Cookie"}) {
+    if (strcasecmp(name.c_str(), header) == 0) {
+      return true;
+    }
+  }
   return false;
 }
+#endif
 
-bool RemoteNodeClient::disconnect() {
-  return false;
+// Adds the blocks of a node reply to the block cache.
+void InsertIntoCache(BlockCache* cache, const GetBlocksRequest& req, const std::string& body) {
+  GetBlocksResponse res;
+  if (epee::serialization::load_t_from_binary(res, body)
+      && res.status == CORE_RPC_STATUS_OK) {
+    cache->insert(req, res);
+  }
 }
 
-bool RemoteNodeClient::is_connected(bool* ssl) {
-  return false;
-}
+}  // namespace
 
-RemoteNodeClient::HttpResponse JavaToHttpResponse(JNIEnv* env, jobject obj) {
-  jint code = CallIntMethod(env, obj, HttpResponse_getCode);
-  ScopedJavaLocalRef<jstring>
-      j_mime_type(env, CallStringMethod(env, obj, HttpResponse_getContentType));
-  ScopedJavaLocalRef<jobject>
-      j_body(env, CallObjectMethod(env, obj, HttpResponse_getBody));
-  return {code, j_mime_type.is_null() ? ""
-                                      : JavaToNativeString(env, j_mime_type.obj()),
-          ScopedFd(env, j_body)};
+RemoteNodeClient::~RemoteNodeClient() {
+  if (m_feed_joined) {
+    BlockFeed::forNetwork(m_nettype).leave(m_transport->id());
+  }
 }
 
 bool RemoteNodeClient::invoke(const boost::string_ref uri,
@@ -51,71 +55,231 @@ bool RemoteNodeClient::invoke(const boost::string_ref uri,
                               std::chrono::milliseconds timeout,
                               const epee::net_utils::http::http_response_info** ppresponse_info,
                               const epee::net_utils::http::fields_list& additional_params) {
+  const Clock::time_point deadline = (timeout.count() > 0 && timeout < kMaxTimeout)
+                                     ? Clock::now() + timeout
+                                     : Clock::time_point::max();
+  m_call_state->timed_out.store(false);
+  if (m_call_state->closing.load()) {
+    m_response_info.clear();
+    return false;
+  }
+  bool success = (uri == "/getblocks.bin")
+                 ? invokeGetBlocks(uri, method, body, additional_params, deadline)
+                 : invokeRemote(uri, method, body, additional_params, deadline);
+#ifdef WALLET_TEST_NODES
+  if (auto recorder = RpcTrace::recorder()) {
+    RpcExchange exchange;
+    exchange.method.assign(method.data(), method.size());
+    exchange.uri.assign(uri.data(), uri.size());
+    for (const auto& p: additional_params) {
+      if (IsCredentialHeader(p.first)) {
+        continue;
+      }
+      exchange.headers.append(p.first).append(": ").append(p.second).append("\r\n");
+    }
+    exchange.request_body.assign(body.data(), body.size());
+    if (success) {
+      exchange.response_code = m_response_info.m_response_code;
+      exchange.content_type = m_response_info.m_mime_tipe;
+      exchange.response_body = m_response_info.m_body;
+    }
+    recorder->append(exchange);
+  }
+#endif
+  if (success && ppresponse_info) {
+    *ppresponse_info = std::addressof(m_response_info);
+  }
+  return success;
+}
+
+// Serves block requests from the local block cache when possible.  Otherwise
+// the request goes through the network's block feed if other wallets use the
+// same transport, so that wallets sending the same request at the same time
+// share a single response from the node.
+bool RemoteNodeClient::invokeGetBlocks(const boost::string_ref uri,
+                                       const boost::string_ref method,
+                                       const boost::string_ref body,
+                                       const epee::net_utils::http::fields_list& additional_params,
+                                       Clock::time_point deadline) {
+  GetBlocksRequest req;
+  if (!epee::serialization::load_t_from_binary(req, epee::strspan<uint8_t>(body))) {
+    return invokeRemote(uri, method, body, additional_params, deadline);
+  }
+  BlockCache* cache = m_call_state->use_block_cache.load()
+                      ? BlockCache::forNetwork(m_nettype)
+                      : nullptr;
+  GetBlocksResponse res;
+  if (cache != nullptr && cache->lookup(req, &res)) {
+    epee::byte_slice res_body;
+    if (epee::serialization::store_t_to_binary(res, res_body)) {
+      setResponse(200, "application/octet-stream",
+                  std::string(reinterpret_cast<const char*>(res_body.data()),
+                              res_body.size()));
+      return true;
+    }
+  }
+  BlockFeed& feed = BlockFeed::forNetwork(m_nettype);
+  const std::string transport_id = m_transport->id();
+  if (!m_feed_joined) {
+    feed.join(transport_id);
+    m_feed_joined = true;
+  }
+  if (!feed.isShared(transport_id)) {
+    return invokeRemoteAndCache(uri, method, body, additional_params, deadline, req, cache);
+  }
+  bool remote_ok = false;
+  bool fetched;
+  auto batch = feed.fetch(
+      req,
+      transport_id,
+      [&](std::string* res_body) {
+        remote_ok = invokeRemote(uri, method, body, additional_params, deadline);
+        if (!remote_ok || m_response_info.m_response_code != 200) {
+          return false;
+        }
+        *res_body = m_response_info.m_body;
+        return true;
+      },
+      deadline,
+      &fetched);
+  if (batch) {
+    if (!fetched) {
+      setResponse(200, "application/octet-stream", batch->body());
+    } else if (cache != nullptr) {
+      InsertIntoCache(cache, req, batch->body());
+    }
+    return true;
+  }
+  if (fetched) {
+    // The node's reply, if any, is left in m_response_info as is.
+    return remote_ok;
+  }
+  if (Clock::now() >= deadline) {
+    // Gave up waiting for the wallet that fetches the range.
+    setTimedOut(uri);
+    return false;
+  }
+  // The wallet that fetched the range failed; try on our own.
+  return invokeRemoteAndCache(uri, method, body, additional_params, deadline, req, cache);
+}
+
+// Fetches blocks from the node for this wallet alone, and adds them to the
+// block cache if it is used.
+bool RemoteNodeClient::invokeRemoteAndCache(
+    const boost::string_ref uri,
+    const boost::string_ref method,
+    const boost::string_ref body,
+    const epee::net_utils::http::fields_list& additional_params,
+    Clock::time_point deadline,
+    const GetBlocksRequest& req,
+    BlockCache* cache) {
+  if (!invokeRemote(uri, method, body, additional_params, deadline)) {
+    return false;
+  }
+  if (cache != nullptr && m_response_info.m_response_code == 200) {
+    InsertIntoCache(cache, req, m_response_info.m_body);
+  }
+  return true;
+}
+
+void RemoteNodeClient::setResponse(int code, const std::string& content_type, std::string body) {
+  m_response_info.clear();
+  m_response_info.m_response_code = code;
+  m_response_info.m_mime_tipe = content_type;
+  m_response_info.m_body = std::move(body);
+}
+
+void RemoteNodeClient::setTimedOut(const boost::string_ref uri) {
+  LOGW("Call to %s timed out", std::string(uri.data(), uri.size()).c_str());
+  m_response_info.clear();
+  m_call_state->timed_out.store(true);
+}
+
+bool RemoteNodeClient::invokeRemote(const boost::string_ref uri,
+                                    const boost::string_ref method,
+                                    const boost::string_ref body,
+                                    const epee::net_utils::http::fields_list& additional_params,
+                                    Clock::time_point deadline) {
+  // Zero tells the transport that the call has no deadline.
+  int64_t timeout_ms = 0;
+  if (deadline != Clock::time_point::max()) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - Clock::now());
+    if (remaining.count() <= 0) {
+      setTimedOut(uri);
+      return false;
+    }
+    timeout_ms = remaining.count();
+  }
   std::ostringstream header;
+  bool has_accept_encoding = false;
   for (const auto& p: additional_params) {
     header << p.first << ": " << p.second << "\r\n";
+    has_accept_encoding |= strcasecmp(p.first.c_str(), "Accept-Encoding") == 0;
+  }
+  if (!has_accept_encoding) {
+    header << "Accept-Encoding: " << kAcceptEncoding << "\r\n";
   }
-  JNIEnv* env = GetJniEnv();
   try {
-    ScopedJavaLocalRef<jstring> j_method(env, NativeToJavaString(env, method.data()));
-    ScopedJavaLocalRef<jstring> j_uri(env, NativeToJavaString(env, uri.data()));
-    ScopedJavaLocalRef<jstring> j_hdr(env, NativeToJavaString(env, header.str()));
-    ScopedJavaLocalRef<jbyteArray>
-        j_body(env, NativeToJavaByteArray(env, body.data(), body.length()));
-    ScopedJavaLocalRef<jobject>
-        j_response = {env, CallObjectMethod(env,
-                                            m_wallet_native.obj(),
-                                            NativeWallet_callRemoteNode,
-                                            j_method.obj(),
-                                            j_uri.obj(),
-                                            j_hdr.obj(),
-                                            j_body.obj())};
+    NodeResponse response;
+    bool received = m_transport->call(std::string(method.data(), method.size()),
+                                      std::string(uri.data(), uri.size()),
+                                      header.str(),
+                                      body,
+                                      timeout_ms,
+                                      &response);
+    m_bytes_sent += body.length();
+    m_call_state->bytes_sent.fetch_add(body.length(), std::memory_order_relaxed);
     m_response_info.clear();
-    if (j_response.is_null()) {
+    if (!received) {
+      return false;
+    }
+    if (response.code == 408) {
+      setTimedOut(uri);
       return false;
     }
-    HttpResponse http_response = JavaToHttpResponse(env, j_response.obj());
-    if (http_response.code == 401) {
+    if (response.code == 401) {
       // Handle HTTP unauthorized in the same way as http_simple_client_template.
       return false;
     }
-    m_response_info.m_response_code = http_response.code;
-    m_response_info.m_mime_tipe = http_response.content_type;
-    if (http_response.body.is_valid()) {
-      http_response.body.read(&m_response_info.m_body);
+    m_response_info.m_response_code = response.code;
+    m_response_info.m_mime_tipe = response.content_type;
+    if (response.body_fd.is_valid() || !response.body.empty()) {
+      auto encoding = ContentDecoder::ParseEncoding(response.content_encoding);
+      if (encoding == ContentDecoder::Encoding::UNSUPPORTED) {
+        LOGW("Unsupported content encoding: %s", response.content_encoding.c_str());
+        m_response_info.clear();
+        return false;
+      }
+      ContentDecoder decoder(encoding);
+      uint64_t wire_bytes = 0;
+      bool decoded;
+      if (response.body_fd.is_valid()) {
+        decoded = decoder.readFrom(response.body_fd.fd(),
+                                   &m_response_info.m_body, &wire_bytes);
+      } else {
+        wire_bytes = response.body.size();
+        decoded = decoder.update(response.body.data(), response.body.size(),
+                                 &m_response_info.m_body)
+            && decoder.finish();
+      }
+      m_bytes_received += wire_bytes;
+      m_call_state->bytes_received.fetch_add(wire_bytes, std::memory_order_relaxed);
+      if (!decoded) {
+        m_response_info.clear();
+        return false;
+      }
+      m_call_state->bytes_decoded.fetch_add(m_response_info.m_body.size(),
+                                            std::memory_order_relaxed);
+      LOGV("Response to %s: %" PRIu64 " bytes received, %zu decoded",
+           std::string(uri.data(), uri.size()).c_str(), wire_bytes,
+           m_response_info.m_body.size());
     }
   } catch (std::runtime_error& e) {
     LOGE("Unhandled exception: %s", e.what());
     return false;
   }
-  if (ppresponse_info) {
-    *ppresponse_info = std::addressof(m_response_info);
-  }
   return true;
 }
 
-bool RemoteNodeClient::invoke_get(const boost::string_ref uri,
-                                  std::chrono::milliseconds timeout,
-                                  const std::string& body,
-                                  const epee::net_utils::http::http_response_info** ppresponse_info,
-                                  const epee::net_utils::http::fields_list& additional_params) {
-  return invoke(uri, "GET", body, timeout, ppresponse_info, additional_params);
-}
-
-bool RemoteNodeClient::invoke_post(const boost::string_ref uri,
-                                   const std::string& body,
-                                   std::chrono::milliseconds timeout,
-                                   const epee::net_utils::http::http_response_info** ppresponse_info,
-                                   const epee::net_utils::http::fields_list& additional_params) {
-  return invoke(uri, "POST", body, timeout, ppresponse_info, additional_params);
-}
-
-uint64_t RemoteNodeClient::get_bytes_sent() const {
-  return 0;
-}
-
-uint64_t RemoteNodeClient::get_bytes_received() const {
-  return 0;
-}
-
 }  // namespace monero
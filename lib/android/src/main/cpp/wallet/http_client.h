@@ -1,75 +1,186 @@
 #ifndef WALLET_HTTP_CLIENT_H_
 #define WALLET_HTTP_CLIENT_H_
 
-#include "common/jvm.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
 
+#include "block_cache.h"
 #include "fd.h"
 
+#include "cryptonote_config.h"
 #include "net/abstract_http_client.h"
 
 namespace monero {
 
 using AbstractHttpClient = epee::net_utils::http::abstract_http_client;
 
-class RemoteNodeClient : public AbstractHttpClient {
+// Outcome of the last call made by the clients of a wallet.  wallet2 turns
+// every failed call into the same error, so the wallet checks here why.
+//
+// Also counts the traffic of all the clients: bytes received are counted as
+// they come off the wire, before decoding, and bytes decoded after.
+struct RemoteNodeCallState {
+  std::atomic<bool> timed_out{false};
+  // Set when the wallet is closing.  Calls fail from then on, so that a
+  // refresh ends even if it started after wallet2::stop() was called.
+  std::atomic<bool> closing{false};
+  // Whether block requests may be served from and added to the BlockCache.
+  std::atomic<bool> use_block_cache{false};
+  std::atomic<uint64_t> bytes_sent{0};
+  std::atomic<uint64_t> bytes_received{0};
+  std::atomic<uint64_t> bytes_decoded{0};
+};
+
+// Reply to a call made through a NodeTransport.  The body is read from
+// `body_fd` until EOF when the fd is valid, else taken from `body`.
+struct NodeResponse {
+  int code = 0;
+  std::string content_type;
+  std::string content_encoding;
+  ScopedFd body_fd;
+  std::string body;
+};
+
+// Carries the calls of RemoteNodeClient to the node.  The Android library
+// routes them through the Kotlin RPC client; hosts of the C API supply their
+// own.  Called from refresh threads, possibly from several at once.
+class NodeTransport {
  public:
-  RemoteNodeClient(JNIEnv* env, const JavaRef<jobject>& wallet_native) :
-      m_wallet_native(env, wallet_native) {}
+  virtual ~NodeTransport() = default;
+
+  // Identifies where calls go: transports with the same id must reach the
+  // same node, or choose from the same set of nodes.  Block responses are
+  // only shared between wallets whose transports have the same id.  By
+  // default every transport has its own.
+  virtual std::string id() const {
+    const NodeTransport* self = this;
+    return std::string(reinterpret_cast<const char*>(&self), sizeof(self));
+  }
+
+  // `header` holds "Name: value\r\n" lines.  A zero `timeout_ms` means no
+  // deadline.  Returns false if no response was received.
+  virtual bool call(const std::string& method,
+                    const std::string& uri,
+                    const std::string& header,
+                    const boost::string_ref body,
+                    int64_t timeout_ms,
+                    NodeResponse* response) = 0;
+};
 
-  bool set_proxy(const std::string& address) override;
+// Base of the clients wallet2 sends its node calls through.  They never
+// hold a connection of their own, so the connection calls do nothing, and
+// GET and POST calls go through invoke().  Subclasses count their traffic
+// in m_bytes_sent and m_bytes_received.
+class NodeClientBase : public AbstractHttpClient {
+ public:
+  bool set_proxy(const std::string& address) override { return true; }
   void set_server(std::string host,
                   std::string port,
                   boost::optional<epee::net_utils::http::login> user,
-                  epee::net_utils::ssl_options_t ssl_options) override;
-  void set_auto_connect(bool auto_connect) override;
-  bool connect(std::chrono::milliseconds timeout) override;
-  bool disconnect() override;
-  bool is_connected(bool* ssl) override;
-  bool invoke(const boost::string_ref uri,
-              const boost::string_ref method,
-              const boost::string_ref body,
-              std::chrono::milliseconds timeout,
-              const epee::net_utils::http::http_response_info** ppresponse_info,
-              const epee::net_utils::http::fields_list& additional_params) override;
+                  epee::net_utils::ssl_options_t ssl_options) override {}
+  void set_auto_connect(bool auto_connect) override {}
+  bool connect(std::chrono::milliseconds timeout) override { return false; }
+  bool disconnect() override { return false; }
+  bool is_connected(bool* ssl) override { return false; }
   bool invoke_get(const boost::string_ref uri,
                   std::chrono::milliseconds timeout,
                   const std::string& body,
                   const epee::net_utils::http::http_response_info** ppresponse_info,
-                  const epee::net_utils::http::fields_list& additional_params) override;
+                  const epee::net_utils::http::fields_list& additional_params) override {
+    return invoke(uri, "GET", body, timeout, ppresponse_info, additional_params);
+  }
   bool invoke_post(const boost::string_ref uri,
                    const std::string& body,
                    std::chrono::milliseconds timeout,
                    const epee::net_utils::http::http_response_info** ppresponse_info,
-                   const epee::net_utils::http::fields_list& additional_params) override;
-  uint64_t get_bytes_sent() const override;
-  uint64_t get_bytes_received() const override;
+                   const epee::net_utils::http::fields_list& additional_params) override {
+    return invoke(uri, "POST", body, timeout, ppresponse_info, additional_params);
+  }
+  uint64_t get_bytes_sent() const override { return m_bytes_sent; }
+  uint64_t get_bytes_received() const override { return m_bytes_received; }
+
+ protected:
+  uint64_t m_bytes_sent = 0;
+  uint64_t m_bytes_received = 0;
+};
 
+class RemoteNodeClient : public NodeClientBase {
  public:
-  struct HttpResponse {
-    int code;
-    std::string content_type;
-    ScopedFd body;
-  };
+  using Clock = std::chrono::steady_clock;
+
+  // Timeouts longer than this are treated as no deadline at all.
+  static constexpr std::chrono::hours kMaxTimeout{24};
+
+  RemoteNodeClient(cryptonote::network_type nettype,
+                   std::shared_ptr<NodeTransport> transport,
+                   std::shared_ptr<RemoteNodeCallState> call_state) :
+      m_nettype(nettype),
+      m_transport(std::move(transport)),
+      m_call_state(std::move(call_state)),
+      m_feed_joined(false) {}
+
+  ~RemoteNodeClient() override;
+
+  bool invoke(const boost::string_ref uri,
+              const boost::string_ref method,
+              const boost::string_ref body,
+              std::chrono::milliseconds timeout,
+              const epee::net_utils::http::http_response_info** ppresponse_info,
+              const epee::net_utils::http::fields_list& additional_params) override;
 
  private:
-  const ScopedJavaGlobalRef<jobject> m_wallet_native;
+  bool invokeRemote(const boost::string_ref uri,
+                    const boost::string_ref method,
+                    const boost::string_ref body,
+                    const epee::net_utils::http::fields_list& additional_params,
+                    Clock::time_point deadline);
+  bool invokeGetBlocks(const boost::string_ref uri,
+                       const boost::string_ref method,
+                       const boost::string_ref body,
+                       const epee::net_utils::http::fields_list& additional_params,
+                       Clock::time_point deadline);
+  bool invokeRemoteAndCache(const boost::string_ref uri,
+                            const boost::string_ref method,
+                            const boost::string_ref body,
+                            const epee::net_utils::http::fields_list& additional_params,
+                            Clock::time_point deadline,
+                            const GetBlocksRequest& req,
+                            BlockCache* cache);
+  void setTimedOut(const boost::string_ref uri);
+  void setResponse(int code, const std::string& content_type, std::string body);
+
+  const cryptonote::network_type m_nettype;
+  const std::shared_ptr<NodeTransport> m_transport;
+  const std::shared_ptr<RemoteNodeCallState> m_call_state;
   epee::net_utils::http::http_response_info m_response_info;
+
+  // Whether this client has joined the block feed of its transport, which it
+  // does on its first block request.
+  bool m_feed_joined;
 };
 
 using HttpClientFactory = epee::net_utils::http::http_client_factory;
 
 class RemoteNodeClientFactory : public HttpClientFactory {
  public:
-  RemoteNodeClientFactory(JNIEnv* env, const JavaRef<jobject>& wallet_native) :
-      m_wallet_native(env, wallet_native) {}
+  RemoteNodeClientFactory(cryptonote::network_type nettype,
+                          std::shared_ptr<NodeTransport> transport,
+                          std::shared_ptr<RemoteNodeCallState> call_state) :
+      m_nettype(nettype),
+      m_transport(std::move(transport)),
+      m_call_state(std::move(call_state)) {}
 
   std::unique_ptr<AbstractHttpClient> create() override {
     return std::unique_ptr<AbstractHttpClient>(
-        new RemoteNodeClient(GetJniEnv(), m_wallet_native));
+        new RemoteNodeClient(m_nettype, m_transport, m_call_state));
   }
 
  private:
-  const ScopedJavaGlobalRef<jobject> m_wallet_native;
+  const cryptonote::network_type m_nettype;
+  const std::shared_ptr<NodeTransport> m_transport;
+  const std::shared_ptr<RemoteNodeCallState> m_call_state;
 };
 
 }  // namespace monero
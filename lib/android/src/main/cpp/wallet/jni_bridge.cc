@@ -0,0 +1,770 @@
+#include <algorithm>
+
+#include <boost/iostreams/device/file_descriptor.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include "common/debug.h"
+#include "common/java_native.h"
+
+#include "block_cache.h"
+#include "block_time_table.h"
+#include "checkpoint_chain.h"
+#include "jni_cache.h"
+#include "lock_profiler.h"
+#include "refresh_scheduler.h"
+#include "transfer.h"
+#include "wallet.h"
+
+#include "string_tools.h"
+
+#ifdef WALLET_TEST_NODES
+#include "rpc_trace.h"
+#include "synthetic_chain.h"
+#endif
+
+namespace io = boost::iostreams;
+
+namespace monero {
+
+using namespace epee::string_tools;
+
+// JNI glue of the Android library.  The wallet core knows nothing of the JVM:
+// node calls and refresh events reach the Kotlin NativeWallet through the
+// NodeTransport and WalletListener implemented here.
+
+void JavaToNodeResponse(JNIEnv* env, jobject obj, NodeResponse* response) {
+  response->code = CallIntMethod(env, obj, HttpResponse_getCode);
+  ScopedJavaLocalRef<jstring>
+      j_mime_type(env, CallStringMethod(env, obj, HttpResponse_getContentType));
+  ScopedJavaLocalRef<jstring>
+      j_encoding(env, CallStringMethod(env, obj, HttpResponse_getContentEncoding));
+  ScopedJavaLocalRef<jobject>
+      j_body(env, CallObjectMethod(env, obj, HttpResponse_getBody));
+  if (!j_mime_type.is_null()) {
+    response->content_type = JavaToNativeString(env, j_mime_type.obj());
+  }
+  if (!j_encoding.is_null()) {
+    response->content_encoding = JavaToNativeString(env, j_encoding.obj());
+  }
+  if (!j_body.is_null()) {
+    response->body_fd.reset(CallIntMethod(env, j_body.obj(), ParcelFd_detachFd));
+  }
+}
+
+// Calls the node through NativeWallet.callRemoteNode(), which streams the
+// body back over a pipe.  Wallets created with the same RPC client get the
+// same `rpc_client_id`.
+class JvmNodeTransport : public NodeTransport {
+ public:
+  JvmNodeTransport(JNIEnv* env, const JavaRef<jobject>& wallet_native, jlong rpc_client_id)
+      : m_wallet_native(env, wallet_native),
+        m_rpc_client_id(rpc_client_id) {}
+
+  std::string id() const override {
+    return "jvm:" + std::to_string(m_rpc_client_id);
+  }
+
+  bool call(const std::string& method,
+            const std::string& uri,
+            const std::string& header,
+            const boost::string_ref body,
+            int64_t timeout_ms,
+            NodeResponse* response) override {
+    JNIEnv* env = GetJniEnv();
+    ScopedJavaLocalRef<jstring> j_method(env, NativeToJavaString(env, method));
+    ScopedJavaLocalRef<jstring> j_uri(env, NativeToJavaString(env, uri));
+    ScopedJavaLocalRef<jstring> j_hdr(env, NativeToJavaString(env, header));
+    ScopedJavaLocalRef<jbyteArray>
+        j_body(env, NativeToJavaByteArray(env, body.data(), body.length()));
+    ScopedJavaLocalRef<jobject>
+        j_response = {env, CallObjectMethod(env,
+                                            m_wallet_native.obj(),
+                                            NativeWallet_callRemoteNode,
+                                            j_method.obj(),
+                                            j_uri.obj(),
+                                            j_hdr.obj(),
+                                            j_body.obj(),
+                                            static_cast<jlong>(timeout_ms))};
+    if (j_response.is_null()) {
+      return false;
+    }
+    JavaToNodeResponse(env, j_response.obj(), response);
+    return true;
+  }
+
+ private:
+  const ScopedJavaGlobalRef<jobject> m_wallet_native;
+  const jlong m_rpc_client_id;
+};
+
+class JvmWalletListener : public WalletListener {
+ public:
+  JvmWalletListener(JNIEnv* env, const JavaRef<jobject>& wallet_native)
+      : m_wallet_native(env, wallet_native) {}
+
+  void onRefresh(uint32_t height, uint64_t timestamp, bool balance_changed) override {
+    CallVoidMethod(GetJniEnv(), m_wallet_native.obj(), NativeWallet_onRefresh,
+                   static_cast<jint>(height), static_cast<jlong>(timestamp),
+                   static_cast<jboolean>(balance_changed));
+  }
+
+  void onRefreshResult(Wallet::Status status) override {
+    CallVoidMethod(GetJniEnv(), m_wallet_native.obj(), NativeWallet_onRefreshResult,
+                   static_cast<jint>(status));
+  }
+
+  void onSuspendRefresh(bool suspended) override {
+    CallVoidMethod(GetJniEnv(), m_wallet_native.obj(), NativeWallet_onSuspendRefresh,
+                   static_cast<jboolean>(suspended));
+  }
+
+ private:
+  const ScopedJavaGlobalRef<jobject> m_wallet_native;
+};
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreate(
+    JNIEnv* env,
+    jobject thiz,
+    jint network_id,
+    jlong rpc_client_id) {
+  JavaParamRef<jobject> wallet_native(thiz);
+  auto* wallet = new Wallet(network_id,
+                            std::make_shared<JvmNodeTransport>(env, wallet_native,
+                                                               rpc_client_id),
+                            std::make_unique<JvmWalletListener>(env, wallet_native));
+  return NativeToJavaPointer(wallet);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeDispose(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  delete reinterpret_cast<Wallet*>(handle);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeRestoreAccount(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jbyteArray j_secret_scalar,
+    jlong restore_point) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  SecretBuffer secret_scalar = JavaToNativeSecretByteArray(env, j_secret_scalar);
+  wallet->restoreAccount(secret_scalar, restore_point);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeLoad(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jint fd) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  io::stream<io::file_descriptor_source> in_stream(fd, io::never_close_handle);
+  return wallet->parseFrom(in_stream);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeSave(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle, jint fd) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  io::stream<io::file_descriptor_sink> out_stream(fd, io::never_close_handle);
+  return wallet->writeTo(out_stream);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeScheduleRefresh(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jboolean skip_coinbase,
+    jboolean background) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  RefreshScheduler::instance()->schedule(
+      wallet, skip_coinbase,
+      background ? RefreshScheduler::BACKGROUND : RefreshScheduler::FOREGROUND);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeEnableCompactTransfers(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  wallet->enableCompactTransfers();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeEnableBlockCache(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  wallet->enableBlockCache();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeCancelRefresh(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  wallet->cancelRefresh();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeSetRefreshSince(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jlong height_or_timestamp) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  wallet->setRefreshSince(height_or_timestamp);
+}
+
+extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetSpendSecretKey(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  auto key = wallet->spend_secret_key();
+  return NativeToJavaByteArray(env, key.data, sizeof(key.data));
+}
+
+extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetViewSecretKey(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  auto key = wallet->view_secret_key();
+  return NativeToJavaByteArray(env, key.data, sizeof(key.data));
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetPublicAddress(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  return NativeToJavaString(env, wallet->public_address());
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeDumpStats(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  return NativeToJavaString(env, wallet->dumpStats());
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeAddDetachedSubAddress(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jint sub_address_major,
+    jint sub_address_minor) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  return NativeToJavaString(
+      env, wallet->addDetachedSubAddress(sub_address_major, sub_address_minor));
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreateSubAddressAccount(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  return NativeToJavaString(env, wallet->createSubAddressAccount());
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreateSubAddress(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jint sub_address_major) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  try {
+    return NativeToJavaString(env, wallet->createSubAddress(sub_address_major));
+  } catch (error::account_index_outofbound& e) {
+    return nullptr;
+  }
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetSubAddresses(
+    JNIEnv* env,
+    jobject thiz,
+    jint sub_address_major,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  try {
+    auto subaddresses = wallet->formatted_subaddresses(sub_address_major);
+    return NativeToJavaStringArray(env, subaddresses);
+  } catch (error::account_index_outofbound& e) {
+    return NativeToJavaStringArray(env, {});
+  }
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetCurrentBlockchainHeight(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  return wallet->current_blockchain_height();
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetCurrentBlockchainTimestamp(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  return wallet->current_blockchain_timestamp();
+}
+
+ScopedJavaLocalRef<jobject> NativeToJavaTxInfo(JNIEnv* env,
+                                               const TxHistory& txs,
+                                               size_t i) {
+  LOG_FATAL_IF(txs.height(i) >= CRYPTONOTE_MAX_BLOCK_NUMBER,
+               "Blockchain max height reached");
+  // TODO: Check amount overflow
+  const std::string& recipient = txs.recipient(i);
+  return {env, NewObject(
+      env,
+      TxInfoClass.obj(), TxInfo_ctor,
+      ScopedJavaLocalRef<jstring>(
+          env, NativeToJavaString(env, pod_to_hex(txs.tx_hash(i)))).obj(),
+      txs.public_key_known(i) ? ScopedJavaLocalRef<jstring>(
+          env, NativeToJavaString(env, pod_to_hex(txs.public_key(i)))).obj()
+                              : nullptr,
+      txs.key_image_known(i) ? ScopedJavaLocalRef<jstring>(
+          env, NativeToJavaString(env, pod_to_hex(txs.key_image(i)))).obj()
+                             : nullptr,
+      txs.subaddress_major(i),
+      txs.subaddress_minor(i),
+      (!recipient.empty()) ? ScopedJavaLocalRef<jstring>(
+          env, NativeToJavaString(env, recipient)).obj()
+                           : nullptr,
+      txs.amount(i),
+      static_cast<jint>(txs.height(i)),
+      txs.unlock_time(i),
+      txs.timestamp(i),
+      txs.fee(i),
+      txs.change(i),
+      static_cast<jbyte>(txs.state(i)),
+      txs.coinbase(i),
+      txs.type(i) == TxInfo::INCOMING)
+  };
+}
+
+// Returns the rows at or above the height from which the history changed
+// since the snapshot of `since_generation`, or null if it did not change.
+// Stores the current generation and that height in `j_out`, with unconfirmed
+// rows at Long.MAX_VALUE.
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetTxHistoryChanges(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jlong since_generation,
+    jlongArray j_out) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  jobjectArray j_array = nullptr;
+  static LockSite site("tx_history", "nativeGetTxHistoryChanges");
+  wallet->withTxHistory(site, [&](TxHistory const& txs) {
+    uint64_t height;
+    if (!wallet->txHistoryChangedSince(static_cast<uint32_t>(since_generation), &height)) {
+      return;
+    }
+    const size_t first = txs.first_row_at(height);
+    j_array = env->NewObjectArray(txs.size() - first, TxInfoClass.obj(), nullptr);
+    ThrowRuntimeErrorOnException(env);
+    for (size_t i = first; i < txs.size(); ++i) {
+      env->SetObjectArrayElement(j_array, i - first, NativeToJavaTxInfo(env, txs, i).obj());
+    }
+    jlong out[] = {txs.generation(),
+                   static_cast<jlong>(std::min<uint64_t>(height, INT64_MAX))};
+    env->SetLongArrayRegion(j_out, 0, 2, out);
+  });
+  return j_array;
+}
+
+// Flattened as [pending, unlocked, n, (height, amount) * n, m, (timestamp, amount) * m].
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetBalance(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jint account_index,
+    jint subaddress_index) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  BalanceAggregate balance = wallet->queryBalance(account_index, subaddress_index);
+  std::vector<uint64_t> flat = {balance.pending, balance.unlocked};
+  for (const auto* buckets: {&balance.locked_until_height, &balance.locked_until_timestamp}) {
+    flat.push_back(buckets->size());
+    for (const auto& bucket: *buckets) {
+      flat.push_back(bucket.first);
+      flat.push_back(bucket.second);
+    }
+  }
+  return NativeToJavaLongArray(env, flat.data(), flat.size());
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeQueryTxHistory(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jint account_index,
+    jint subaddress_index,
+    jint direction,
+    jint state_mask,
+    jlong min_height,
+    jlong max_height,
+    jlong min_timestamp,
+    jlong max_timestamp,
+    jint order,
+    jlong cursor,
+    jint limit,
+    jlongArray j_next_cursor) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  TxHistoryQuery query;
+  query.account = static_cast<uint32_t>(account_index);
+  query.subaddress = static_cast<uint32_t>(subaddress_index);
+  query.direction = direction;
+  query.state_mask = static_cast<uint32_t>(state_mask);
+  query.min_height = static_cast<uint64_t>(min_height);
+  query.max_height = static_cast<uint64_t>(max_height);
+  query.min_timestamp = static_cast<uint64_t>(min_timestamp);
+  query.max_timestamp = static_cast<uint64_t>(max_timestamp);
+  query.order = static_cast<TxHistoryQuery::Order>(order);
+  jobjectArray j_array = nullptr;
+  static LockSite site("tx_history", "nativeQueryTxHistory");
+  wallet->withTxHistory(site, [&](TxHistory const& txs) {
+    TxHistoryPage page;
+    if (!txs.query(query, static_cast<uint64_t>(cursor), limit, &page)) {
+      return;
+    }
+    // Rows are converted under the history lock, as the page only holds
+    // row numbers into this snapshot.
+    j_array = env->NewObjectArray(page.rows.size(), TxInfoClass.obj(), nullptr);
+    ThrowRuntimeErrorOnException(env);
+    for (size_t i = 0; i < page.rows.size(); ++i) {
+      env->SetObjectArrayElement(j_array, i, NativeToJavaTxInfo(env, txs, page.rows[i]).obj());
+    }
+    jlong next_cursor = static_cast<jlong>(page.next_cursor);
+    env->SetLongArrayRegion(j_next_cursor, 0, 1, &next_cursor);
+  });
+  return j_array;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreatePayment(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jobjectArray j_addresses,
+    jlongArray j_amounts,
+    jint priority,
+    jint account_index,
+    jintArray j_subaddr_indexes,
+    jobject j_callback) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+
+  const auto& addresses = JavaToNativeVector<std::string, jstring>(
+      env, j_addresses, &JavaToNativeString);
+  const auto& amounts = JavaToNativeLongArray(env, j_amounts);
+  const auto& subaddr_indexes = JavaToNativeIntArray(env, j_subaddr_indexes);
+
+  std::unique_ptr<PendingTransfer> pending_transfer;
+
+  try {
+    pending_transfer = wallet->createPayment(
+        addresses,
+        {amounts.begin(), amounts.end()},
+        priority,
+        account_index,
+        {subaddr_indexes.begin(), subaddr_indexes.end()});
+//  } catch (error::daemon_busy& e) {
+//  } catch (error::no_connection_to_daemon& e) {
+//  } catch (error::wallet_rpc_error& e) {
+//  } catch (error::get_outs_error& e) {
+//  } catch (error::not_enough_unlocked_money& e) {
+//  } catch (error::not_enough_money& e) {
+//  } catch (error::tx_not_possible& e) {
+//  } catch (error::not_enough_outs_to_mix& e) {
+//  } catch (error::tx_not_constructed& e) {
+//  } catch (error::tx_rejected& e) {
+//  } catch (error::tx_sum_overflow& e) {
+//  } catch (error::zero_amount& e) {
+//  } catch (error::zero_destination& e) {
+//  } catch (error::tx_too_big& e) {
+//  } catch (error::transfer_error& e) {
+//  } catch (error::wallet_internal_error& e) {
+//  } catch (error::wallet_logic_error& e) {
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    CallVoidMethod(env, j_callback,
+                   ITransferCallback_onUnexpectedError,
+                   NativeToJavaString(env, e.what()));
+    return;
+  }
+
+  PendingTransfer* ptr = pending_transfer.release();
+
+  jobject j_pending_transfer = CallObjectMethod(
+      env, thiz,
+      NativeWallet_createPendingTransfer,
+      NativeToJavaPointer(ptr),
+      ptr->amount(),
+      ptr->fee(),
+      ptr->txCount());
+
+  CallVoidMethod(env, j_callback,
+                 ITransferCallback_onTransferCreated, j_pending_transfer);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeCommitPendingTransfer(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle,
+    jlong transfer_handle,
+    jobject j_callback) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  auto* pending_transfer = reinterpret_cast<PendingTransfer*>(transfer_handle);
+
+  try {
+    wallet->commit_transfer(*pending_transfer);
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    CallVoidMethod(env, j_callback,
+                   ITransferCallback_onUnexpectedError,
+                   NativeToJavaString(env, e.what()));
+    return;
+  }
+
+  CallVoidMethod(env, j_callback, ITransferCallback_onTransferCommitted);
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_nativeFetchBaseFeeEstimate(
+    JNIEnv* env,
+    jobject thiz,
+    jlong handle) {
+  auto* wallet = reinterpret_cast<Wallet*>(handle);
+  std::vector<uint64_t> fees = wallet->fetchBaseFeeEstimate();
+  return NativeToJavaLongArray(env, fees.data(), fees.size());
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeWallet_00024NativePendingTransfer_nativeDispose(
+    JNIEnv* env,
+    jobject thiz,
+    jlong transfer_handle) {
+  delete reinterpret_cast<PendingTransfer*>(transfer_handle);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeBlockCache_nativeConfigure(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_path,
+    jlong max_size_bytes) {
+  return BlockCache::configure(JavaToNativeString(env, j_path), max_size_bytes);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeCheckpointChain_nativeLoad(
+    JNIEnv* env,
+    jobject thiz,
+    jint network_id,
+    jint fd) {
+  const auto nettype = static_cast<cryptonote::network_type>(network_id);
+  return CheckpointChain::forNetwork(nettype).loadFrom(fd);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeBlockTimeTable_nativeLoad(
+    JNIEnv* env,
+    jobject thiz,
+    jint network_id,
+    jint fd,
+    jlong offset,
+    jlong length) {
+  if (offset < 0 || length < 0) {
+    return false;
+  }
+  const auto nettype = static_cast<cryptonote::network_type>(network_id);
+  return BlockTimeTable::forNetwork(nettype).loadFrom(fd, static_cast<off_t>(offset),
+                                                      static_cast<size_t>(length));
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeBlockTimeTable_nativeConfigure(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_path) {
+  return BlockTimeTable::configure(JavaToNativeString(env, j_path));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeLockProfiler_nativeSetSamplePeriod(
+    JNIEnv* env,
+    jobject thiz,
+    jint period) {
+  LockProfiler::setSamplePeriod(static_cast<uint32_t>(std::max(period, 0)));
+}
+
+#ifdef WALLET_TEST_NODES
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeRpcTrace_nativeStartRecording(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_path) {
+  return RpcTrace::startRecording(JavaToNativeString(env, j_path));
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeRpcTrace_nativeStartReplay(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_path) {
+  return RpcTrace::startReplay(JavaToNativeString(env, j_path));
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeRpcTrace_nativeStop(
+    JNIEnv* env,
+    jobject thiz) {
+  return RpcTrace::stop();
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_molly_monero_sdk_internal_NativeSyntheticChain_nativeServe(
+    JNIEnv* env,
+    jobject thiz,
+    jint network_id,
+    jstring j_address,
+    jbyteArray j_view_secret_key,
+    jlong seed,
+    jlong blocks,
+    jint txs_per_block,
+    jint outputs_per_tx,
+    jint owned_per_mille,
+    jint accounts,
+    jint subaddresses_per_account,
+    jlong min_amount,
+    jlong max_amount) {
+  const auto nettype = static_cast<cryptonote::network_type>(network_id);
+  cryptonote::address_parse_info info;
+  if (!cryptonote::get_account_address_from_str(info, nettype,
+                                                JavaToNativeString(env, j_address))) {
+    LOGE("Invalid address for synthetic chain");
+    return false;
+  }
+  SecretBuffer view_secret_key = JavaToNativeSecretByteArray(env, j_view_secret_key);
+  crypto::secret_key key;
+  if (view_secret_key.size() != sizeof(key.data)) {
+    LOGE("View secret key size mismatch");
+    return false;
+  }
+  std::copy(view_secret_key.begin(), view_secret_key.end(), key.data);
+  SyntheticChainParams params;
+  params.seed = static_cast<uint64_t>(seed);
+  params.blocks = static_cast<uint64_t>(std::max<jlong>(blocks, 0));
+  params.txs_per_block = static_cast<uint32_t>(std::max(txs_per_block, 0));
+  params.outputs_per_tx = static_cast<uint32_t>(std::max(outputs_per_tx, 0));
+  params.owned_per_mille = static_cast<uint32_t>(std::max(owned_per_mille, 0));
+  params.accounts = static_cast<uint32_t>(std::max(accounts, 1));
+  params.subaddresses_per_account = static_cast<uint32_t>(std::max(subaddresses_per_account, 1));
+  params.min_amount = static_cast<uint64_t>(std::max<jlong>(min_amount, 0));
+  params.max_amount = static_cast<uint64_t>(std::max<jlong>(max_amount, 0));
+  SyntheticNode::serve(std::make_shared<SyntheticChain>(nettype, info.address, key, params));
+  return true;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeSyntheticChain_nativeReorg(
+    JNIEnv* env,
+    jobject thiz,
+    jlong depth,
+    jlong count) {
+  if (auto chain = SyntheticNode::chain()) {
+    chain->reorg(static_cast<uint64_t>(std::max<jlong>(depth, 0)),
+                 static_cast<uint64_t>(std::max<jlong>(count, 0)));
+  }
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_im_molly_monero_sdk_internal_NativeSyntheticChain_nativeGetStats(
+    JNIEnv* env,
+    jobject thiz) {
+  uint64_t stats[3] = {0, 0, 0};
+  if (auto chain = SyntheticNode::chain()) {
+    stats[0] = chain->height();
+    stats[1] = chain->ownedOutputs();
+    stats[2] = chain->ownedAmount();
+  }
+  return NativeToJavaLongArray(env, stats, 3);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_molly_monero_sdk_internal_NativeSyntheticChain_nativeStop(
+    JNIEnv* env,
+    jobject thiz) {
+  SyntheticNode::stop();
+}
+#endif
+
+}  // namespace monero
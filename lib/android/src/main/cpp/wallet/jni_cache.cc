@@ -5,6 +5,7 @@ namespace monero {
 // im.molly.monero.sdk
 jmethodID HttpResponse_getBody;
 jmethodID HttpResponse_getCode;
+jmethodID HttpResponse_getContentEncoding;
 jmethodID HttpResponse_getContentType;
 jmethodID ITransferCallback_onTransferCreated;
 jmethodID ITransferCallback_onTransferCommitted;
@@ -14,6 +15,7 @@ jmethodID TxInfo_ctor;
 jmethodID NativeWallet_createPendingTransfer;
 jmethodID NativeWallet_callRemoteNode;
 jmethodID NativeWallet_onRefresh;
+jmethodID NativeWallet_onRefreshResult;
 jmethodID NativeWallet_onSuspendRefresh;
 ScopedJavaGlobalRef<jclass> TxInfoClass;
 
@@ -37,6 +39,9 @@ void InitializeJniCache(JNIEnv* env) {
   HttpResponse_getCode = GetMethodId(
       env, httpResponse,
       "getCode", "()I");
+  HttpResponse_getContentEncoding = GetMethodId(
+      env, httpResponse,
+      "getContentEncoding", "()Ljava/lang/String;");
   HttpResponse_getContentType = GetMethodId(
       env, httpResponse,
       "getContentType", "()Ljava/lang/String;");
@@ -63,10 +68,13 @@ void InitializeJniCache(JNIEnv* env) {
   NativeWallet_callRemoteNode = GetMethodId(
       env, nativeWallet,
       "callRemoteNode",
-      "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;[B)Lim/molly/monero/sdk/internal/HttpResponse;");
+      "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;[BJ)Lim/molly/monero/sdk/internal/HttpResponse;");
   NativeWallet_onRefresh = GetMethodId(
       env, nativeWallet,
       "onRefresh", "(IJZ)V");
+  NativeWallet_onRefreshResult = GetMethodId(
+      env, nativeWallet,
+      "onRefreshResult", "(I)V");
   NativeWallet_onSuspendRefresh = GetMethodId(
       env, nativeWallet,
       "onSuspendRefresh", "(Z)V");
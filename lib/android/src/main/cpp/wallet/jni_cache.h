@@ -12,6 +12,7 @@ void InitializeJniCache(JNIEnv* env);
 // im.molly.monero.sdk
 extern jmethodID HttpResponse_getBody;
 extern jmethodID HttpResponse_getCode;
+extern jmethodID HttpResponse_getContentEncoding;
 extern jmethodID HttpResponse_getContentType;
 extern jmethodID ITransferCallback_onTransferCreated;
 extern jmethodID ITransferCallback_onTransferCommitted;
@@ -21,6 +22,7 @@ extern jmethodID TxInfo_ctor;
 extern jmethodID NativeWallet_callRemoteNode;
 extern jmethodID NativeWallet_createPendingTransfer;
 extern jmethodID NativeWallet_onRefresh;
+extern jmethodID NativeWallet_onRefreshResult;
 extern jmethodID NativeWallet_onSuspendRefresh;
 extern ScopedJavaGlobalRef<jclass> TxInfoClass;
 
@@ -0,0 +1,101 @@
+#include "ledger_summary.h"
+
+#include <cstring>
+
+namespace monero {
+
+namespace {
+
+// Protobuf wire types.
+constexpr uint32_t kVarint = 0;
+constexpr uint32_t kLengthDelimited = 2;
+
+void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void PutTag(uint32_t field, uint32_t wire_type, std::string* out) {
+  PutVarint((field << 3) | wire_type, out);
+}
+
+// proto3 leaves out fields holding their default value.
+void PutUint64Field(uint32_t field, uint64_t value, std::string* out) {
+  if (value != 0) {
+    PutTag(field, kVarint, out);
+    PutVarint(value, out);
+  }
+}
+
+void PutBytesField(uint32_t field, const void* data, size_t size, std::string* out) {
+  if (size != 0) {
+    PutTag(field, kLengthDelimited, out);
+    PutVarint(size, out);
+    out->append(static_cast<const char*>(data), size);
+  }
+}
+
+void EncodeOwnedTxOutProto(const LedgerSummary::OwnedTxOut& txo, std::string* out) {
+  PutBytesField(1, txo.tx_id.data, sizeof(txo.tx_id.data), out);
+  PutUint64Field(2, txo.amount, out);
+  PutUint64Field(3, txo.block_height, out);
+  PutUint64Field(4, txo.spent_height, out);
+  PutUint64Field(5, txo.spent_in_pool, out);
+}
+
+}  // namespace
+
+void EncodeLedgerProto(const LedgerSummary& summary, std::string* out) {
+  out->clear();
+  out->reserve(summary.public_address.size() + 16 + summary.owned_tx_outs.size() * 56);
+  PutBytesField(1, summary.public_address.data(), summary.public_address.size(), out);
+  PutUint64Field(2, summary.block_height, out);
+  std::string txo_buf;
+  for (const auto& txo: summary.owned_tx_outs) {
+    txo_buf.clear();
+    EncodeOwnedTxOutProto(txo, &txo_buf);
+    // Always written, as an empty message still counts as an element.
+    PutTag(3, kLengthDelimited, out);
+    PutVarint(txo_buf.size(), out);
+    out->append(txo_buf);
+  }
+}
+
+void WriteLedgerSummaryHeader(const LedgerSummary& summary, std::ostream& output) {
+  std::string proto;
+  EncodeLedgerProto(summary, &proto);
+  const auto size = static_cast<uint32_t>(proto.size());
+  char size_le[sizeof(uint32_t)];
+  for (size_t i = 0; i < sizeof(size_le); ++i) {
+    size_le[i] = static_cast<char>((size >> (8 * i)) & 0xff);
+  }
+  output.write(kLedgerSummaryMagic, sizeof(kLedgerSummaryMagic));
+  output.write(size_le, sizeof(size_le));
+  output.write(proto.data(), proto.size());
+}
+
+bool SkipLedgerSummaryHeader(const std::string& data, size_t* archive_offset) {
+  *archive_offset = 0;
+  if (data.size() < sizeof(kLedgerSummaryMagic)
+      || memcmp(data.data(), kLedgerSummaryMagic, sizeof(kLedgerSummaryMagic)) != 0) {
+    return true;
+  }
+  if (data.size() < kLedgerSummaryHeaderSize) {
+    return false;
+  }
+  uint32_t size = 0;
+  for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+    size |= static_cast<uint32_t>(
+        static_cast<uint8_t>(data[sizeof(kLedgerSummaryMagic) + i])) << (8 * i);
+  }
+  if (data.size() - kLedgerSummaryHeaderSize < size) {
+    return false;
+  }
+  *archive_offset = kLedgerSummaryHeaderSize + size;
+  return true;
+}
+
+}  // namespace monero
@@ -0,0 +1,50 @@
+#ifndef WALLET_LEDGER_SUMMARY_H_
+#define WALLET_LEDGER_SUMMARY_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace monero {
+
+// Owned outputs and sync height of a wallet, enough to show its balance and
+// history before the wallet2 archive is loaded.  Encoded as a LedgerProto
+// message (see proto/ledger.proto) without depending on the protobuf runtime.
+struct LedgerSummary {
+  struct OwnedTxOut {
+    crypto::hash tx_id;
+    uint64_t amount;
+    uint64_t block_height;
+    // Zero while unspent, or while spent by a tx still in the pool.
+    uint64_t spent_height;
+    bool spent_in_pool;
+  };
+
+  std::string public_address;
+  uint64_t block_height = 0;
+  std::vector<OwnedTxOut> owned_tx_outs;
+};
+
+// Saved wallet data starts with this header when a summary is present:
+//
+//   magic (4 bytes) | LedgerProto size (fixed32, little-endian) | LedgerProto
+//
+// followed by the wallet archive.  Archives always start with a small varint
+// version, so the 0xff lead byte never matches data saved without a summary.
+constexpr char kLedgerSummaryMagic[4] = {'\xff', 'L', 'G', 'R'};
+constexpr size_t kLedgerSummaryHeaderSize = sizeof(kLedgerSummaryMagic) + sizeof(uint32_t);
+
+void EncodeLedgerProto(const LedgerSummary& summary, std::string* out);
+
+void WriteLedgerSummaryHeader(const LedgerSummary& summary, std::ostream& output);
+
+// Sets `*archive_offset` to where the wallet archive starts in `data`: past
+// the summary header if there is one, or zero otherwise.  Returns false if
+// the header is truncated.
+bool SkipLedgerSummaryHeader(const std::string& data, size_t* archive_offset);
+
+}  // namespace monero
+
+#endif  // WALLET_LEDGER_SUMMARY_H_
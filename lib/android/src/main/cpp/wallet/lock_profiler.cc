@@ -0,0 +1,180 @@
+#include "lock_profiler.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "common/debug.h"
+
+namespace monero {
+
+constexpr int DurationHistogram::kBuckets;
+
+std::atomic<uint32_t> LockProfiler::s_sample_period(0);
+std::atomic<LockSite*> LockProfiler::s_sites(nullptr);
+
+DurationHistogram::DurationHistogram() : m_count(0), m_sum_us(0), m_max_us(0) {
+  for (auto& bucket: m_buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void DurationHistogram::record(std::chrono::steady_clock::duration d) {
+  const auto us = static_cast<uint64_t>(
+      std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(d).count()));
+  int bucket = 0;
+  while (bucket < kBuckets - 1 && (uint64_t{1} << bucket) <= us) {
+    ++bucket;
+  }
+  m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum_us.fetch_add(us, std::memory_order_relaxed);
+  uint64_t max = m_max_us.load(std::memory_order_relaxed);
+  while (us > max && !m_max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+  }
+}
+
+void DurationHistogram::appendTo(std::string* out) const {
+  char buf[96];
+  snprintf(buf, sizeof(buf), "count=%" PRIu64 " sum_us=%" PRIu64 " max_us=%" PRIu64 " lt_us=[",
+           m_count.load(std::memory_order_relaxed),
+           m_sum_us.load(std::memory_order_relaxed),
+           m_max_us.load(std::memory_order_relaxed));
+  out->append(buf);
+  bool first = true;
+  for (int i = 0; i < kBuckets; ++i) {
+    uint64_t n = m_buckets[i].load(std::memory_order_relaxed);
+    if (n == 0) {
+      continue;
+    }
+    if (i == kBuckets - 1) {
+      snprintf(buf, sizeof(buf), "%sinf:%" PRIu64, first ? "" : " ", n);
+    } else {
+      snprintf(buf, sizeof(buf), "%s%" PRIu64 ":%" PRIu64, first ? "" : " ", uint64_t{1} << i, n);
+    }
+    out->append(buf);
+    first = false;
+  }
+  out->append("]");
+}
+
+LockSite::LockSite(const char* mutex_name, const char* name)
+    : mutex_name(mutex_name),
+      name(name),
+      contended(0),
+      m_next(nullptr) {
+  LockProfiler::add(this);
+}
+
+void LockProfiler::add(LockSite* site) {
+  // Sites are never removed, so a lock-free push is enough.
+  LockSite* head = s_sites.load(std::memory_order_relaxed);
+  do {
+    site->m_next = head;
+  } while (!s_sites.compare_exchange_weak(head, site, std::memory_order_release,
+                                          std::memory_order_relaxed));
+}
+
+std::string LockProfiler::dump() {
+  std::string out;
+  for (LockSite* site = s_sites.load(std::memory_order_acquire); site; site = site->m_next) {
+    if (site->wait.count() == 0) {
+      continue;
+    }
+    const std::string prefix = std::string("lock.") + site->mutex_name + "." + site->name;
+    out.append(prefix).append(".wait ");
+    site->wait.appendTo(&out);
+    out.append("\n").append(prefix).append(".hold ");
+    site->hold.appendTo(&out);
+    out.append("\n").append(prefix).append(".contended ")
+        .append(std::to_string(site->contended.load(std::memory_order_relaxed)))
+        .append("\n");
+  }
+  return out;
+}
+
+ProfiledLock::ProfiledLock(ProfiledMutex& mutex, LockSite& site)
+    : m_mutex(mutex),
+      m_site(site),
+      m_owns(false),
+      m_sampled(false),
+      m_waiting(false),
+      m_contended(false) {
+  lock();
+}
+
+ProfiledLock::ProfiledLock(ProfiledMutex& mutex, LockSite& site, std::try_to_lock_t)
+    : m_mutex(mutex),
+      m_site(site),
+      m_owns(false),
+      m_sampled(false),
+      m_waiting(false),
+      m_contended(false) {
+  try_lock();
+}
+
+ProfiledLock::~ProfiledLock() {
+  if (m_owns) {
+    unlock();
+  }
+}
+
+void ProfiledLock::lock() {
+  LOG_FATAL_IF(m_owns, "Lock already owned");
+  if (!m_waiting) {
+    m_sampled = LockProfiler::sample();
+    if (!m_sampled) {
+      m_mutex.m_mutex.lock();
+      m_owns = true;
+      return;
+    }
+    m_wait_start = Clock::now();
+  }
+  if (!m_mutex.m_mutex.try_lock()) {
+    m_contended = true;
+    m_mutex.m_mutex.lock();
+  }
+  acquired();
+}
+
+bool ProfiledLock::try_lock() {
+  LOG_FATAL_IF(m_owns, "Lock already owned");
+  if (!m_waiting) {
+    // Repeated attempts count as one acquisition, waiting since the first.
+    m_sampled = LockProfiler::sample();
+    if (m_sampled) {
+      m_wait_start = Clock::now();
+    }
+  }
+  if (!m_mutex.m_mutex.try_lock()) {
+    m_waiting = true;
+    m_contended = true;
+    return false;
+  }
+  acquired();
+  return true;
+}
+
+void ProfiledLock::acquired() {
+  m_owns = true;
+  m_waiting = false;
+  if (m_sampled) {
+    m_acquired_at = Clock::now();
+    m_site.wait.record(m_acquired_at - m_wait_start);
+    if (m_contended) {
+      m_site.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  m_contended = false;
+}
+
+void ProfiledLock::unlock() {
+  LOG_FATAL_IF(!m_owns, "Lock not owned");
+  if (m_sampled) {
+    m_site.hold.record(Clock::now() - m_acquired_at);
+  }
+  m_mutex.m_mutex.unlock();
+  m_owns = false;
+}
+
+}  // namespace monero
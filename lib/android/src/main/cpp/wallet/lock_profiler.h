@@ -0,0 +1,138 @@
+#ifndef WALLET_LOCK_PROFILER_H_
+#define WALLET_LOCK_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace monero {
+
+// Log2 histogram of durations, in microseconds.  Bucket 0 counts durations
+// under 1 us, bucket i those in [2^(i-1), 2^i) us, and the last bucket
+// everything above.
+class DurationHistogram {
+ public:
+  static constexpr int kBuckets = 28;
+
+  DurationHistogram();
+
+  void record(std::chrono::steady_clock::duration d);
+
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+
+  // Appends "count=.. sum_us=.. max_us=.. lt_us=[bound:count ...]" with the
+  // non-empty buckets only.
+  void appendTo(std::string* out) const;
+
+ private:
+  std::atomic<uint64_t> m_buckets[kBuckets];
+  std::atomic<uint64_t> m_count;
+  std::atomic<uint64_t> m_sum_us;
+  std::atomic<uint64_t> m_max_us;
+};
+
+// Statistics of one place in the code that takes a ProfiledMutex, shared by
+// all instances of the mutex.  Sites are declared as function-local statics
+// and live for the whole process.
+class LockSite {
+ public:
+  LockSite(const char* mutex_name, const char* name);
+
+  LockSite(const LockSite&) = delete;
+  void operator=(const LockSite&) = delete;
+
+  const char* const mutex_name;
+  const char* const name;
+
+  // Time until the lock was acquired, and for how long it was held.
+  DurationHistogram wait;
+  DurationHistogram hold;
+  // Sampled acquisitions that found the mutex taken.
+  std::atomic<uint64_t> contended;
+
+ private:
+  friend class LockProfiler;
+
+  LockSite* m_next;
+};
+
+// Process-wide switch and report of the lock sites.
+class LockProfiler {
+ public:
+  // One acquisition in `period` is timed, per thread; 0 turns timing off.
+  // Off, a lock costs one relaxed load more than a plain std::mutex.
+  static void setSamplePeriod(uint32_t period) {
+    s_sample_period.store(period, std::memory_order_relaxed);
+  }
+
+  static bool sample() {
+    uint32_t period = s_sample_period.load(std::memory_order_relaxed);
+    if (period <= 1) {
+      return period == 1;
+    }
+    static thread_local uint32_t t_count = 0;
+    return ++t_count % period == 0;
+  }
+
+  // One line per histogram of every site that was sampled at least once.
+  static std::string dump();
+
+ private:
+  friend class LockSite;
+
+  static void add(LockSite* site);
+
+  static std::atomic<uint32_t> s_sample_period;
+  static std::atomic<LockSite*> s_sites;
+};
+
+// std::mutex that can only be taken through a ProfiledLock, so that every
+// call site is accounted for.
+class ProfiledMutex {
+ public:
+  ProfiledMutex() = default;
+
+  ProfiledMutex(const ProfiledMutex&) = delete;
+  void operator=(const ProfiledMutex&) = delete;
+
+ private:
+  friend class ProfiledLock;
+
+  std::mutex m_mutex;
+};
+
+// Subset of std::unique_lock over a ProfiledMutex, recording to `site`.
+class ProfiledLock {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  ProfiledLock(ProfiledMutex& mutex, LockSite& site);
+  ProfiledLock(ProfiledMutex& mutex, LockSite& site, std::try_to_lock_t);
+  ~ProfiledLock();
+
+  ProfiledLock(const ProfiledLock&) = delete;
+  void operator=(const ProfiledLock&) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+  bool owns_lock() const { return m_owns; }
+
+ private:
+  void acquired();
+
+  ProfiledMutex& m_mutex;
+  LockSite& m_site;
+  bool m_owns;
+  bool m_sampled;
+  bool m_waiting;
+  bool m_contended;
+  Clock::time_point m_wait_start;
+  Clock::time_point m_acquired_at;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_LOCK_PROFILER_H_
@@ -0,0 +1,364 @@
+#include "monero_wallet_core.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/iostreams/device/file_descriptor.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include "common/debug.h"
+#include "common/secret_arena.h"
+
+#include "refresh_scheduler.h"
+#include "transfer.h"
+#include "wallet.h"
+
+namespace io = boost::iostreams;
+
+namespace monero {
+
+namespace {
+
+// Calls the host's transport callback.
+class CallbackNodeTransport : public NodeTransport {
+ public:
+  CallbackNodeTransport(monero_http_transport transport, void* user_data)
+      : m_transport(transport), m_user_data(user_data) {}
+
+  // Wallets created with the same callback and user data reach the same node.
+  std::string id() const override {
+    std::string id(reinterpret_cast<const char*>(&m_transport), sizeof(m_transport));
+    id.append(reinterpret_cast<const char*>(&m_user_data), sizeof(m_user_data));
+    return id;
+  }
+
+  bool call(const std::string& method,
+            const std::string& uri,
+            const std::string& header,
+            const boost::string_ref body,
+            int64_t timeout_ms,
+            NodeResponse* response) override {
+    return m_transport(m_user_data,
+                       method.c_str(),
+                       uri.c_str(),
+                       header.c_str(),
+                       reinterpret_cast<const uint8_t*>(body.data()),
+                       body.size(),
+                       timeout_ms,
+                       reinterpret_cast<monero_http_response*>(response)) != 0;
+  }
+
+ private:
+  const monero_http_transport m_transport;
+  void* const m_user_data;
+};
+
+class CallbackWalletListener : public WalletListener {
+ public:
+  explicit CallbackWalletListener(const monero_wallet_callbacks* callbacks) : m_callbacks() {
+    if (callbacks != nullptr) {
+      m_callbacks = *callbacks;
+    }
+  }
+
+  void onRefresh(uint32_t height, uint64_t timestamp, bool balance_changed) override {
+    if (m_callbacks.on_refresh != nullptr) {
+      m_callbacks.on_refresh(m_callbacks.user_data, height, timestamp, balance_changed);
+    }
+  }
+
+  void onRefreshResult(Wallet::Status status) override {
+    if (m_callbacks.on_refresh_result != nullptr) {
+      m_callbacks.on_refresh_result(m_callbacks.user_data, status);
+    }
+  }
+
+  void onSuspendRefresh(bool suspended) override {
+    if (m_callbacks.on_suspend_refresh != nullptr) {
+      m_callbacks.on_suspend_refresh(m_callbacks.user_data, suspended);
+    }
+  }
+
+ private:
+  monero_wallet_callbacks m_callbacks;
+};
+
+Wallet* ToWallet(monero_wallet* wallet) {
+  return reinterpret_cast<Wallet*>(wallet);
+}
+
+const Wallet* ToWallet(const monero_wallet* wallet) {
+  return reinterpret_cast<const Wallet*>(wallet);
+}
+
+size_t CopyString(const std::string& str, char* buf, size_t size) {
+  if (size > 0) {
+    size_t n = std::min(str.size(), size - 1);
+    memcpy(buf, str.data(), n);
+    buf[n] = '\0';
+  }
+  return str.size();
+}
+
+void NativeToTxInfo(const TxHistory& txs, size_t i, monero_tx_info* info) {
+  memset(info, 0, sizeof(*info));
+  memcpy(info->tx_hash, txs.tx_hash(i).data, sizeof(info->tx_hash));
+  info->public_key_known = txs.public_key_known(i);
+  if (info->public_key_known) {
+    memcpy(info->public_key, txs.public_key(i).data, sizeof(info->public_key));
+  }
+  info->key_image_known = txs.key_image_known(i);
+  if (info->key_image_known) {
+    memcpy(info->key_image, txs.key_image(i).data, sizeof(info->key_image));
+  }
+  info->subaddress_major = txs.subaddress_major(i);
+  info->subaddress_minor = txs.subaddress_minor(i);
+  CopyString(txs.recipient(i), info->recipient, sizeof(info->recipient));
+  info->amount = txs.amount(i);
+  info->height = txs.height(i);
+  info->unlock_time = txs.unlock_time(i);
+  info->timestamp = txs.timestamp(i);
+  info->fee = txs.fee(i);
+  info->change = txs.change(i);
+  info->state = txs.state(i);
+  info->coinbase = txs.coinbase(i);
+  info->incoming = txs.type(i) == TxInfo::INCOMING;
+}
+
+}  // namespace
+
+extern "C" {
+
+void monero_http_response_set(monero_http_response* response,
+                              int code,
+                              const char* content_type,
+                              const char* content_encoding,
+                              const uint8_t* body,
+                              size_t body_size) {
+  auto* res = reinterpret_cast<NodeResponse*>(response);
+  res->code = code;
+  res->content_type = content_type ? content_type : "";
+  res->content_encoding = content_encoding ? content_encoding : "";
+  res->body.assign(reinterpret_cast<const char*>(body), body_size);
+}
+
+monero_wallet* monero_wallet_create(int network_id,
+                                    monero_http_transport transport,
+                                    void* transport_user_data,
+                                    const monero_wallet_callbacks* callbacks) {
+  auto* wallet = new Wallet(
+      network_id,
+      std::make_shared<CallbackNodeTransport>(transport, transport_user_data),
+      std::make_unique<CallbackWalletListener>(callbacks));
+  return reinterpret_cast<monero_wallet*>(wallet);
+}
+
+void monero_wallet_destroy(monero_wallet* wallet) {
+  delete ToWallet(wallet);
+}
+
+int monero_wallet_restore(monero_wallet* wallet,
+                          const uint8_t* secret_spend_key,
+                          uint64_t restore_point) {
+  try {
+    SecretBuffer secret_scalar(secret_spend_key, secret_spend_key + 32);
+    ToWallet(wallet)->restoreAccount(secret_scalar, restore_point);
+    return 1;
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    return 0;
+  }
+}
+
+int monero_wallet_load(monero_wallet* wallet, int fd) {
+  try {
+    io::stream<io::file_descriptor_source> in_stream(fd, io::never_close_handle);
+    return ToWallet(wallet)->parseFrom(in_stream);
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    return 0;
+  }
+}
+
+int monero_wallet_save(monero_wallet* wallet, int fd) {
+  try {
+    io::stream<io::file_descriptor_sink> out_stream(fd, io::never_close_handle);
+    return ToWallet(wallet)->writeTo(out_stream);
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    return 0;
+  }
+}
+
+int monero_wallet_refresh(monero_wallet* wallet, int skip_coinbase, int background) {
+  try {
+    RefreshScheduler::instance()->schedule(
+        ToWallet(wallet), skip_coinbase,
+        background ? RefreshScheduler::BACKGROUND : RefreshScheduler::FOREGROUND);
+    return 1;
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    return 0;
+  }
+}
+
+void monero_wallet_cancel_refresh(monero_wallet* wallet) {
+  ToWallet(wallet)->cancelRefresh();
+}
+
+void monero_wallet_set_refresh_since(monero_wallet* wallet, uint64_t height_or_timestamp) {
+  ToWallet(wallet)->setRefreshSince(height_or_timestamp);
+}
+
+uint32_t monero_wallet_height(const monero_wallet* wallet) {
+  return ToWallet(wallet)->current_blockchain_height();
+}
+
+size_t monero_wallet_public_address(const monero_wallet* wallet, char* buf, size_t size) {
+  return CopyString(ToWallet(wallet)->public_address(), buf, size);
+}
+
+int monero_wallet_balance(monero_wallet* wallet,
+                          int32_t account,
+                          int32_t subaddress,
+                          uint64_t* unlocked,
+                          uint64_t* pending,
+                          uint64_t* locked) {
+  *unlocked = 0;
+  *pending = 0;
+  *locked = 0;
+  try {
+    BalanceAggregate balance = ToWallet(wallet)->queryBalance(account, subaddress);
+    uint64_t locked_total = 0;
+    for (const auto* buckets: {&balance.locked_until_height, &balance.locked_until_timestamp}) {
+      for (const auto& bucket: *buckets) {
+        locked_total += bucket.second;
+      }
+    }
+    *unlocked = balance.unlocked;
+    *pending = balance.pending;
+    *locked = locked_total;
+    return 1;
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    return 0;
+  }
+}
+
+void monero_tx_query_init(monero_tx_query* query) {
+  TxHistoryQuery defaults;
+  query->account = defaults.account;
+  query->subaddress = defaults.subaddress;
+  query->direction = defaults.direction;
+  query->state_mask = defaults.state_mask;
+  query->min_height = defaults.min_height;
+  query->max_height = defaults.max_height;
+  query->min_timestamp = defaults.min_timestamp;
+  query->max_timestamp = defaults.max_timestamp;
+  query->order = defaults.order;
+}
+
+size_t monero_wallet_tx_history(monero_wallet* wallet, monero_tx_info* out, size_t capacity) {
+  size_t size = 0;
+  static LockSite site("tx_history", "monero_wallet_tx_history");
+  ToWallet(wallet)->withTxHistory(site, [&](TxHistory const& txs) {
+    size = txs.size();
+    for (size_t i = 0; i < std::min(size, capacity); ++i) {
+      NativeToTxInfo(txs, i, &out[i]);
+    }
+  });
+  return size;
+}
+
+int64_t monero_wallet_query_tx_history(monero_wallet* wallet,
+                                       const monero_tx_query* query,
+                                       uint64_t cursor,
+                                       monero_tx_info* out,
+                                       size_t capacity,
+                                       uint64_t* next_cursor) {
+  TxHistoryQuery q;
+  q.account = query->account;
+  q.subaddress = query->subaddress;
+  q.direction = query->direction;
+  q.state_mask = query->state_mask;
+  q.min_height = query->min_height;
+  q.max_height = query->max_height;
+  q.min_timestamp = query->min_timestamp;
+  q.max_timestamp = query->max_timestamp;
+  q.order = static_cast<TxHistoryQuery::Order>(query->order);
+  int64_t count = -1;
+  static LockSite site("tx_history", "monero_wallet_query_tx_history");
+  ToWallet(wallet)->withTxHistory(site, [&](TxHistory const& txs) {
+    TxHistoryPage page;
+    if (!txs.query(q, cursor, capacity, &page)) {
+      return;
+    }
+    // Rows are copied under the history lock, as the page only holds row
+    // numbers into this snapshot.
+    for (size_t i = 0; i < page.rows.size(); ++i) {
+      NativeToTxInfo(txs, page.rows[i], &out[i]);
+    }
+    *next_cursor = page.next_cursor;
+    count = page.rows.size();
+  });
+  return count;
+}
+
+monero_pending_transfer* monero_wallet_create_payment(monero_wallet* wallet,
+                                                      const char* const* addresses,
+                                                      const uint64_t* amounts,
+                                                      size_t count,
+                                                      int priority,
+                                                      uint32_t account,
+                                                      char* error,
+                                                      size_t error_size) {
+  try {
+    std::unique_ptr<PendingTransfer> pending_transfer = ToWallet(wallet)->createPayment(
+        {addresses, addresses + count},
+        {amounts, amounts + count},
+        priority,
+        account,
+        {});
+    return reinterpret_cast<monero_pending_transfer*>(pending_transfer.release());
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    CopyString(e.what(), error, error_size);
+    return nullptr;
+  }
+}
+
+void monero_pending_transfer_info(const monero_pending_transfer* transfer,
+                                  uint64_t* amount,
+                                  uint64_t* fee,
+                                  uint32_t* tx_count) {
+  const auto* pending_transfer = reinterpret_cast<const PendingTransfer*>(transfer);
+  *amount = pending_transfer->amount();
+  *fee = pending_transfer->fee();
+  *tx_count = pending_transfer->txCount();
+}
+
+int monero_wallet_commit_payment(monero_wallet* wallet,
+                                 monero_pending_transfer* transfer,
+                                 char* error,
+                                 size_t error_size) {
+  try {
+    ToWallet(wallet)->commit_transfer(*reinterpret_cast<PendingTransfer*>(transfer));
+    return 1;
+  } catch (const std::exception& e) {
+    LOGW("Caught unhandled exception: %s", e.what());
+    CopyString(e.what(), error, error_size);
+    return 0;
+  }
+}
+
+void monero_pending_transfer_destroy(monero_pending_transfer* transfer) {
+  delete reinterpret_cast<PendingTransfer*>(transfer);
+}
+
+size_t monero_wallet_dump_stats(monero_wallet* wallet, char* buf, size_t size) {
+  return CopyString(ToWallet(wallet)->dumpStats(), buf, size);
+}
+
+}  // extern "C"
+
+}  // namespace monero
@@ -0,0 +1,211 @@
+#ifndef WALLET_MONERO_WALLET_CORE_H_
+#define WALLET_MONERO_WALLET_CORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// C API of the wallet core, for hosts other than the Android library: desktop
+// builds, servers and test harnesses.  Node traffic goes through a transport
+// callback supplied by the host, so the core never opens a socket itself.
+//
+// Strings are NUL-terminated UTF-8.  Functions writing text into a caller
+// buffer behave like snprintf(): they return the full length and truncate to
+// `size` - 1 bytes.  Unless noted otherwise, functions may be called from any
+// thread.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MONERO_WALLET_API __attribute__((visibility("default")))
+
+typedef struct monero_wallet monero_wallet;
+typedef struct monero_http_response monero_http_response;
+typedef struct monero_pending_transfer monero_pending_transfer;
+
+// Values of cryptonote::network_type.
+enum {
+  MONERO_MAINNET = 0,
+  MONERO_TESTNET = 1,
+  MONERO_STAGENET = 2,
+};
+
+// Outcome of a refresh, as in Wallet::Status.
+enum {
+  MONERO_REFRESH_OK = 0,
+  MONERO_REFRESH_INTERRUPTED = 1,
+  MONERO_REFRESH_NO_NETWORK_CONNECTIVITY = 2,
+  MONERO_REFRESH_ERROR = 3,
+  MONERO_REFRESH_TIMEOUT = 4,
+};
+
+// Makes one HTTP call to the node.  `headers` holds "Name: value\r\n" lines;
+// a zero `timeout_ms` means no deadline.  The reply is handed over with
+// monero_http_response_set() before returning.  Returns zero if no reply was
+// received.  Called from refresh threads, possibly from several at once.
+typedef int (*monero_http_transport)(void* user_data,
+                                     const char* method,
+                                     const char* uri,
+                                     const char* headers,
+                                     const uint8_t* body,
+                                     size_t body_size,
+                                     int64_t timeout_ms,
+                                     monero_http_response* response);
+
+// Copies the reply to a transport call.  `content_type` and
+// `content_encoding` may be NULL; gzip and deflate bodies are decoded by the
+// core.
+MONERO_WALLET_API void monero_http_response_set(monero_http_response* response,
+                                                int code,
+                                                const char* content_type,
+                                                const char* content_encoding,
+                                                const uint8_t* body,
+                                                size_t body_size);
+
+// Wallet events, raised on the thread that causes them.  Any may be NULL.
+typedef struct monero_wallet_callbacks {
+  void* user_data;
+  void (*on_refresh)(void* user_data, uint32_t height, uint64_t timestamp, int balance_changed);
+  void (*on_refresh_result)(void* user_data, int status);
+  void (*on_suspend_refresh)(void* user_data, int suspended);
+} monero_wallet_callbacks;
+
+// Creates a wallet with no account.  `callbacks` is copied and may be NULL.
+// Wallets of a network created with the same transport and user data share
+// block responses, so they must reach the same node.
+MONERO_WALLET_API monero_wallet* monero_wallet_create(int network_id,
+                                                      monero_http_transport transport,
+                                                      void* transport_user_data,
+                                                      const monero_wallet_callbacks* callbacks);
+
+MONERO_WALLET_API void monero_wallet_destroy(monero_wallet* wallet);
+
+// Restores the account of a 32-byte secret spend key.  `restore_point` is a
+// block height, or a Unix timestamp when not below 500000000.  Returns zero
+// on failure.
+MONERO_WALLET_API int monero_wallet_restore(monero_wallet* wallet,
+                                            const uint8_t* secret_spend_key,
+                                            uint64_t restore_point);
+
+// Reads or writes the wallet state from or to `fd`, which is left open.
+// Return zero on failure.
+MONERO_WALLET_API int monero_wallet_load(monero_wallet* wallet, int fd);
+MONERO_WALLET_API int monero_wallet_save(monero_wallet* wallet, int fd);
+
+// Schedules a refresh; its end is reported through on_refresh_result.
+// Returns zero if it could not be scheduled.
+MONERO_WALLET_API int monero_wallet_refresh(monero_wallet* wallet,
+                                            int skip_coinbase,
+                                            int background);
+MONERO_WALLET_API void monero_wallet_cancel_refresh(monero_wallet* wallet);
+MONERO_WALLET_API void monero_wallet_set_refresh_since(monero_wallet* wallet,
+                                                       uint64_t height_or_timestamp);
+
+MONERO_WALLET_API uint32_t monero_wallet_height(const monero_wallet* wallet);
+
+MONERO_WALLET_API size_t monero_wallet_public_address(const monero_wallet* wallet,
+                                                      char* buf,
+                                                      size_t size);
+
+// Balance of one subaddress, of a whole account when `subaddress` is -1, or
+// of every account when both are -1.  Funds locked until some height or time
+// are summed into `locked`.  Returns zero on failure, with all three zeroed.
+MONERO_WALLET_API int monero_wallet_balance(monero_wallet* wallet,
+                                            int32_t account,
+                                            int32_t subaddress,
+                                            uint64_t* unlocked,
+                                            uint64_t* pending,
+                                            uint64_t* locked);
+
+// One row of the transaction history, as the Kotlin TxInfo.
+typedef struct monero_tx_info {
+  uint8_t tx_hash[32];
+  uint8_t public_key[32];
+  uint8_t key_image[32];
+  int public_key_known;
+  int key_image_known;
+  uint32_t subaddress_major;
+  uint32_t subaddress_minor;
+  // Empty if unknown.
+  char recipient[128];
+  uint64_t amount;
+  uint64_t height;
+  uint64_t unlock_time;
+  uint64_t timestamp;
+  uint64_t fee;
+  uint64_t change;
+  int state;
+  int coinbase;
+  int incoming;
+} monero_tx_info;
+
+// Filter of monero_wallet_query_tx_history(), as TxHistoryQuery.  Call
+// monero_tx_query_init() for a query matching everything.
+typedef struct monero_tx_query {
+  uint32_t account;
+  uint32_t subaddress;
+  int direction;
+  uint32_t state_mask;
+  uint64_t min_height;
+  uint64_t max_height;
+  uint64_t min_timestamp;
+  uint64_t max_timestamp;
+  int order;
+} monero_tx_query;
+
+#define MONERO_TX_CURSOR_START ((uint64_t) 0)
+#define MONERO_TX_CURSOR_END UINT64_MAX
+
+MONERO_WALLET_API void monero_tx_query_init(monero_tx_query* query);
+
+// Copies up to `capacity` rows of the history into `out`, and returns the
+// number of rows.
+MONERO_WALLET_API size_t monero_wallet_tx_history(monero_wallet* wallet,
+                                                  monero_tx_info* out,
+                                                  size_t capacity);
+
+// Copies the next page of at most `capacity` matching rows into `out`, and
+// returns its size, or -1 if `cursor` is stale.  `*next_cursor` becomes
+// MONERO_TX_CURSOR_END once the query is exhausted.
+MONERO_WALLET_API int64_t monero_wallet_query_tx_history(monero_wallet* wallet,
+                                                         const monero_tx_query* query,
+                                                         uint64_t cursor,
+                                                         monero_tx_info* out,
+                                                         size_t capacity,
+                                                         uint64_t* next_cursor);
+
+// Builds the transactions paying `amounts[i]` to `addresses[i]` from the
+// given account.  Returns NULL on failure, with the reason in `error`.
+MONERO_WALLET_API monero_pending_transfer* monero_wallet_create_payment(
+    monero_wallet* wallet,
+    const char* const* addresses,
+    const uint64_t* amounts,
+    size_t count,
+    int priority,
+    uint32_t account,
+    char* error,
+    size_t error_size);
+
+MONERO_WALLET_API void monero_pending_transfer_info(const monero_pending_transfer* transfer,
+                                                    uint64_t* amount,
+                                                    uint64_t* fee,
+                                                    uint32_t* tx_count);
+
+// Relays the transactions to the node.  Returns zero on failure, with the
+// reason in `error`.  The transfer must still be destroyed.
+MONERO_WALLET_API int monero_wallet_commit_payment(monero_wallet* wallet,
+                                                   monero_pending_transfer* transfer,
+                                                   char* error,
+                                                   size_t error_size);
+
+MONERO_WALLET_API void monero_pending_transfer_destroy(monero_pending_transfer* transfer);
+
+// Lock profile of the process and counters of the wallet, as "name value"
+// lines.
+MONERO_WALLET_API size_t monero_wallet_dump_stats(monero_wallet* wallet, char* buf, size_t size);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // WALLET_MONERO_WALLET_CORE_H_
@@ -0,0 +1,40 @@
+#ifndef WALLET_PARALLEL_FOR_H_
+#define WALLET_PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <cstddef>
+
+#include "common/debug.h"
+
+#include "common/threadpool.h"
+
+namespace monero {
+
+// Calls `fn(i)` for every i in [0, n) on wallet2's compute thread pool, the
+// one it parses fetched blocks on, and returns when all calls have returned.
+// The range is split into one run per pool thread.  `fn` must not throw.
+template<typename F>
+void ParallelFor(size_t n, const F& fn) {
+  tools::threadpool& pool = tools::threadpool::getInstanceForCompute();
+  const size_t runs = std::max<size_t>(1, pool.get_max_concurrency());
+  const size_t run_size = (n + runs - 1) / runs;
+  tools::threadpool::waiter waiter(pool);
+  for (size_t begin = 0; begin < n; begin += run_size) {
+    const size_t end = std::min(begin + run_size, n);
+    pool.submit(&waiter, [&fn, begin, end]() {
+      for (size_t i = begin; i < end; ++i) {
+        fn(i);
+      }
+    }, true /* leaf */);
+  }
+  LOG_FATAL_IF(!waiter.wait(), "Parallel job failed");
+}
+
+// Number of threads ParallelFor() runs on.
+inline size_t ParallelForThreadCount() {
+  return tools::threadpool::getInstanceForCompute().get_max_concurrency();
+}
+
+}  // namespace monero
+
+#endif  // WALLET_PARALLEL_FOR_H_
@@ -0,0 +1,202 @@
+#include "refresh_scheduler.h"
+
+#include <algorithm>
+
+#include "common/debug.h"
+
+#include "block_feed.h"
+#include "wallet.h"
+
+namespace monero {
+
+constexpr uint64_t RefreshScheduler::kSliceBlocks;
+
+size_t RefreshScheduler::DefaultWorkerCount() {
+  size_t cores = std::thread::hardware_concurrency();
+  return std::max<size_t>(2, std::min<size_t>(4, cores));
+}
+
+RefreshScheduler::RefreshScheduler(size_t num_workers)
+    : m_foreground_turns(0),
+      m_shutdown(false) {
+  for (size_t i = 0; i < num_workers; ++i) {
+    m_workers.emplace_back(&RefreshScheduler::workerLoop, this);
+  }
+  LOGD("Refresh scheduler started with %zu workers", num_workers);
+}
+
+RefreshScheduler::~RefreshScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shutdown = true;
+  }
+  m_work_cond.notify_all();
+  for (auto& worker: m_workers) {
+    worker.join();
+  }
+}
+
+void RefreshScheduler::schedule(Wallet* wallet, bool skip_coinbase, Priority priority) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto ret = m_jobs.insert({wallet, Job()});
+  Job& job = ret.first->second;
+  if (job.active) {
+    if (job.priority != priority && job.queued) {
+      auto& queue = m_queues[job.priority];
+      queue.erase(std::find(queue.begin(), queue.end(), wallet));
+      job.queued = false;
+      job.priority = priority;
+      enqueue(wallet, job);
+    } else {
+      job.priority = priority;
+    }
+    return;
+  }
+  job.skip_coinbase = skip_coinbase;
+  job.priority = priority;
+  job.active = true;
+  job.progress = Progress();
+  if (!job.running) {
+    enqueue(wallet, job);
+  }
+}
+
+void RefreshScheduler::remove(Wallet* wallet) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_jobs.find(wallet);
+  if (it == m_jobs.end()) {
+    return;
+  }
+  Job& job = it->second;
+  // A running slice may put the wallet back in the queue when it returns.
+  m_idle_cond.wait(lock, [&job]() { return !job.running; });
+  // Parked jobs are in no queue.
+  if (job.queued) {
+    auto& queue = m_queues[job.priority];
+    queue.erase(std::find(queue.begin(), queue.end(), wallet));
+  }
+  m_jobs.erase(it);
+}
+
+void RefreshScheduler::wake(Wallet* wallet) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_jobs.find(wallet);
+  if (it == m_jobs.end()) {
+    return;
+  }
+  Job& job = it->second;
+  if (job.parked) {
+    job.parked = false;
+    enqueue(wallet, job);
+  } else if (job.running) {
+    job.wake_pending = true;
+  }
+}
+
+bool RefreshScheduler::progress(Wallet* wallet, Progress* out) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_jobs.find(wallet);
+  if (it == m_jobs.end()) {
+    return false;
+  }
+  *out = it->second.progress;
+  return true;
+}
+
+void RefreshScheduler::enqueue(Wallet* wallet, Job& job) {
+  job.queued = true;
+  job.queued_at = Clock::now();
+  m_queues[job.priority].push_back(wallet);
+  m_work_cond.notify_one();
+}
+
+bool RefreshScheduler::nextJob(std::unique_lock<std::mutex>& lock, Wallet** wallet) {
+  m_work_cond.wait(lock, [this]() {
+    return m_shutdown || !m_queues[FOREGROUND].empty() || !m_queues[BACKGROUND].empty();
+  });
+  if (m_shutdown) {
+    return false;
+  }
+  auto& foreground = m_queues[FOREGROUND];
+  auto& background = m_queues[BACKGROUND];
+  bool background_turn = m_foreground_turns + 1 >= kBackgroundTurn;
+  if (!foreground.empty() && (background.empty() || !background_turn)) {
+    *wallet = foreground.front();
+    foreground.pop_front();
+    m_foreground_turns++;
+  } else {
+    *wallet = background.front();
+    background.pop_front();
+    m_foreground_turns = 0;
+  }
+  return true;
+}
+
+void RefreshScheduler::workerLoop() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Wallet* wallet;
+  while (nextJob(lock, &wallet)) {
+    Job& job = m_jobs.at(wallet);
+    job.queued = false;
+    job.running = true;
+    job.wake_pending = false;
+    const bool skip_coinbase = job.skip_coinbase;
+    const auto start_time = Clock::now();
+    job.progress.queue_time +=
+        std::chrono::duration_cast<std::chrono::milliseconds>(start_time - job.queued_at);
+    lock.unlock();
+
+    uint64_t blocks_fetched = 0;
+    Wallet::Status status;
+    Wallet::SliceResult result;
+    try {
+      result = wallet->refreshSlice(skip_coinbase, kSliceBlocks, &blocks_fetched, &status);
+    } catch (const std::exception& e) {
+      LOGE("Refresh failed with unexpected exception: %s", e.what());
+      status = Wallet::Status::REFRESH_ERROR;
+      result = Wallet::SliceResult::DONE;
+    }
+    const bool done = result == Wallet::SliceResult::DONE;
+
+    lock.lock();
+    job.progress.slices++;
+    job.progress.blocks_fetched += blocks_fetched;
+    job.progress.run_time +=
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_time);
+    if (done) {
+      // Marked inactive before the result is delivered, so that a refresh
+      // requested from the result callback, or while it runs, starts anew
+      // instead of being taken for the one that just ended.  The job stays
+      // running until then, so remove() still waits for the callback.
+      job.active = false;
+      LOGD("Refresh finished: status=%d, slices=%" PRIu64 ", blocks=%" PRIu64
+           ", run=%lld ms, queued=%lld ms",
+           status, job.progress.slices, job.progress.blocks_fetched,
+           static_cast<long long>(job.progress.run_time.count()),
+           static_cast<long long>(job.progress.queue_time.count()));
+      lock.unlock();
+      wallet->onRefreshResult(status);
+      lock.lock();
+    }
+    job.running = false;
+    if (done) {
+      if (job.active) {
+        enqueue(wallet, job);
+      }
+      const bool idle = std::none_of(m_jobs.begin(), m_jobs.end(), [](const auto& entry) {
+        return entry.second.active || entry.second.running;
+      });
+      if (idle) {
+        // Batches kept for trailing wallets are of no use to the next round.
+        BlockFeed::DropRecent();
+      }
+    } else if (result == Wallet::SliceResult::BUSY && !job.wake_pending) {
+      job.parked = true;
+    } else {
+      enqueue(wallet, job);
+    }
+    m_idle_cond.notify_all();
+  }
+}
+
+}  // namespace monero
@@ -0,0 +1,107 @@
+#ifndef WALLET_REFRESH_SCHEDULER_H_
+#define WALLET_REFRESH_SCHEDULER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace monero {
+
+class Wallet;
+
+// Runs the refresh of all wallets in the process on a fixed pool of worker
+// threads.
+//
+// A refresh is split into slices of at most kSliceBlocks blocks.  After each
+// slice the wallet goes to the back of its priority queue, so wallets take
+// turns at block-batch boundaries.  Foreground wallets are served first, but
+// every kBackgroundTurn-th slice goes to a background wallet if one is
+// waiting.
+//
+// A wallet held by another call cannot run a slice.  Its job is parked, off
+// the queues, until the holder releases the wallet and calls wake().
+class RefreshScheduler {
+ public:
+  enum Priority {
+    FOREGROUND = 0,
+    BACKGROUND = 1,
+  };
+
+  static constexpr uint64_t kSliceBlocks = 1000;
+  static constexpr int kBackgroundTurn = 4;
+
+  struct Progress {
+    uint64_t slices;
+    uint64_t blocks_fetched;
+    std::chrono::milliseconds run_time;
+    std::chrono::milliseconds queue_time;
+  };
+
+  RefreshScheduler(RefreshScheduler&) = delete;
+  void operator=(const RefreshScheduler&) = delete;
+
+  static RefreshScheduler* instance() {
+    static RefreshScheduler ins(DefaultWorkerCount());
+    return &ins;
+  }
+
+  // Queues a refresh of `wallet`, unless one is already in progress in which
+  // case only its priority is updated.  Wallet::onRefreshResult() is called
+  // on a worker thread when the refresh ends.
+  void schedule(Wallet* wallet, bool skip_coinbase, Priority priority);
+
+  // Removes a wallet, waiting for any running slice to return.
+  void remove(Wallet* wallet);
+
+  // Queues the refresh of `wallet` again if it was parked because the wallet
+  // was held by another call.  Called by that call once it releases the
+  // wallet; does nothing if no refresh is waiting for it.
+  void wake(Wallet* wallet);
+
+  // Returns the progress of the current or last refresh of `wallet`.
+  bool progress(Wallet* wallet, Progress* out);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Job {
+    bool skip_coinbase;
+    Priority priority;
+    bool active;     // Refresh requested and not finished yet.
+    bool queued;
+    bool running;
+    bool parked;     // Waiting for the wallet to be released.
+    // The wallet was released while the running slice may have found it held.
+    bool wake_pending;
+    Clock::time_point queued_at;
+    Progress progress;
+  };
+
+  explicit RefreshScheduler(size_t num_workers);
+  ~RefreshScheduler();
+
+  static size_t DefaultWorkerCount();
+
+  void workerLoop();
+  bool nextJob(std::unique_lock<std::mutex>& lock, Wallet** wallet);
+  void enqueue(Wallet* wallet, Job& job);
+
+  std::mutex m_mutex;
+  std::condition_variable m_work_cond;
+  std::condition_variable m_idle_cond;
+  std::map<Wallet*, Job> m_jobs;
+  std::deque<Wallet*> m_queues[2];
+  int m_foreground_turns;
+  bool m_shutdown;
+
+  std::vector<std::thread> m_workers;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_REFRESH_SCHEDULER_H_
@@ -0,0 +1,317 @@
+#include "rpc_trace.h"
+
+#include <cstring>
+
+#include "common/debug.h"
+
+namespace monero {
+
+namespace {
+
+const char kMagic[4] = {'M', 'R', 'P', 'T'};
+const uint8_t kVersion = 1;
+
+// Bytes of the footer: index offset and magic.
+const size_t kFooterSize = sizeof(uint64_t) + sizeof(kMagic);
+
+// Upper bound for any field length read from a trace.
+const uint64_t kMaxFieldSize = 1 << 28;
+
+void WriteVarint(std::ostream& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.put(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.put(static_cast<char>(value));
+}
+
+bool ReadVarint(std::istream& in, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = in.get();
+    if (c == std::char_traits<char>::eof()) {
+      return false;
+    }
+    *value |= uint64_t(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WriteField(std::ostream& out, const std::string& field) {
+  WriteVarint(out, field.size());
+  out.write(field.data(), field.size());
+}
+
+bool ReadField(std::istream& in, std::string* field) {
+  uint64_t size;
+  if (!ReadVarint(in, &size) || size > kMaxFieldSize) {
+    return false;
+  }
+  field->resize(size);
+  in.read(&(*field)[0], size);
+  return in.good();
+}
+
+bool ReadExchange(std::istream& in, RpcExchange* exchange) {
+  uint64_t code;
+  if (!ReadVarint(in, &code)) {
+    return false;
+  }
+  exchange->response_code = static_cast<int>(code);
+  return ReadField(in, &exchange->method)
+      && ReadField(in, &exchange->uri)
+      && ReadField(in, &exchange->headers)
+      && ReadField(in, &exchange->request_body)
+      && ReadField(in, &exchange->content_type)
+      && ReadField(in, &exchange->response_body);
+}
+
+}  // namespace
+
+crypto::hash RpcRequestKey(const std::string& method,
+                           const std::string& uri,
+                           const std::string& body) {
+  std::string buf;
+  buf.reserve(method.size() + uri.size() + body.size() + 2);
+  buf.append(method).push_back('\0');
+  buf.append(uri).push_back('\0');
+  buf.append(body);
+  return crypto::cn_fast_hash(buf.data(), buf.size());
+}
+
+std::unique_ptr<RpcTraceWriter> RpcTraceWriter::create(const std::string& path) {
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  if (!output) {
+    LOGE("Cannot create RPC trace %s", path.c_str());
+    return nullptr;
+  }
+  output.write(kMagic, sizeof(kMagic));
+  output.put(static_cast<char>(kVersion));
+  return std::unique_ptr<RpcTraceWriter>(new RpcTraceWriter(std::move(output)));
+}
+
+RpcTraceWriter::RpcTraceWriter(std::ofstream output) : m_output(std::move(output)) {}
+
+void RpcTraceWriter::append(const RpcExchange& exchange) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_output.is_open()) {
+    return;
+  }
+  const auto offset = static_cast<uint64_t>(m_output.tellp());
+  WriteVarint(m_output, static_cast<uint64_t>(exchange.response_code));
+  WriteField(m_output, exchange.method);
+  WriteField(m_output, exchange.uri);
+  WriteField(m_output, exchange.headers);
+  WriteField(m_output, exchange.request_body);
+  WriteField(m_output, exchange.content_type);
+  WriteField(m_output, exchange.response_body);
+  m_index.emplace_back(
+      RpcRequestKey(exchange.method, exchange.uri, exchange.request_body), offset);
+}
+
+bool RpcTraceWriter::close() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_output.is_open()) {
+    return false;
+  }
+  const auto index_offset = static_cast<uint64_t>(m_output.tellp());
+  WriteVarint(m_output, m_index.size());
+  for (const auto& entry: m_index) {
+    m_output.write(entry.first.data, sizeof(entry.first.data));
+    WriteVarint(m_output, entry.second);
+  }
+  uint8_t footer[sizeof(uint64_t)];
+  for (size_t i = 0; i < sizeof(footer); ++i) {
+    footer[i] = static_cast<uint8_t>(index_offset >> (8 * i));
+  }
+  m_output.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+  m_output.write(kMagic, sizeof(kMagic));
+  m_output.close();
+  bool ok = !m_output.fail();
+  LOGI("RPC trace closed: %zu calls", m_index.size());
+  return ok;
+}
+
+std::shared_ptr<RpcTraceReader> RpcTraceReader::open(const std::string& path) {
+  std::ifstream input(path, std::ios::binary);
+  char magic[sizeof(kMagic)];
+  if (!input.read(magic, sizeof(magic))
+      || memcmp(magic, kMagic, sizeof(kMagic)) != 0
+      || input.get() != kVersion) {
+    LOGE("Not an RPC trace: %s", path.c_str());
+    return nullptr;
+  }
+  std::shared_ptr<RpcTraceReader> reader(new RpcTraceReader(std::move(input)));
+  if (!reader->readIndex() && !reader->scanRecords()) {
+    return nullptr;
+  }
+  LOGI("RPC trace opened: %zu calls, %zu distinct requests",
+       reader->m_size, reader->m_entries.size());
+  return reader;
+}
+
+RpcTraceReader::RpcTraceReader(std::ifstream input) : m_input(std::move(input)), m_size(0) {}
+
+bool RpcTraceReader::readIndex() {
+  m_input.seekg(0, std::ios::end);
+  const auto file_size = static_cast<uint64_t>(m_input.tellg());
+  if (file_size < sizeof(kMagic) + 1 + kFooterSize) {
+    return false;
+  }
+  m_input.seekg(file_size - kFooterSize);
+  uint8_t footer[kFooterSize];
+  if (!m_input.read(reinterpret_cast<char*>(footer), sizeof(footer))
+      || memcmp(footer + sizeof(uint64_t), kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+  uint64_t index_offset = 0;
+  for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+    index_offset |= uint64_t{footer[i]} << (8 * i);
+  }
+  if (index_offset >= file_size - kFooterSize) {
+    return false;
+  }
+  m_input.seekg(index_offset);
+  uint64_t count;
+  if (!ReadVarint(m_input, &count)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    crypto::hash key;
+    uint64_t offset;
+    if (!m_input.read(key.data, sizeof(key.data))
+        || !ReadVarint(m_input, &offset)
+        || offset >= index_offset) {
+      m_entries.clear();
+      return false;
+    }
+    m_entries[key].offsets.push_back(offset);
+  }
+  m_size = count;
+  return true;
+}
+
+bool RpcTraceReader::scanRecords() {
+  LOGW("RPC trace has no index, scanning records");
+  m_input.clear();
+  m_input.seekg(sizeof(kMagic) + 1);
+  m_entries.clear();
+  m_size = 0;
+  while (true) {
+    const auto offset = static_cast<uint64_t>(m_input.tellg());
+    RpcExchange exchange;
+    if (!ReadExchange(m_input, &exchange)) {
+      // A truncated last record is dropped.
+      break;
+    }
+    auto key = RpcRequestKey(exchange.method, exchange.uri, exchange.request_body);
+    m_entries[key].offsets.push_back(offset);
+    ++m_size;
+  }
+  m_input.clear();
+  return m_size > 0;
+}
+
+bool RpcTraceReader::readRecord(uint64_t offset, RpcExchange* exchange) {
+  m_input.clear();
+  m_input.seekg(offset);
+  return ReadExchange(m_input, exchange);
+}
+
+bool RpcTraceReader::lookup(const std::string& method,
+                            const std::string& uri,
+                            const std::string& body,
+                            RpcExchange* exchange) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_entries.find(RpcRequestKey(method, uri, body));
+  if (it == m_entries.end()) {
+    return false;
+  }
+  Entry& entry = it->second;
+  uint64_t offset = entry.offsets[entry.next];
+  if (entry.next + 1 < entry.offsets.size()) {
+    ++entry.next;
+  }
+  return readRecord(offset, exchange);
+}
+
+std::mutex RpcTrace::s_mutex;
+std::shared_ptr<RpcTraceWriter> RpcTrace::s_recorder;
+std::shared_ptr<RpcTraceReader> RpcTrace::s_replay;
+
+bool RpcTrace::startRecording(const std::string& path) {
+  std::shared_ptr<RpcTraceWriter> writer = RpcTraceWriter::create(path);
+  if (!writer) {
+    return false;
+  }
+  stop();
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_recorder = std::move(writer);
+  return true;
+}
+
+bool RpcTrace::startReplay(const std::string& path) {
+  std::shared_ptr<RpcTraceReader> reader = RpcTraceReader::open(path);
+  if (!reader) {
+    return false;
+  }
+  stop();
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_replay = std::move(reader);
+  return true;
+}
+
+bool RpcTrace::stop() {
+  std::shared_ptr<RpcTraceWriter> writer;
+  {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    writer = std::move(s_recorder);
+    s_recorder.reset();
+    s_replay.reset();
+  }
+  return !writer || writer->close();
+}
+
+std::shared_ptr<RpcTraceWriter> RpcTrace::recorder() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  return s_recorder;
+}
+
+std::shared_ptr<RpcTraceReader> RpcTrace::replay() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  return s_replay;
+}
+
+bool ReplayNodeClient::invoke(const boost::string_ref uri,
+                              const boost::string_ref method,
+                              const boost::string_ref body,
+                              std::chrono::milliseconds timeout,
+                              const epee::net_utils::http::http_response_info** ppresponse_info,
+                              const epee::net_utils::http::fields_list& additional_params) {
+  m_response_info.clear();
+  RpcExchange exchange;
+  if (!m_trace->lookup(std::string(method.data(), method.size()),
+                       std::string(uri.data(), uri.size()),
+                       std::string(body.data(), body.size()),
+                       &exchange)) {
+    LOGW("Call to %s not found in RPC trace", std::string(uri.data(), uri.size()).c_str());
+    return false;
+  }
+  if (exchange.response_code == 0) {
+    return false;
+  }
+  m_bytes_sent += body.size();
+  m_bytes_received += exchange.response_body.size();
+  m_response_info.m_response_code = exchange.response_code;
+  m_response_info.m_mime_tipe = std::move(exchange.content_type);
+  m_response_info.m_body = std::move(exchange.response_body);
+  if (ppresponse_info) {
+    *ppresponse_info = std::addressof(m_response_info);
+  }
+  return true;
+}
+
+}  // namespace monero
@@ -0,0 +1,155 @@
+#ifndef WALLET_RPC_TRACE_H_
+#define WALLET_RPC_TRACE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "http_client.h"
+
+#include "crypto/hash.h"
+
+namespace monero {
+
+// One call to a node as seen by RemoteNodeClient::invoke().  The response
+// body is stored decoded.  A zero response code records a failed call.
+struct RpcExchange {
+  std::string method;
+  std::string uri;
+  std::string headers;
+  std::string request_body;
+  int response_code = 0;
+  std::string content_type;
+  std::string response_body;
+};
+
+// Requests are matched on method, URI and body; headers are only kept for
+// reference.
+crypto::hash RpcRequestKey(const std::string& method,
+                           const std::string& uri,
+                           const std::string& body);
+
+// Appends exchanges to a trace file.
+//
+// Credential headers are dropped before exchanges reach the writer, but
+// bodies are kept whole: a trace holds the wallet's addresses and the
+// outputs and txs it asked about.  Trace files must be kept as private as
+// the wallet itself.
+//
+// Layout: magic | version | records | index | footer.  A record is the
+// varint-prefixed fields of an RpcExchange.  The index, written by close(),
+// maps each request key to the offsets of its records, in call order; the
+// footer holds the index offset followed by the magic again.  A trace cut
+// short before close() has no footer and is indexed by scanning it.
+class RpcTraceWriter {
+ public:
+  // Returns nullptr if the file cannot be created.
+  static std::unique_ptr<RpcTraceWriter> create(const std::string& path);
+
+  // Thread-safe.
+  void append(const RpcExchange& exchange);
+
+  bool close();
+
+ private:
+  explicit RpcTraceWriter(std::ofstream output);
+
+  std::mutex m_mutex;
+  std::ofstream m_output;
+  std::vector<std::pair<crypto::hash, uint64_t>> m_index;
+};
+
+// Serves the responses of a trace file.
+class RpcTraceReader {
+ public:
+  // Returns nullptr if the file is not a readable trace.
+  static std::shared_ptr<RpcTraceReader> open(const std::string& path);
+
+  // Finds the response to a request.  Repeated requests get the recorded
+  // responses in call order, and the last one again once they run out.
+  // Thread-safe.
+  bool lookup(const std::string& method,
+              const std::string& uri,
+              const std::string& body,
+              RpcExchange* exchange);
+
+  size_t size() const { return m_size; }
+
+ private:
+  struct Entry {
+    std::vector<uint64_t> offsets;
+    size_t next = 0;
+  };
+
+  explicit RpcTraceReader(std::ifstream input);
+
+  bool readIndex();
+  bool scanRecords();
+  bool readRecord(uint64_t offset, RpcExchange* exchange);
+
+  std::mutex m_mutex;
+  std::ifstream m_input;
+  std::unordered_map<crypto::hash, Entry> m_entries;
+  size_t m_size;
+};
+
+// Process-wide trace mode.  While recording, every call made through a
+// RemoteNodeClient is appended to the trace.  While replaying, wallets
+// created from then on talk to a ReplayNodeClient instead, which never
+// reaches the JVM or the network.
+class RpcTrace {
+ public:
+  static bool startRecording(const std::string& path);
+  static bool startReplay(const std::string& path);
+
+  // Ends either mode, closing the trace being recorded.
+  static bool stop();
+
+  static std::shared_ptr<RpcTraceWriter> recorder();
+  static std::shared_ptr<RpcTraceReader> replay();
+
+ private:
+  static std::mutex s_mutex;
+  static std::shared_ptr<RpcTraceWriter> s_recorder;
+  static std::shared_ptr<RpcTraceReader> s_replay;
+};
+
+// Node client answering from a trace.  Calls not found in it fail as if the
+// node could not be reached.
+class ReplayNodeClient : public NodeClientBase {
+ public:
+  explicit ReplayNodeClient(std::shared_ptr<RpcTraceReader> trace)
+      : m_trace(std::move(trace)) {}
+
+  bool invoke(const boost::string_ref uri,
+              const boost::string_ref method,
+              const boost::string_ref body,
+              std::chrono::milliseconds timeout,
+              const epee::net_utils::http::http_response_info** ppresponse_info,
+              const epee::net_utils::http::fields_list& additional_params) override;
+
+ private:
+  const std::shared_ptr<RpcTraceReader> m_trace;
+  epee::net_utils::http::http_response_info m_response_info;
+};
+
+class ReplayNodeClientFactory : public HttpClientFactory {
+ public:
+  explicit ReplayNodeClientFactory(std::shared_ptr<RpcTraceReader> trace)
+      : m_trace(std::move(trace)) {}
+
+  std::unique_ptr<AbstractHttpClient> create() override {
+    return std::unique_ptr<AbstractHttpClient>(new ReplayNodeClient(m_trace));
+  }
+
+ private:
+  const std::shared_ptr<RpcTraceReader> m_trace;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_RPC_TRACE_H_
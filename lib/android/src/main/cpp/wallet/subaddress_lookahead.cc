@@ -0,0 +1,84 @@
+#include "subaddress_lookahead.h"
+
+#include <algorithm>
+
+#include "common/debug.h"
+
+#include "parallel_for.h"
+
+namespace monero {
+
+constexpr uint32_t SubaddressLookahead::kChunkSize;
+
+SubaddressLookahead::~SubaddressLookahead() {
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+void SubaddressLookahead::start(const cryptonote::account_keys& keys,
+                                uint32_t major,
+                                uint32_t minor) {
+  LOG_FATAL_IF(m_running, "Lookahead table already being built");
+  m_running = true;
+  m_done = false;
+  m_start_time = std::chrono::steady_clock::now();
+  m_thread = std::thread(&SubaddressLookahead::build, this, keys, major, minor);
+}
+
+void SubaddressLookahead::build(cryptonote::account_keys keys, uint32_t major, uint32_t minor) {
+  hw::device& hwdev = keys.get_device();
+  const uint32_t chunks_per_account = (minor + kChunkSize - 1) / kChunkSize;
+  std::vector<crypto::public_key> pkeys(size_t{major} * minor);
+  ParallelFor(
+      size_t{major} * chunks_per_account, [&](size_t i) {
+        const auto index_major = static_cast<uint32_t>(i / chunks_per_account);
+        const auto begin = static_cast<uint32_t>(i % chunks_per_account) * kChunkSize;
+        const uint32_t end = std::min(begin + kChunkSize, minor);
+        std::vector<crypto::public_key> chunk =
+            hwdev.get_subaddress_spend_public_keys(keys, index_major, begin, end);
+        std::copy(chunk.begin(), chunk.end(),
+                  pkeys.begin() + size_t{index_major} * minor + begin);
+      });
+
+  Table table;
+  table.reserve(pkeys.size());
+  for (uint32_t index_major = 0; index_major < major; ++index_major) {
+    for (uint32_t index_minor = 0; index_minor < minor; ++index_minor) {
+      table.emplace_back(pkeys[size_t{index_major} * minor + index_minor],
+                         cryptonote::subaddress_index{index_major, index_minor});
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_table = std::move(table);
+  m_build_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - m_start_time);
+  m_done = true;
+  m_done_cond.notify_all();
+}
+
+bool SubaddressLookahead::take(Table* table) {
+  if (!m_running) {
+    return false;
+  }
+  const auto wait_start = std::chrono::steady_clock::now();
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cond.wait(lock, [this]() { return m_done; });
+    *table = std::move(m_table);
+    m_table.clear();
+  }
+  m_thread.join();
+  m_running = false;
+  auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - wait_start);
+  LOGI("Subaddress lookahead table ready: %zu keys on %zu threads, built in %lld ms,"
+       " waited %lld ms",
+       table->size(), ParallelForThreadCount(),
+       static_cast<long long>(m_build_time.count()),
+       static_cast<long long>(waited.count()));
+  return true;
+}
+
+}  // namespace monero
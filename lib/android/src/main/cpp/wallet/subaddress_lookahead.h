@@ -0,0 +1,61 @@
+#ifndef WALLET_SUBADDRESS_LOOKAHEAD_H_
+#define WALLET_SUBADDRESS_LOOKAHEAD_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/subaddress_index.h"
+
+namespace monero {
+
+// Builds the subaddress lookahead table of a restored account off the
+// calling thread.
+//
+// wallet2 derives the spend public keys of every subaddress it looks ahead
+// for (50 accounts of 200 subaddresses by default) before the first block
+// can be scanned, one key at a time.  Instead, the wallet is restored with
+// the primary address alone and the keys are derived here, spread across
+// wallet2's compute thread pool.  The owner must install the table into
+// wallet2 before any block is scanned or its subaddress map is read or
+// extended; take() blocks until it is ready.
+class SubaddressLookahead {
+ public:
+  using Table = std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>;
+
+  // Number of subaddresses derived by each work item.
+  static constexpr uint32_t kChunkSize = 50;
+
+  SubaddressLookahead() : m_running(false), m_done(false) {}
+  ~SubaddressLookahead();
+
+  SubaddressLookahead(const SubaddressLookahead&) = delete;
+  void operator=(const SubaddressLookahead&) = delete;
+
+  // Starts deriving subaddresses [0, minor) of accounts [0, major).
+  void start(const cryptonote::account_keys& keys, uint32_t major, uint32_t minor);
+
+  // Waits for the table and moves it to `table`.  Returns false if nothing
+  // was started since the last call.
+  bool take(Table* table);
+
+ private:
+  void build(cryptonote::account_keys keys, uint32_t major, uint32_t minor);
+
+  std::mutex m_mutex;
+  std::condition_variable m_done_cond;
+  std::thread m_thread;
+  bool m_running;
+  bool m_done;
+  Table m_table;
+  std::chrono::steady_clock::time_point m_start_time;
+  std::chrono::milliseconds m_build_time;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_SUBADDRESS_LOOKAHEAD_H_
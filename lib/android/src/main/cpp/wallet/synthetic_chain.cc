@@ -0,0 +1,590 @@
+#include "synthetic_chain.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <limits>
+
+#include "common/debug.h"
+
+#include "parallel_for.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "net/jsonrpc_structs.h"
+#include "ringct/rctOps.h"
+#include "serialization/keyvalue_serialization.h"
+#include "storages/portable_storage_template_helper.h"
+#include "string_tools.h"
+
+namespace monero {
+
+namespace {
+
+// Consensus version of the generated blocks: tagged outputs, BP+ txs.
+const uint8_t kBlockVersion = 16;
+
+const uint64_t kFirstTimestamp = 1600000000;
+const uint64_t kBlockReward = 600000000000;
+const uint64_t kTxFee = 30000000;
+
+// Response limits of monerod.
+const uint64_t kMaxBlocksPerResponse = 1000;
+const uint64_t kMaxHashesPerResponse = 10000;
+
+// Seeds the miner tx apart from the other txs of a block.
+const uint32_t kMinerTxIndex = std::numeric_limits<uint32_t>::max();
+
+struct JsonRpcCall {
+  std::string method;
+
+  BEGIN_KV_SERIALIZE_MAP()
+    KV_SERIALIZE(method)
+  END_KV_SERIALIZE_MAP()
+};
+
+}  // namespace
+
+// Counter-mode hash of (seed, branch, height, tx).  Same inputs, same chain.
+class SyntheticChain::Rng {
+ public:
+  Rng(uint64_t seed, uint64_t branch, uint64_t height, uint32_t tx) : m_counter(0) {
+    static_assert(sizeof(m_state) == 3 * sizeof(uint64_t) + 2 * sizeof(uint32_t),
+                  "Unexpected padding");
+    memcpy(m_state, &seed, sizeof(seed));
+    memcpy(m_state + 8, &branch, sizeof(branch));
+    memcpy(m_state + 16, &height, sizeof(height));
+    memcpy(m_state + 24, &tx, sizeof(tx));
+  }
+
+  crypto::hash next() {
+    memcpy(m_state + 28, &m_counter, sizeof(m_counter));
+    ++m_counter;
+    return crypto::cn_fast_hash(m_state, sizeof(m_state));
+  }
+
+  // Uniform enough in [lo, hi] for ranges far below 2^64.
+  uint64_t uniform(uint64_t lo, uint64_t hi) {
+    if (lo >= hi) {
+      return lo;
+    }
+    crypto::hash h = next();
+    uint64_t value;
+    memcpy(&value, h.data, sizeof(value));
+    return lo + value % (hi - lo + 1);
+  }
+
+  rct::key scalar() {
+    crypto::hash h = next();
+    rct::key k;
+    memcpy(k.bytes, h.data, sizeof(k.bytes));
+    sc_reduce32(k.bytes);
+    return k;
+  }
+
+  rct::key point() { return rct::scalarmultBase(scalar()); }
+
+  char byte() { return next().data[0]; }
+
+ private:
+  char m_state[32];
+  uint32_t m_counter;
+};
+
+SyntheticChain::SyntheticChain(cryptonote::network_type nettype,
+                               const cryptonote::account_public_address& address,
+                               const crypto::secret_key& view_secret_key,
+                               const SyntheticChainParams& params)
+    : m_nettype(nettype),
+      m_params(params),
+      m_branch(0),
+      m_owned_outputs(0),
+      m_owned_amount(0) {
+  LOG_FATAL_IF(params.accounts == 0 || params.subaddresses_per_account == 0,
+               "No subaddress to pay");
+  cryptonote::account_keys keys;
+  keys.m_account_address = address;
+  keys.m_view_secret_key = view_secret_key;
+  hw::device& hwdev = keys.get_device();
+  const uint32_t minors = params.subaddresses_per_account;
+  m_recipients.resize(size_t{params.accounts} * minors);
+  ParallelFor(m_recipients.size(), [&](size_t i) {
+    cryptonote::subaddress_index index = {static_cast<uint32_t>(i / minors),
+                                          static_cast<uint32_t>(i % minors)};
+    Recipient& recipient = m_recipients[i];
+    recipient.is_subaddress = !index.is_zero();
+    if (recipient.is_subaddress) {
+      recipient.spend_public_key = hwdev.get_subaddress_spend_public_key(keys, index);
+      recipient.view_public_key = rct::rct2pk(
+          rct::scalarmultKey(rct::pk2rct(recipient.spend_public_key),
+                             rct::sk2rct(view_secret_key)));
+    } else {
+      recipient.spend_public_key = address.m_spend_public_key;
+      recipient.view_public_key = address.m_view_public_key;
+    }
+  });
+  keys.m_view_secret_key = crypto::null_skey;
+
+  cryptonote::block genesis;
+  const auto& config = cryptonote::get_config(nettype);
+  LOG_FATAL_IF(!cryptonote::generate_genesis_block(genesis, config.GENESIS_TX,
+                                                   config.GENESIS_NONCE),
+               "Failed to generate genesis block");
+  Block block;
+  block.hash = cryptonote::get_block_hash(genesis);
+  block.blob = cryptonote::block_to_blob(genesis);
+  // The genesis output is pre-RingCT and has an index of its own amount.
+  block.output_indices.indices.resize(1);
+  block.output_indices.indices[0].indices.push_back(0);
+  block.first_output = 0;
+  block.owned_outputs = 0;
+  block.owned_amount = 0;
+  m_heights[block.hash] = 0;
+  m_blocks.push_back(std::move(block));
+
+  extend(params.blocks);
+}
+
+void SyntheticChain::extend(uint64_t count) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < count; ++i) {
+    appendBlockLocked();
+  }
+  LOGI("Synthetic chain extended to height %zu in %lld ms: %" PRIu64 " owned outputs, "
+       "%zu outputs total",
+       m_blocks.size(),
+       static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::steady_clock::now() - start).count()),
+       m_owned_outputs, m_outputs.size());
+}
+
+void SyntheticChain::reorg(uint64_t depth, uint64_t count) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    depth = std::min<uint64_t>(depth, m_blocks.size() - 1);
+    for (uint64_t i = 0; i < depth; ++i) {
+      const Block& block = m_blocks.back();
+      m_heights.erase(block.hash);
+      m_owned_outputs -= block.owned_outputs;
+      m_owned_amount -= block.owned_amount;
+      m_outputs.resize(block.first_output);
+      m_blocks.pop_back();
+    }
+    ++m_branch;
+    LOGI("Synthetic chain reorg: popped %" PRIu64 " blocks, branch %" PRIu64 " from height %zu",
+         depth, m_branch, m_blocks.size());
+  }
+  extend(count);
+}
+
+uint64_t SyntheticChain::height() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_blocks.size();
+}
+
+crypto::hash SyntheticChain::topHash() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_blocks.back().hash;
+}
+
+uint64_t SyntheticChain::ownedOutputs() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_owned_outputs;
+}
+
+uint64_t SyntheticChain::ownedAmount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_owned_amount;
+}
+
+void SyntheticChain::appendBlockLocked() {
+  const uint64_t height = m_blocks.size();
+
+  std::vector<GeneratedTx> txs(m_params.txs_per_block);
+  ParallelFor(txs.size(), [&](size_t i) {
+    txs[i] = makeTransaction(height, static_cast<uint32_t>(i));
+  });
+
+  Rng rng(m_params.seed, m_branch, height, kMinerTxIndex);
+  cryptonote::transaction miner_tx;
+  miner_tx.version = 2;
+  miner_tx.unlock_time = height + CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
+  cryptonote::txin_gen in;
+  in.height = height;
+  miner_tx.vin.push_back(in);
+  cryptonote::txout_to_tagged_key miner_target;
+  miner_target.key = rct::rct2pk(rng.point());
+  miner_target.view_tag.data = rng.byte();
+  cryptonote::tx_out miner_out;
+  miner_out.amount = kBlockReward;
+  miner_out.target = miner_target;
+  miner_tx.vout.push_back(miner_out);
+  cryptonote::add_tx_pub_key_to_extra(miner_tx, rct::rct2pk(rng.point()));
+  miner_tx.rct_signatures.type = rct::RCTTypeNull;
+
+  cryptonote::block b;
+  b.major_version = kBlockVersion;
+  b.minor_version = kBlockVersion;
+  b.timestamp = kFirstTimestamp + height * DIFFICULTY_TARGET_V2;
+  b.prev_id = m_blocks.back().hash;
+  b.nonce = static_cast<uint32_t>(m_branch);
+  b.miner_tx = miner_tx;
+  for (const auto& tx: txs) {
+    b.tx_hashes.push_back(tx.hash);
+  }
+
+  Block block;
+  block.hash = cryptonote::get_block_hash(b);
+  block.blob = cryptonote::block_to_blob(b);
+  block.first_output = m_outputs.size();
+  block.owned_outputs = 0;
+  block.owned_amount = 0;
+  auto& indices = block.output_indices.indices;
+  indices.resize(1 + txs.size());
+  indices[0].indices.push_back(m_outputs.size());
+  m_outputs.push_back({miner_target.key, rct::zeroCommit(kBlockReward),
+                       cryptonote::get_transaction_hash(miner_tx), height});
+  for (size_t i = 0; i < txs.size(); ++i) {
+    GeneratedTx& tx = txs[i];
+    for (Output& output: tx.outputs) {
+      output.height = height;
+      indices[1 + i].indices.push_back(m_outputs.size());
+      m_outputs.push_back(output);
+    }
+    block.txs.push_back(std::move(tx.entry));
+    block.owned_outputs += tx.owned_outputs;
+    block.owned_amount += tx.owned_amount;
+  }
+  m_owned_outputs += block.owned_outputs;
+  m_owned_amount += block.owned_amount;
+  m_heights[block.hash] = height;
+  m_blocks.push_back(std::move(block));
+}
+
+SyntheticChain::GeneratedTx SyntheticChain::makeTransaction(uint64_t height,
+                                                            uint32_t index) const {
+  Rng rng(m_params.seed, m_branch, height, index);
+  GeneratedTx result;
+
+  cryptonote::transaction tx;
+  tx.version = 2;
+  tx.unlock_time = 0;
+  cryptonote::txin_to_key in;
+  in.amount = 0;
+  in.key_offsets.push_back(rng.uniform(0, height));
+  crypto::hash key_image = rng.next();
+  memcpy(in.k_image.data, key_image.data, sizeof(in.k_image.data));
+  tx.vin.push_back(in);
+
+  rct::rctSig& rv = tx.rct_signatures;
+  rv.type = rct::RCTTypeBulletproofPlus;
+  rv.txnFee = kTxFee;
+
+  // One tx key per output, as wallets do when paying several subaddresses.
+  std::vector<crypto::public_key> additional_tx_keys;
+  for (uint32_t i = 0; i < m_params.outputs_per_tx; ++i) {
+    const uint64_t amount = rng.uniform(m_params.min_amount, m_params.max_amount);
+    const rct::key r = rng.scalar();
+    rct::key tx_key;
+    rct::key shared_secret;
+    cryptonote::txout_to_tagged_key target;
+    if (rng.uniform(0, 999) < m_params.owned_per_mille) {
+      const Recipient& to = m_recipients[rng.uniform(0, m_recipients.size() - 1)];
+      tx_key = to.is_subaddress ? rct::scalarmultKey(rct::pk2rct(to.spend_public_key), r)
+                                : rct::scalarmultBase(r);
+      crypto::key_derivation derivation;
+      crypto::generate_key_derivation(to.view_public_key, rct::rct2sk(r), derivation);
+      crypto::derive_public_key(derivation, i, to.spend_public_key, target.key);
+      crypto::derive_view_tag(derivation, i, target.view_tag);
+      crypto::ec_scalar scalar;
+      crypto::derivation_to_scalar(derivation, i, scalar);
+      memcpy(shared_secret.bytes, &scalar, sizeof(shared_secret.bytes));
+      ++result.owned_outputs;
+      result.owned_amount += amount;
+    } else {
+      tx_key = rct::scalarmultBase(r);
+      target.key = rct::rct2pk(rng.point());
+      target.view_tag.data = rng.byte();
+      shared_secret = rng.scalar();
+    }
+    additional_tx_keys.push_back(rct::rct2pk(tx_key));
+
+    rct::ecdhTuple ecdh;
+    ecdh.mask = rct::zero();
+    ecdh.amount = rct::d2h(amount);
+    rct::ecdhEncode(ecdh, shared_secret, true);
+    rv.ecdhInfo.push_back(ecdh);
+    rct::ctkey out_pk;
+    out_pk.dest = rct::pk2rct(target.key);
+    out_pk.mask = rct::commit(amount, rct::genCommitmentMask(shared_secret));
+    rv.outPk.push_back(out_pk);
+
+    cryptonote::tx_out out;
+    out.amount = 0;
+    out.target = target;
+    tx.vout.push_back(out);
+    result.outputs.push_back({target.key, out_pk.mask, crypto::null_hash, 0});
+  }
+  cryptonote::add_tx_pub_key_to_extra(tx, rct::rct2pk(rng.point()));
+  cryptonote::add_additional_tx_pub_keys_to_extra(tx.extra, additional_tx_keys);
+
+  // Served pruned, so the prunable part only needs a hash.
+  tx.pruned = true;
+  result.entry.blob = cryptonote::tx_to_blob(tx);
+  result.entry.prunable_hash = rng.next();
+  result.hash = cryptonote::get_pruned_transaction_hash(tx, result.entry.prunable_hash);
+  for (Output& output: result.outputs) {
+    output.txid = result.hash;
+  }
+  return result;
+}
+
+// As monerod: the list ends with the genesis block, and the first id known
+// on the current branch is where the supplement starts.
+template<typename HashList>
+bool SyntheticChain::findSplitLocked(const HashList& block_ids, uint64_t* height) const {
+  if (block_ids.empty() || block_ids.back() != m_blocks.front().hash) {
+    return false;
+  }
+  for (const crypto::hash& id: block_ids) {
+    auto it = m_heights.find(id);
+    if (it != m_heights.end()) {
+      *height = it->second;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SyntheticChain::getBlocks(const GetBlocksRequest& req, GetBlocksResponse* res) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t start;
+  if (req.start_height > 0) {
+    if (req.start_height >= m_blocks.size()) {
+      return false;
+    }
+    start = req.start_height;
+  } else if (!findSplitLocked(req.block_ids, &start)) {
+    return false;
+  }
+  const uint64_t end = std::min<uint64_t>(m_blocks.size(), start + kMaxBlocksPerResponse);
+  for (uint64_t height = start; height < end; ++height) {
+    const Block& block = m_blocks[height];
+    cryptonote::block_complete_entry entry;
+    entry.pruned = true;
+    entry.block = block.blob;
+    entry.block_weight = block.blob.size();
+    entry.txs = block.txs;
+    for (const auto& tx: block.txs) {
+      entry.block_weight += tx.blob.size();
+    }
+    res->blocks.push_back(std::move(entry));
+    res->output_indices.push_back(block.output_indices);
+    if (req.no_miner_tx) {
+      res->output_indices.back().indices[0].indices.clear();
+    }
+  }
+  res->start_height = start;
+  res->current_height = m_blocks.size();
+  res->status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool SyntheticChain::getHashes(const cryptonote::COMMAND_RPC_GET_HASHES_FAST::request& req,
+                               cryptonote::COMMAND_RPC_GET_HASHES_FAST::response* res) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t start;
+  if (!findSplitLocked(req.block_ids, &start)) {
+    return false;
+  }
+  start = std::min<uint64_t>(std::max(start, req.start_height), m_blocks.size());
+  const uint64_t end = std::min<uint64_t>(m_blocks.size(), start + kMaxHashesPerResponse);
+  for (uint64_t height = start; height < end; ++height) {
+    res->m_block_ids.push_back(m_blocks[height].hash);
+  }
+  res->start_height = start;
+  res->current_height = m_blocks.size();
+  res->status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool SyntheticChain::getOutputs(const cryptonote::COMMAND_RPC_GET_OUTPUTS_BIN::request& req,
+                                cryptonote::COMMAND_RPC_GET_OUTPUTS_BIN::response* res) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& requested: req.outputs) {
+    if (requested.amount != 0 || requested.index >= m_outputs.size()) {
+      return false;
+    }
+    const Output& output = m_outputs[requested.index];
+    cryptonote::COMMAND_RPC_GET_OUTPUTS_BIN::outkey out;
+    out.key = output.key;
+    out.mask = output.commitment;
+    out.unlocked = output.height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE <= m_blocks.size();
+    out.height = output.height;
+    out.txid = req.get_txid ? output.txid : crypto::null_hash;
+    res->outs.push_back(out);
+  }
+  res->status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+std::mutex SyntheticNode::s_mutex;
+std::shared_ptr<SyntheticChain> SyntheticNode::s_chain;
+
+void SyntheticNode::serve(std::shared_ptr<SyntheticChain> chain) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_chain = std::move(chain);
+}
+
+void SyntheticNode::stop() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_chain.reset();
+}
+
+std::shared_ptr<SyntheticChain> SyntheticNode::chain() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  return s_chain;
+}
+
+bool SyntheticNodeClient::invoke(const boost::string_ref uri,
+                                 const boost::string_ref method,
+                                 const boost::string_ref body,
+                                 std::chrono::milliseconds timeout,
+                                 const epee::net_utils::http::http_response_info** ppresponse_info,
+                                 const epee::net_utils::http::fields_list& additional_params) {
+  m_response_info.clear();
+  m_bytes_sent += body.size();
+  bool ok;
+  if (uri == "/getblocks.bin") {
+    ok = invokeBinary(body, &SyntheticChain::getBlocks);
+  } else if (uri == "/gethashes.bin") {
+    ok = invokeBinary(body, &SyntheticChain::getHashes);
+  } else if (uri == "/get_outs.bin") {
+    ok = invokeBinary(body, &SyntheticChain::getOutputs);
+  } else if (uri == "/get_transaction_pool_hashes.bin") {
+    // The pool is always empty.
+    cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES_BIN::response res;
+    res.status = CORE_RPC_STATUS_OK;
+    epee::byte_slice res_body;
+    ok = epee::serialization::store_t_to_binary(res, res_body);
+    if (ok) {
+      setResponse("application/octet-stream",
+                  std::string(reinterpret_cast<const char*>(res_body.data()), res_body.size()));
+    }
+  } else if (uri == "/get_height" || uri == "/getheight") {
+    cryptonote::COMMAND_RPC_GET_HEIGHT::response res;
+    res.height = m_chain->height();
+    res.hash = epee::string_tools::pod_to_hex(m_chain->topHash());
+    res.status = CORE_RPC_STATUS_OK;
+    ok = setJsonResponse(res);
+  } else if (uri == "/json_rpc") {
+    ok = invokeJsonRpc(body);
+  } else {
+    LOGW("Synthetic node does not serve %s", std::string(uri.data(), uri.size()).c_str());
+    ok = false;
+  }
+  if (ok && ppresponse_info) {
+    *ppresponse_info = std::addressof(m_response_info);
+  }
+  return ok;
+}
+
+template<typename Request, typename Response>
+bool SyntheticNodeClient::invokeBinary(
+    const boost::string_ref body,
+    bool (SyntheticChain::*call)(const Request&, Response*) const) {
+  Request req;
+  if (!epee::serialization::load_t_from_binary(req, epee::strspan<uint8_t>(body))) {
+    return false;
+  }
+  Response res;
+  if (!((*m_chain).*call)(req, &res)) {
+    res = Response();
+    res.status = "Failed";
+  }
+  epee::byte_slice res_body;
+  if (!epee::serialization::store_t_to_binary(res, res_body)) {
+    return false;
+  }
+  setResponse("application/octet-stream",
+              std::string(reinterpret_cast<const char*>(res_body.data()), res_body.size()));
+  return true;
+}
+
+bool SyntheticNodeClient::invokeJsonRpc(const boost::string_ref body) {
+  const std::string json(body.data(), body.size());
+  JsonRpcCall call;
+  if (!epee::serialization::load_t_from_json(call, json)) {
+    return false;
+  }
+  const uint64_t height = m_chain->height();
+  if (call.method == "get_version") {
+    cryptonote::COMMAND_RPC_GET_VERSION::response res;
+    res.version = CORE_RPC_VERSION;
+    res.release = true;
+    res.status = CORE_RPC_STATUS_OK;
+    return setJsonRpcResponse(res);
+  }
+  if (call.method == "get_info") {
+    cryptonote::COMMAND_RPC_GET_INFO::response res;
+    res.height = height;
+    res.target_height = height;
+    res.top_block_hash = epee::string_tools::pod_to_hex(m_chain->topHash());
+    res.mainnet = m_chain->nettype() == cryptonote::MAINNET;
+    res.testnet = m_chain->nettype() == cryptonote::TESTNET;
+    res.stagenet = m_chain->nettype() == cryptonote::STAGENET;
+    res.status = CORE_RPC_STATUS_OK;
+    return setJsonRpcResponse(res);
+  }
+  if (call.method == "get_block_count") {
+    cryptonote::COMMAND_RPC_GETBLOCKCOUNT::response res;
+    res.count = height;
+    res.status = CORE_RPC_STATUS_OK;
+    return setJsonRpcResponse(res);
+  }
+  if (call.method == "hard_fork_info") {
+    epee::json_rpc::request<cryptonote::COMMAND_RPC_HARD_FORK_INFO::request> req;
+    if (!epee::serialization::load_t_from_json(req, json)) {
+      return false;
+    }
+    // Every fork up to the block version is active from the start.
+    cryptonote::COMMAND_RPC_HARD_FORK_INFO::response res;
+    res.version = kBlockVersion;
+    res.enabled = true;
+    res.earliest_height = req.params.version <= kBlockVersion
+                          ? 0 : std::numeric_limits<uint64_t>::max();
+    res.status = CORE_RPC_STATUS_OK;
+    return setJsonRpcResponse(res);
+  }
+  LOGW("Synthetic node does not serve %s", call.method.c_str());
+  return false;
+}
+
+template<typename Response>
+bool SyntheticNodeClient::setJsonResponse(const Response& res) {
+  std::string res_body;
+  if (!epee::serialization::store_t_to_json(res, res_body)) {
+    return false;
+  }
+  setResponse("application/json", std::move(res_body));
+  return true;
+}
+
+template<typename Result>
+bool SyntheticNodeClient::setJsonRpcResponse(const Result& result) {
+  epee::json_rpc::response<Result, epee::json_rpc::dummy_error> res;
+  res.jsonrpc = "2.0";
+  res.id = epee::serialization::storage_entry(uint64_t{0});
+  res.result = result;
+  return setJsonResponse(res);
+}
+
+void SyntheticNodeClient::setResponse(const char* content_type, std::string body) {
+  m_bytes_received += body.size();
+  m_response_info.m_response_code = 200;
+  m_response_info.m_mime_tipe = content_type;
+  m_response_info.m_body = std::move(body);
+}
+
+}  // namespace monero
@@ -0,0 +1,194 @@
+#ifndef WALLET_SYNTHETIC_CHAIN_H_
+#define WALLET_SYNTHETIC_CHAIN_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "block_cache.h"
+#include "http_client.h"
+
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "ringct/rctTypes.h"
+
+namespace monero {
+
+struct SyntheticChainParams {
+  uint64_t seed = 0;
+  // Blocks generated above the genesis block.
+  uint64_t blocks = 1000;
+  uint32_t txs_per_block = 4;
+  uint32_t outputs_per_tx = 2;
+  // Outputs paying the wallet, per thousand; the rest go to random keys.
+  uint32_t owned_per_mille = 500;
+  // Owned outputs go to subaddresses picked uniformly from the first
+  // `accounts` x `subaddresses_per_account`, primary address included.
+  uint32_t accounts = 1;
+  uint32_t subaddresses_per_account = 1;
+  uint64_t min_amount = 1000000;
+  uint64_t max_amount = 1000000000000;
+};
+
+// Chain of made-up blocks that wallet2 scans as if they came from a node.
+//
+// Blocks start from the real genesis block of the network and follow the
+// current consensus format: version 2 transactions with tagged outputs and
+// encrypted amounts, served pruned.  Nothing else is valid: there is no
+// proof of work, inputs spend random key images and range proofs are left
+// out.  Owned outputs are derived from the recipient's view secret key and
+// address, one additional tx public key per output, so that any
+// subaddress can be paid.
+//
+// Generation is deterministic for given params and recipient.  Thread-safe.
+class SyntheticChain {
+ public:
+  SyntheticChain(cryptonote::network_type nettype,
+                 const cryptonote::account_public_address& address,
+                 const crypto::secret_key& view_secret_key,
+                 const SyntheticChainParams& params);
+
+  // Appends `count` blocks to the current branch.
+  void extend(uint64_t count);
+
+  // Pops `depth` blocks and grows a new branch of `count` blocks in their
+  // place.  The genesis block stays.
+  void reorg(uint64_t depth, uint64_t count);
+
+  uint64_t height() const;
+
+  // Outputs paying the recipient on the current branch, and their total.
+  uint64_t ownedOutputs() const;
+  uint64_t ownedAmount() const;
+
+  // Daemon calls, answered as monerod would for the current branch.
+  bool getBlocks(const GetBlocksRequest& req, GetBlocksResponse* res) const;
+  bool getHashes(const cryptonote::COMMAND_RPC_GET_HASHES_FAST::request& req,
+                 cryptonote::COMMAND_RPC_GET_HASHES_FAST::response* res) const;
+  bool getOutputs(const cryptonote::COMMAND_RPC_GET_OUTPUTS_BIN::request& req,
+                  cryptonote::COMMAND_RPC_GET_OUTPUTS_BIN::response* res) const;
+  crypto::hash topHash() const;
+
+  cryptonote::network_type nettype() const { return m_nettype; }
+
+ private:
+  struct Recipient {
+    crypto::public_key spend_public_key;
+    crypto::public_key view_public_key;
+    bool is_subaddress;
+  };
+
+  struct Output {
+    crypto::public_key key;
+    rct::key commitment;
+    crypto::hash txid;
+    uint64_t height;
+  };
+
+  struct GeneratedTx {
+    cryptonote::tx_blob_entry entry;
+    crypto::hash hash;
+    std::vector<Output> outputs;
+    uint64_t owned_outputs = 0;
+    uint64_t owned_amount = 0;
+  };
+
+  struct Block {
+    crypto::hash hash;
+    cryptonote::blobdata blob;
+    std::vector<cryptonote::tx_blob_entry> txs;
+    cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices output_indices;
+    // Global index of the first output, for popping the block.
+    uint64_t first_output;
+    uint64_t owned_outputs;
+    uint64_t owned_amount;
+  };
+
+  class Rng;
+
+  void appendBlockLocked();
+  GeneratedTx makeTransaction(uint64_t height, uint32_t index) const;
+
+  // Height of the highest of `block_ids` on the current branch.
+  template<typename HashList>
+  bool findSplitLocked(const HashList& block_ids, uint64_t* height) const;
+
+  const cryptonote::network_type m_nettype;
+  const SyntheticChainParams m_params;
+  std::vector<Recipient> m_recipients;
+
+  mutable std::mutex m_mutex;
+  std::vector<Block> m_blocks;
+  std::vector<Output> m_outputs;
+  std::unordered_map<crypto::hash, uint64_t> m_heights;
+  uint64_t m_branch;
+  uint64_t m_owned_outputs;
+  uint64_t m_owned_amount;
+};
+
+// Process-wide stand-in daemon.  While a chain is served, wallets created
+// from then on talk to a SyntheticNodeClient instead of the remote node.
+class SyntheticNode {
+ public:
+  static void serve(std::shared_ptr<SyntheticChain> chain);
+  static void stop();
+
+  static std::shared_ptr<SyntheticChain> chain();
+
+ private:
+  static std::mutex s_mutex;
+  static std::shared_ptr<SyntheticChain> s_chain;
+};
+
+// Node client answering getblocks.bin, gethashes.bin and get_outs.bin from a
+// SyntheticChain, along with the few JSON calls wallet2 makes to check the
+// node.  Other calls fail as if the node could not be reached.
+class SyntheticNodeClient : public NodeClientBase {
+ public:
+  explicit SyntheticNodeClient(std::shared_ptr<SyntheticChain> chain)
+      : m_chain(std::move(chain)) {}
+
+  bool invoke(const boost::string_ref uri,
+              const boost::string_ref method,
+              const boost::string_ref body,
+              std::chrono::milliseconds timeout,
+              const epee::net_utils::http::http_response_info** ppresponse_info,
+              const epee::net_utils::http::fields_list& additional_params) override;
+
+ private:
+  template<typename Request, typename Response>
+  bool invokeBinary(const boost::string_ref body,
+                    bool (SyntheticChain::*call)(const Request&, Response*) const);
+  bool invokeJsonRpc(const boost::string_ref body);
+
+  template<typename Response>
+  bool setJsonResponse(const Response& res);
+  template<typename Result>
+  bool setJsonRpcResponse(const Result& result);
+
+  void setResponse(const char* content_type, std::string body);
+
+  const std::shared_ptr<SyntheticChain> m_chain;
+  epee::net_utils::http::http_response_info m_response_info;
+};
+
+class SyntheticNodeClientFactory : public HttpClientFactory {
+ public:
+  explicit SyntheticNodeClientFactory(std::shared_ptr<SyntheticChain> chain)
+      : m_chain(std::move(chain)) {}
+
+  std::unique_ptr<AbstractHttpClient> create() override {
+    return std::unique_ptr<AbstractHttpClient>(new SyntheticNodeClient(m_chain));
+  }
+
+ private:
+  const std::shared_ptr<SyntheticChain> m_chain;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_SYNTHETIC_CHAIN_H_
@@ -0,0 +1,431 @@
+#include "tx_history.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "common/debug.h"
+
+namespace monero {
+
+constexpr uint32_t TxHistoryQuery::kAnyIndex;
+constexpr uint64_t TxHistory::kUnconfirmedHeight;
+
+namespace {
+
+// Snapshot generations start at 1, so that no cursor but the start cursor
+// has a zero generation.
+std::atomic<uint32_t> g_next_generation(1);
+
+template<typename Key>
+crypto::hash ToPoolKey(const Key& key) {
+  static_assert(sizeof(Key) == sizeof(crypto::hash), "Pool keys are 32 bytes");
+  crypto::hash out;
+  memcpy(&out, &key, sizeof(out));
+  return out;
+}
+
+template<typename Key>
+Key FromPoolKey(const crypto::hash& value) {
+  Key out;
+  memcpy(&out, &value, sizeof(out));
+  return out;
+}
+
+template<typename T>
+size_t VectorBytes(const std::vector<T>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+// Reorders `column` so that its row i is the former row order[i].
+template<typename T>
+void Permute(std::vector<T>* column, const std::vector<uint32_t>& order) {
+  std::vector<T> sorted;
+  sorted.reserve(order.size());
+  for (uint32_t row: order) {
+    sorted.push_back((*column)[row]);
+  }
+  column->swap(sorted);
+}
+
+}  // namespace
+
+void TxHistory::BitColumn::push_back(bool bit) {
+  if (m_size % 64 == 0) {
+    m_words.push_back(0);
+  }
+  if (bit) {
+    m_words.back() |= uint64_t{1} << (m_size % 64);
+  }
+  ++m_size;
+}
+
+bool TxHistory::TxDetails::operator==(const TxDetails& other) const {
+  return tx_hash == other.tx_hash
+      && height == other.height
+      && unlock_time == other.unlock_time
+      && timestamp == other.timestamp
+      && fee == other.fee
+      && change == other.change
+      && state == other.state
+      && coinbase == other.coinbase;
+}
+
+size_t TxHistory::TxDetailsHash::operator()(const TxDetails& tx) const {
+  // Entries of the same tx differ in few fields, if any.
+  size_t h = std::hash<crypto::hash>()(tx.tx_hash);
+  for (uint64_t v: {tx.height, tx.unlock_time, tx.timestamp, tx.fee, tx.change,
+                    uint64_t{tx.state}, uint64_t{tx.coinbase}}) {
+    h = h * 31 + std::hash<uint64_t>()(v);
+  }
+  return h;
+}
+
+template<typename T, typename Hash>
+uint32_t TxHistory::Pool<T, Hash>::intern(const T& value) {
+  if (value == m_values[0]) {
+    return 0;
+  }
+  auto it = m_index.find(value);
+  if (it != m_index.end()) {
+    return it->second;
+  }
+  LOG_FATAL_IF(m_values.size() > UINT32_MAX, "Tx history pool overflow");
+  auto ref = static_cast<uint32_t>(m_values.size());
+  m_values.push_back(value);
+  m_index.emplace(value, ref);
+  return ref;
+}
+
+template<typename T, typename Hash>
+void TxHistory::Pool<T, Hash>::clear() {
+  m_values.resize(1);
+  m_index.clear();
+}
+
+template<typename T, typename Hash>
+void TxHistory::Pool<T, Hash>::seal() {
+  std::unordered_map<T, uint32_t, Hash>().swap(m_index);
+  m_values.shrink_to_fit();
+}
+
+template<typename T, typename Hash>
+size_t TxHistory::Pool<T, Hash>::memory_usage() const {
+  return VectorBytes(m_values) + m_index.size() * (sizeof(T) + sizeof(uint32_t) + 2 * sizeof(void*));
+}
+
+template<>
+size_t TxHistory::Pool<std::string>::memory_usage() const {
+  size_t bytes = VectorBytes(m_values);
+  for (const auto& value: m_values) {
+    // Strings past the small-string buffer own a heap block.
+    if (value.capacity() > sizeof(std::string)) {
+      bytes += value.capacity() + 1;
+    }
+  }
+  return bytes;
+}
+
+void TxHistory::clear() {
+  m_by_timestamp.clear();
+  m_generation = 0;
+  m_txs.clear();
+  m_keys.clear();
+  m_subaddresses.clear();
+  m_recipients.clear();
+  m_tx.clear();
+  m_public_key.clear();
+  m_key_image.clear();
+  m_recipient.clear();
+  m_subaddress.clear();
+  m_amount.clear();
+  m_outgoing.clear();
+  m_public_key_known.clear();
+  m_key_image_known.clear();
+}
+
+void TxHistory::reserve(size_t n) {
+  m_tx.reserve(n);
+  m_public_key.reserve(n);
+  m_key_image.reserve(n);
+  m_recipient.reserve(n);
+  m_subaddress.reserve(n);
+  m_amount.reserve(n);
+  m_outgoing.reserve(n);
+  m_public_key_known.reserve(n);
+  m_key_image_known.reserve(n);
+}
+
+void TxHistory::append(const TxInfo& tx) {
+  TxDetails details{};
+  details.tx_hash = tx.m_tx_hash;
+  details.height = tx.m_height;
+  details.unlock_time = tx.m_unlock_time;
+  details.timestamp = tx.m_timestamp;
+  details.fee = tx.m_fee;
+  details.change = tx.m_change;
+  details.state = static_cast<uint8_t>(tx.m_state);
+  details.coinbase = tx.m_coinbase;
+  m_tx.push_back(m_txs.intern(details));
+  m_public_key.push_back(
+      tx.m_public_key_known ? m_keys.intern(ToPoolKey(tx.m_public_key)) : 0);
+  m_key_image.push_back(
+      tx.m_key_image_known ? m_keys.intern(ToPoolKey(tx.m_key_image)) : 0);
+  m_recipient.push_back(m_recipients.intern(tx.m_recipient));
+  m_subaddress.push_back(m_subaddresses.intern(
+      (uint64_t{tx.m_subaddress_major} << 32) | tx.m_subaddress_minor));
+  m_amount.push_back(tx.m_amount);
+  m_outgoing.push_back(tx.m_type == TxInfo::OUTGOING);
+  m_public_key_known.push_back(tx.m_public_key_known);
+  m_key_image_known.push_back(tx.m_key_image_known);
+}
+
+void TxHistory::seal() {
+  m_txs.seal();
+  m_keys.seal();
+  m_subaddresses.seal();
+  m_recipients.seal();
+  sortRows();
+  buildIndexes();
+}
+
+// Puts the rows in height order, which is the order most queries ask for.
+void TxHistory::sortRows() {
+  const auto n = static_cast<uint32_t>(size());
+  std::vector<uint32_t> order(n);
+  for (uint32_t row = 0; row < n; ++row) {
+    order[row] = row;
+  }
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    uint64_t ha = sort_height(a), hb = sort_height(b);
+    return ha != hb ? ha < hb : timestamp(a) < timestamp(b);
+  });
+  BitColumn outgoing, public_key_known, key_image_known;
+  outgoing.reserve(n);
+  public_key_known.reserve(n);
+  key_image_known.reserve(n);
+  for (uint32_t row: order) {
+    outgoing.push_back(m_outgoing.test(row));
+    public_key_known.push_back(m_public_key_known.test(row));
+    key_image_known.push_back(m_key_image_known.test(row));
+  }
+  std::swap(m_outgoing, outgoing);
+  std::swap(m_public_key_known, public_key_known);
+  std::swap(m_key_image_known, key_image_known);
+  Permute(&m_tx, order);
+  Permute(&m_public_key, order);
+  Permute(&m_key_image, order);
+  Permute(&m_recipient, order);
+  Permute(&m_subaddress, order);
+  Permute(&m_amount, order);
+}
+
+void TxHistory::buildIndexes() {
+  const auto n = static_cast<uint32_t>(size());
+  m_by_timestamp.resize(n);
+  m_by_timestamp.shrink_to_fit();
+  for (uint32_t row = 0; row < n; ++row) {
+    m_by_timestamp[row] = row;
+  }
+  std::stable_sort(m_by_timestamp.begin(), m_by_timestamp.end(),
+                   [this](uint32_t a, uint32_t b) {
+                     return timestamp(a) < timestamp(b);
+                   });
+  m_generation = g_next_generation.fetch_add(1);
+  if (m_generation == 0) {
+    m_generation = g_next_generation.fetch_add(1);
+  }
+}
+
+bool TxHistory::matches(const TxHistoryQuery& q, uint32_t row) const {
+  if (q.account != TxHistoryQuery::kAnyIndex) {
+    if (subaddress_major(row) != q.account) {
+      return false;
+    }
+    if (q.subaddress != TxHistoryQuery::kAnyIndex && subaddress_minor(row) != q.subaddress) {
+      return false;
+    }
+  }
+  if (q.direction >= 0 && type(row) != q.direction) {
+    return false;
+  }
+  const TxDetails& details = tx(row);
+  if (q.state_mask != 0 && !(q.state_mask & (1u << details.state))) {
+    return false;
+  }
+  if (q.min_height != 0 || q.max_height != UINT64_MAX) {
+    uint64_t height = details.height;
+    if (height == 0 || height < q.min_height || height > q.max_height) {
+      return false;
+    }
+  }
+  return details.timestamp >= q.min_timestamp && details.timestamp <= q.max_timestamp;
+}
+
+bool TxHistory::query(const TxHistoryQuery& q,
+                      uint64_t cursor,
+                      size_t limit,
+                      TxHistoryPage* page) const {
+  page->next_cursor = kTxHistoryCursorEnd;
+  uint64_t offset = 0;
+  if (cursor != kTxHistoryCursorStart) {
+    if (cursor == kTxHistoryCursorEnd) {
+      return true;
+    }
+    if ((cursor >> 32) != m_generation) {
+      return false;
+    }
+    offset = cursor & UINT32_MAX;
+  }
+
+  const bool by_height = q.order == TxHistoryQuery::HEIGHT_ASCENDING
+      || q.order == TxHistoryQuery::HEIGHT_DESCENDING;
+  const bool descending = q.order == TxHistoryQuery::HEIGHT_DESCENDING
+      || q.order == TxHistoryQuery::TIMESTAMP_DESCENDING;
+
+  // Positions in the requested order map to rows directly when ordering
+  // by height, or through the timestamp index.
+  auto row_at = [this, by_height](uint64_t pos) {
+    return by_height ? static_cast<uint32_t>(pos) : m_by_timestamp[pos];
+  };
+  auto key_at = [this, by_height, &row_at](uint64_t pos) {
+    uint32_t row = row_at(pos);
+    return by_height ? sort_height(row) : timestamp(row);
+  };
+  // First position whose sort key is not less than `key`, or greater than
+  // `key` if `after` is set.
+  auto bound = [&key_at](uint64_t lo, uint64_t hi, uint64_t key, bool after) {
+    while (lo < hi) {
+      uint64_t mid = lo + (hi - lo) / 2;
+      uint64_t k = key_at(mid);
+      if (after ? k <= key : k < key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  };
+
+  // Narrow the scan to the range bounds on the sort key.
+  uint64_t first = 0;
+  uint64_t last = size();
+  if (by_height) {
+    first = bound(first, last, q.min_height, false);
+    if (q.max_height != UINT64_MAX) {
+      last = bound(first, last, q.max_height, true);
+    }
+  } else {
+    first = bound(first, last, q.min_timestamp, false);
+    last = bound(first, last, q.max_timestamp, true);
+  }
+
+  const uint64_t n = last - first;
+  uint64_t step = offset;
+  for (; step < n && page->rows.size() < limit; ++step) {
+    uint32_t row = row_at(descending ? last - 1 - step : first + step);
+    if (matches(q, row)) {
+      page->rows.push_back(row);
+    }
+  }
+  if (step < n) {
+    page->next_cursor = (uint64_t{m_generation} << 32) | step;
+  }
+  return true;
+}
+
+size_t TxHistory::first_row_at(uint64_t height) const {
+  size_t lo = 0, hi = size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (sort_height(mid) < height) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Rows are sealed in height order, so the rows before the first mismatch
+// are the same in both snapshots, and so is every row below its height.
+bool TxHistory::first_difference(const TxHistory& older, uint64_t* height) const {
+  const size_t n = std::min(size(), older.size());
+  size_t i = 0;
+  while (i < n && same_row(i, older, i)) {
+    ++i;
+  }
+  if (i < n) {
+    *height = std::min(sort_height(i), older.sort_height(i));
+  } else if (i < size()) {
+    *height = sort_height(i);
+  } else if (i < older.size()) {
+    *height = older.sort_height(i);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool TxHistory::same_row(size_t i, const TxHistory& other, size_t j) const {
+  return m_amount[i] == other.m_amount[j]
+      && tx(i) == other.tx(j)
+      && type(i) == other.type(j)
+      && public_key_known(i) == other.public_key_known(j)
+      && key_image_known(i) == other.key_image_known(j)
+      && m_keys.get(m_public_key[i]) == other.m_keys.get(other.m_public_key[j])
+      && m_keys.get(m_key_image[i]) == other.m_keys.get(other.m_key_image[j])
+      && m_subaddresses.get(m_subaddress[i]) == other.m_subaddresses.get(other.m_subaddress[j])
+      && recipient(i) == other.recipient(j);
+}
+
+void TxHistory::swap(TxHistory& other) {
+  std::swap(*this, other);
+}
+
+crypto::public_key TxHistory::public_key(size_t i) const {
+  return FromPoolKey<crypto::public_key>(m_keys.get(m_public_key[i]));
+}
+
+crypto::key_image TxHistory::key_image(size_t i) const {
+  return FromPoolKey<crypto::key_image>(m_keys.get(m_key_image[i]));
+}
+
+TxInfo TxHistory::at(size_t i) const {
+  TxInfo info(tx_hash(i), type(i));
+  info.m_public_key = public_key(i);
+  info.m_key_image = key_image(i);
+  info.m_subaddress_major = subaddress_major(i);
+  info.m_subaddress_minor = subaddress_minor(i);
+  info.m_recipient = recipient(i);
+  info.m_amount = m_amount[i];
+  info.m_height = height(i);
+  info.m_unlock_time = unlock_time(i);
+  info.m_timestamp = timestamp(i);
+  info.m_fee = fee(i);
+  info.m_change = change(i);
+  info.m_coinbase = coinbase(i);
+  info.m_public_key_known = public_key_known(i);
+  info.m_key_image_known = key_image_known(i);
+  info.m_state = state(i);
+  return info;
+}
+
+size_t TxHistory::memory_usage() const {
+  return m_txs.memory_usage()
+      + m_keys.memory_usage()
+      + m_subaddresses.memory_usage()
+      + m_recipients.memory_usage()
+      + VectorBytes(m_tx)
+      + VectorBytes(m_public_key)
+      + VectorBytes(m_key_image)
+      + VectorBytes(m_recipient)
+      + VectorBytes(m_subaddress)
+      + VectorBytes(m_amount)
+      + m_outgoing.memory_usage()
+      + m_public_key_known.memory_usage()
+      + m_key_image_known.memory_usage()
+      + VectorBytes(m_by_timestamp);
+}
+
+}  // namespace monero
@@ -0,0 +1,269 @@
+#ifndef WALLET_TX_HISTORY_H_
+#define WALLET_TX_HISTORY_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace monero {
+
+// Basic structure combining transaction details with input or output info.
+struct TxInfo {
+  crypto::hash m_tx_hash;
+  crypto::public_key m_public_key;
+  crypto::key_image m_key_image;
+  uint32_t m_subaddress_major;
+  uint32_t m_subaddress_minor;
+  std::string m_recipient;
+  uint64_t m_amount;
+  uint64_t m_height;
+  uint64_t m_unlock_time;
+  uint64_t m_timestamp;
+  uint64_t m_fee;
+  uint64_t m_change;
+  bool m_coinbase;
+  bool m_public_key_known;
+  bool m_key_image_known;
+
+  enum TxType {
+    INCOMING = 0,
+    OUTGOING = 1,
+  } m_type;
+
+  enum TxState {
+    OFF_CHAIN = 1,
+    PENDING = 2,
+    FAILED = 3,
+    ON_CHAIN = 4,
+  } m_state;
+
+  TxInfo(crypto::hash tx_hash, TxType type) :
+      m_tx_hash(tx_hash),
+      m_public_key(crypto::public_key{}),
+      m_key_image(crypto::key_image{}),
+      m_subaddress_major(-1),
+      m_subaddress_minor(-1),
+      m_recipient(),
+      m_amount(0),
+      m_height(0),
+      m_unlock_time(0),
+      m_timestamp(0),
+      m_fee(0),
+      m_change(0),
+      m_coinbase(false),
+      m_public_key_known(false),
+      m_key_image_known(false),
+      m_type(type),
+      m_state(OFF_CHAIN) {}
+
+  // TODO: Factory functions for various types of transactions.
+};
+
+// Filters of a TxHistory::query().  Default values match every row.
+struct TxHistoryQuery {
+  enum Order {
+    HEIGHT_ASCENDING,
+    HEIGHT_DESCENDING,
+    TIMESTAMP_ASCENDING,
+    TIMESTAMP_DESCENDING,
+  };
+
+  static constexpr uint32_t kAnyIndex = UINT32_MAX;
+
+  uint32_t account = kAnyIndex;
+  // Only checked together with `account`.
+  uint32_t subaddress = kAnyIndex;
+  // Matches only rows of this TxInfo::TxType when not negative.
+  int direction = -1;
+  // Bit (1 << TxInfo::TxState) set for every matching state; zero for any.
+  uint32_t state_mask = 0;
+  // Inclusive bounds.  Unconfirmed rows have no height and only match when
+  // the height range is left open.
+  uint64_t min_height = 0;
+  uint64_t max_height = UINT64_MAX;
+  uint64_t min_timestamp = 0;
+  uint64_t max_timestamp = UINT64_MAX;
+  Order order = HEIGHT_DESCENDING;
+};
+
+// Opaque position in a query, tied to one sealed snapshot.
+constexpr uint64_t kTxHistoryCursorStart = 0;
+constexpr uint64_t kTxHistoryCursorEnd = UINT64_MAX;
+
+struct TxHistoryPage {
+  std::vector<uint32_t> rows;
+  // kTxHistoryCursorEnd once the query is exhausted.
+  uint64_t next_cursor = kTxHistoryCursorEnd;
+};
+
+// Transaction history stored column by column.  TxInfo rows are mostly
+// zeroes and repeat the same tx details across the inputs and outputs of a
+// transaction, so only the fields that differ per row get a column.  Tx
+// details, keys, subaddress indices and recipients are interned into pools
+// and rows keep 32-bit references to them.  Flags are packed into bitsets.
+//
+// Built once per snapshot with append() and then sealed, which drops the
+// lookup tables only needed while interning, orders the rows by height and
+// builds the timestamp index used by query().  Row numbers are only
+// meaningful once sealed.
+class TxHistory {
+ public:
+  // Height of unconfirmed rows in the height order, above every block.
+  static constexpr uint64_t kUnconfirmedHeight = UINT64_MAX;
+
+  TxHistory() = default;
+  TxHistory(TxHistory&&) = default;
+  TxHistory& operator=(TxHistory&&) = default;
+
+  size_t size() const { return m_amount.size(); }
+  bool empty() const { return m_amount.empty(); }
+
+  void clear();
+  void reserve(size_t n);
+  void append(const TxInfo& tx);
+  void seal();
+  void swap(TxHistory& other);
+
+  // Materializes row `i`.  Scans should read single columns instead.
+  TxInfo at(size_t i) const;
+
+  TxInfo::TxType type(size_t i) const {
+    return m_outgoing.test(i) ? TxInfo::OUTGOING : TxInfo::INCOMING;
+  }
+  TxInfo::TxState state(size_t i) const { return static_cast<TxInfo::TxState>(tx(i).state); }
+  const crypto::hash& tx_hash(size_t i) const { return tx(i).tx_hash; }
+  crypto::public_key public_key(size_t i) const;
+  crypto::key_image key_image(size_t i) const;
+  bool public_key_known(size_t i) const { return m_public_key_known.test(i); }
+  bool key_image_known(size_t i) const { return m_key_image_known.test(i); }
+  bool coinbase(size_t i) const { return tx(i).coinbase; }
+  uint32_t subaddress_major(size_t i) const { return m_subaddresses.get(m_subaddress[i]) >> 32; }
+  uint32_t subaddress_minor(size_t i) const {
+    return static_cast<uint32_t>(m_subaddresses.get(m_subaddress[i]));
+  }
+  const std::string& recipient(size_t i) const { return m_recipients.get(m_recipient[i]); }
+  uint64_t amount(size_t i) const { return m_amount[i]; }
+  uint64_t height(size_t i) const { return tx(i).height; }
+  uint64_t unlock_time(size_t i) const { return tx(i).unlock_time; }
+  uint64_t timestamp(size_t i) const { return tx(i).timestamp; }
+  uint64_t fee(size_t i) const { return tx(i).fee; }
+  uint64_t change(size_t i) const { return tx(i).change; }
+
+  const std::vector<uint64_t>& amounts() const { return m_amount; }
+
+  // Set by seal(), unique across snapshots.
+  uint32_t generation() const { return m_generation; }
+
+  // First row of the height order at or above `height`.
+  size_t first_row_at(uint64_t height) const;
+
+  // Stores in `height` the lowest height at which rows differ from the
+  // `older` snapshot, or kUnconfirmedHeight if only unconfirmed rows do.
+  // Returns false if both snapshots hold the same rows.
+  bool first_difference(const TxHistory& older, uint64_t* height) const;
+
+  // Appends to `page` up to `limit` rows matching `q`, in the requested
+  // order, starting at `cursor`.  Returns false if the cursor comes from
+  // another snapshot; the query must then restart from kTxHistoryCursorStart.
+  bool query(const TxHistoryQuery& q,
+             uint64_t cursor,
+             size_t limit,
+             TxHistoryPage* page) const;
+
+  // Heap bytes held by the columns, pools and indexes.
+  size_t memory_usage() const;
+
+ private:
+  class BitColumn {
+   public:
+    bool test(size_t i) const { return (m_words[i / 64] >> (i % 64)) & 1; }
+    void push_back(bool bit);
+    void clear() { m_words.clear(); m_size = 0; }
+    void reserve(size_t n) { m_words.reserve((n + 63) / 64); }
+    void shrink_to_fit() { m_words.shrink_to_fit(); }
+    size_t memory_usage() const { return m_words.capacity() * sizeof(uint64_t); }
+
+   private:
+    std::vector<uint64_t> m_words;
+    size_t m_size = 0;
+  };
+
+  // Fields shared by the rows of a transaction.  Rows of the same tx that
+  // disagree on any of them, such as an incoming row seen before the tx
+  // was mined, get separate entries.
+  struct TxDetails {
+    crypto::hash tx_hash;
+    uint64_t height;
+    uint64_t unlock_time;
+    uint64_t timestamp;
+    uint64_t fee;
+    uint64_t change;
+    uint8_t state;
+    bool coinbase;
+
+    bool operator==(const TxDetails& other) const;
+  };
+
+  struct TxDetailsHash {
+    size_t operator()(const TxDetails& tx) const;
+  };
+
+  // Deduplicated values referenced by index.  Index 0 is the default value,
+  // so empty fields cost nothing beyond the reference.
+  template<typename T, typename Hash = std::hash<T>>
+  class Pool {
+   public:
+    Pool() : m_values(1) {}
+
+    const T& get(uint32_t ref) const { return m_values[ref]; }
+    uint32_t intern(const T& value);
+    void clear();
+    void seal();
+    size_t memory_usage() const;
+
+   private:
+    std::vector<T> m_values;
+    std::unordered_map<T, uint32_t, Hash> m_index;
+  };
+
+  const TxDetails& tx(size_t i) const { return m_txs.get(m_tx[i]); }
+
+  // Sort key of the height order, placing unconfirmed rows last.
+  uint64_t sort_height(uint32_t row) const {
+    return height(row) != 0 ? height(row) : kUnconfirmedHeight;
+  }
+
+  bool same_row(size_t i, const TxHistory& other, size_t j) const;
+  bool matches(const TxHistoryQuery& q, uint32_t row) const;
+  void sortRows();
+  void buildIndexes();
+
+  Pool<TxDetails, TxDetailsHash> m_txs;
+  Pool<crypto::hash> m_keys;
+  Pool<uint64_t> m_subaddresses;  // Major index in the high half.
+  Pool<std::string> m_recipients;
+
+  std::vector<uint32_t> m_tx;
+  std::vector<uint32_t> m_public_key;
+  std::vector<uint32_t> m_key_image;
+  std::vector<uint32_t> m_recipient;
+  std::vector<uint32_t> m_subaddress;
+  std::vector<uint64_t> m_amount;
+  BitColumn m_outgoing;
+  BitColumn m_public_key_known;
+  BitColumn m_key_image_known;
+
+  // Sealed rows are ordered by (sort height, timestamp), so the height
+  // order needs no index.  Row numbers ordered by timestamp, rebuilt by
+  // seal().
+  std::vector<uint32_t> m_by_timestamp;
+  uint32_t m_generation = 0;
+};
+
+}  // namespace monero
+
+#endif  // WALLET_TX_HISTORY_H_
@@ -1,20 +1,26 @@
 #include "wallet.h"
 
+#include <algorithm>
 #include <cstring>
 #include <chrono>
 
-#include <boost/iostreams/device/file_descriptor.hpp>
-#include <boost/iostreams/stream.hpp>
-
 #include "common/debug.h"
-#include "common/eraser.h"
 
-#include "jni_cache.h"
-#include "fd.h"
+#include "block_cache.h"
+#include "block_feed.h"
+#include "block_time_table.h"
+#include "checkpoint_chain.h"
+#include "refresh_scheduler.h"
+#include "wallet2_accessor.h"
 
-#include "string_tools.h"
+#ifdef WALLET_TEST_NODES
+#include "rpc_trace.h"
+#include "synthetic_chain.h"
+#endif
 
-namespace io = boost::iostreams;
+#include "serialization/binary_utils.h"
+#include "serialization/containers.h"
+#include "string_tools.h"
 
 namespace monero {
 
@@ -33,20 +39,52 @@ static_assert(DIFFICULTY_TARGET_V2 == 120,
 static_assert(PER_KB_FEE_QUANTIZATION_DECIMALS == 8,
               "PER_KB_FEE_QUANTIZATION_DECIMALS mismatch");
 
+// Block time table samples fetched from the node at the end of a refresh.
+constexpr size_t kBlockTimeSamplesPerRefresh = 8;
+
+// History snapshots whose changes are remembered for incremental exports.
+constexpr size_t kTxHistoryChangesKept = 16;
+
+// Node clients of a new wallet.  In builds with the test node clients, they
+// answer from the synthetic chain or the RPC trace while one is served.
+std::unique_ptr<HttpClientFactory> CreateHttpClientFactory(
+    cryptonote::network_type nettype,
+    const std::shared_ptr<NodeTransport>& transport,
+    const std::shared_ptr<RemoteNodeCallState>& call_state) {
+#ifdef WALLET_TEST_NODES
+  if (auto chain = SyntheticNode::chain()) {
+    return std::make_unique<SyntheticNodeClientFactory>(std::move(chain));
+  }
+  if (auto trace = RpcTrace::replay()) {
+    return std::make_unique<ReplayNodeClientFactory>(std::move(trace));
+  }
+#endif
+  return std::make_unique<RemoteNodeClientFactory>(nettype, transport, call_state);
+}
+
 Wallet::Wallet(
-    JNIEnv* env,
     int network_id,
-    const JavaRef<jobject>& wallet_native)
-    : m_wallet(static_cast<cryptonote::network_type>(network_id),
+    std::shared_ptr<NodeTransport> transport,
+    std::unique_ptr<WalletListener> listener)
+    : m_call_state(std::make_shared<RemoteNodeCallState>()),
+      m_transport(std::move(transport)),
+      m_wallet(static_cast<cryptonote::network_type>(network_id),
                0,    /* kdf_rounds */
                true, /* unattended */
-               std::make_unique<RemoteNodeClientFactory>(env, wallet_native)),
-      m_callback(env, wallet_native),
+               CreateHttpClientFactory(
+                   static_cast<cryptonote::network_type>(network_id), m_transport,
+                   m_call_state)),
       m_account_ready(false),
+      m_hashchain_seeded(false),
+      m_hashchain_checkpoint(0),
       m_last_block_height(1),
       m_last_block_timestamp(0),
+      m_compact_transfers(false),
+      m_compacted_transfers(0),
       m_restore_height(0),
-      m_refresh_running(false),
+      m_fee_cache(std::chrono::seconds(DIFFICULTY_TARGET_V2)),
+      m_listener(std::move(listener)),
+      m_restore_timing(false),
       m_refresh_canceled(false) {
   // Use a bogus ipv6 address as a placeholder for the daemon address.
   LOG_FATAL_IF(!m_wallet.init("[100::/64]", {}, {}, 0, false),
@@ -55,10 +93,44 @@ Wallet::Wallet(
   m_wallet.callback(this);
 }
 
+Wallet::~Wallet() {
+  // Interrupt any running refresh slice before leaving the scheduler.  A
+  // slice that has not entered wallet2::refresh() yet would reset the stop
+  // flag, so node calls are made to fail as well.
+  m_call_state->closing.store(true);
+  m_wallet.stop();
+  RefreshScheduler::instance()->remove(this);
+}
+
+namespace {
+
+// Releases the wallet mutex on scope exit and resumes a refresh parked on it.
+// Declared after the lock, so that it runs first.
+class WakeRefreshOnRelease {
+ public:
+  WakeRefreshOnRelease(Wallet* wallet, ProfiledLock& lock) : m_wallet(wallet), m_lock(lock) {}
+
+  ~WakeRefreshOnRelease() {
+    if (m_lock.owns_lock()) {
+      m_lock.unlock();
+    }
+    RefreshScheduler::instance()->wake(m_wallet);
+  }
+
+  WakeRefreshOnRelease(const WakeRefreshOnRelease&) = delete;
+  void operator=(const WakeRefreshOnRelease&) = delete;
+
+ private:
+  Wallet* const m_wallet;
+  ProfiledLock& m_lock;
+};
+
+}  // namespace
+
 // Generate keypairs deterministically.  Account creation time will be set
 // to Monero epoch.
 void GenerateAccountKeys(cryptonote::account_base& account,
-                         const std::vector<char>& secret_scalar) {
+                         const SecretBuffer& secret_scalar) {
   crypto::secret_key secret_key;
   LOG_FATAL_IF(secret_scalar.size() != sizeof(secret_key.data),
                "Secret key size mismatch");
@@ -67,9 +139,12 @@ void GenerateAccountKeys(cryptonote::account_base& account,
   LOG_FATAL_IF(gen != secret_key);
 }
 
-void Wallet::restoreAccount(const std::vector<char>& secret_scalar, uint64_t restore_point) {
+void Wallet::restoreAccount(const SecretBuffer& secret_scalar, uint64_t restore_point) {
   LOG_FATAL_IF(m_account_ready, "Account should not be reinitialized");
-  std::lock_guard<std::mutex> lock(m_wallet_mutex);
+  static LockSite site("wallet", "restoreAccount");
+  ProfiledLock lock(m_wallet_mutex, site);
+  WakeRefreshOnRelease wake(this, lock);
+  m_restore_start_time = std::chrono::steady_clock::now();
   auto& account = m_wallet.get_account();
   GenerateAccountKeys(account, secret_scalar);
   m_subaddresses[{0, 0}] = m_wallet.get_subaddress_as_str({0, 0});
@@ -86,11 +161,68 @@ void Wallet::restoreAccount(const std::vector<char>& secret_scalar, uint64_t res
   m_last_block_height = (m_restore_height == 0) ? 1 : m_restore_height;
   LOGD("Restoring account: restore_point=%" PRIu64 ", computed restore_height=%" PRIu64,
        restore_point, m_restore_height);
+  // Set up the blockchain with the primary address alone and derive the
+  // lookahead table in the background.  Refresh waits for it before the first
+  // block is scanned.
+  m_wallet.set_subaddress_lookahead(1, 1);
   m_wallet.rescan_blockchain(true, false, false);
+  m_subaddress_lookahead.start(account.get_keys(),
+                               SUBADDRESS_LOOKAHEAD_MAJOR, SUBADDRESS_LOOKAHEAD_MINOR);
+  // Blocks are scanned from the first height above the hashchain top.
+  if (m_restore_height > 1) {
+    m_hashchain_seeded = seedHashchain(m_restore_height - 1);
+  }
+  m_restore_timing = true;
   m_account_ready = true;
 }
 
+// Replaces the fresh hashchain with one that starts at the highest known
+// checkpoint at or below `height`, as if it had been trimmed there.  The
+// refresh then only needs to pull hashes from the checkpoint onwards.
+bool Wallet::seedHashchain(uint64_t height) {
+  uint64_t cp_height;
+  crypto::hash cp_hash;
+  if (!CheckpointChain::forNetwork(m_wallet.nettype())
+      .findAtOrBelow(height, &cp_height, &cp_hash)) {
+    return false;
+  }
+  auto hashchain = m_wallet.export_blockchain();
+  if (std::get<0>(hashchain) != 0 || std::get<2>(hashchain).size() != 1) {
+    return false;
+  }
+  // import_blockchain() takes a hashchain in the form export_blockchain()
+  // gives it: the offset it was trimmed at, the genesis hash and the hashes
+  // above the offset.  It briefly fills the chain up to the offset before
+  // trimming it, which an unseeded restore would hold for the whole refresh.
+  std::get<0>(hashchain) = cp_height;
+  std::get<2>(hashchain) = {cp_hash};
+  m_wallet.import_blockchain(hashchain);
+  LOG_FATAL_IF(m_wallet.get_blockchain_current_height() != cp_height + 1);
+  m_hashchain_checkpoint = cp_height;
+  LOGD("Seeded hashchain from checkpoint at height %" PRIu64, cp_height);
+  return true;
+}
+
+// Whether a refresh error means that the node rejected the seeded checkpoint:
+// the hashchain was seeded and has not grown past the checkpoint yet.  Once
+// the node has served anything above it, errors are not about the seed.
+bool Wallet::seededCheckpointRejected() {
+  return m_hashchain_seeded
+      && m_wallet.get_blockchain_current_height() <= m_hashchain_checkpoint + 1;
+}
+
+// Drops a seeded hashchain and starts over from genesis.
+void Wallet::resetHashchain() {
+  LOGW("Node rejected the seeded hashchain, falling back to a full hashchain");
+  m_hashchain_seeded = false;
+  m_wallet.rescan_blockchain(true, false, false);
+}
+
 uint64_t Wallet::estimateRestoreHeight(uint64_t timestamp) {
+  uint64_t height;
+  if (BlockTimeTable::forNetwork(m_wallet.nettype()).estimateHeight(timestamp, &height)) {
+    return height;
+  }
   // Apply -1 month adjustment for fluctuations in block time, just like
   // estimate_blockchain_height() does when node's height is unavailable.
   const int secs_per_month = 60 * 60 * 24 * 30;
@@ -103,22 +235,43 @@ bool Wallet::parseFrom(std::istream& input) {
   std::ostringstream ss;
   ss << input.rdbuf();
   const std::string buf = ss.str();
-  binary_archive<false> ar{epee::strspan<std::uint8_t>(buf)};
-  std::lock_guard<std::mutex> lock(m_wallet_mutex);
+  // The summary header is only read by the fast path on the Kotlin side.
+  size_t archive_offset;
+  if (!SkipLedgerSummaryHeader(buf, &archive_offset))
+    return false;
+  auto archive = epee::strspan<std::uint8_t>(buf);
+  archive.remove_prefix(archive_offset);
+  binary_archive<false> ar{archive};
+  static LockSite site("wallet", "parseFrom");
+  ProfiledLock lock(m_wallet_mutex, site);
+  WakeRefreshOnRelease wake(this, lock);
   if (!serialization::serialize_noeof(ar, *this))
     return false;
   if (!serialization::serialize_noeof(ar, m_wallet.get_account()))
     return false;
   if (!serialization::serialize(ar, m_wallet))
     return false;
+  // Wallets saved before compact transfers existed load with the setting
+  // off; a compact wallet keeps compacting the outputs found since its save.
+  m_compacted_transfers = 0;
+  if (m_compact_transfers)
+    compactTransfersLocked();
   updateSubaddressMap(m_subaddresses);
-  captureTxHistorySnapshot(m_tx_history);
+  TxHistory history;
+  captureTxHistorySnapshot(history);
+  installTxHistory(history);
   m_account_ready = true;
   return true;
 }
 
 bool Wallet::writeTo(std::ostream& output) {
-  return suspendRefreshAndRunLocked([&]() -> bool {
+  static LockSite site("wallet", "writeTo");
+  return suspendRefreshAndRunLocked(site, [&]() -> bool {
+    // The subaddress map is saved with wallet2.
+    completeSubaddressLookaheadLocked();
+    LedgerSummary summary;
+    captureLedgerSummary(&summary);
+    WriteLedgerSummaryHeader(summary, output);
     binary_archive<true> ar(output);
     if (!serialization::serialize_noeof(ar, *this))
       return false;
@@ -130,6 +283,72 @@ bool Wallet::writeTo(std::ostream& output) {
   });
 }
 
+void Wallet::captureLedgerSummary(LedgerSummary* summary) {
+  summary->public_address = require_account().get_public_address_str(m_wallet.nettype());
+  summary->block_height = m_last_block_height;
+  summary->owned_tx_outs.clear();
+  const size_t num_transfers = m_wallet.get_num_transfer_details();
+  summary->owned_tx_outs.reserve(num_transfers);
+  for (size_t i = 0; i < num_transfers; ++i) {
+    const wallet2::transfer_details& td = m_wallet.get_transfer_details(i);
+    // wallet2 marks an output spent, at height zero, as soon as its spending
+    // tx is in the pool.
+    bool spent_in_pool = td.m_spent && td.m_spent_height == 0;
+    summary->owned_tx_outs.push_back(
+        {td.m_txid, td.amount(), td.m_block_height, td.m_spent ? td.m_spent_height : 0,
+         spent_in_pool});
+  }
+}
+
+void Wallet::enableCompactTransfers() {
+  static LockSite site("wallet", "enableCompactTransfers");
+  suspendRefreshAndRunLocked(site, [&]() {
+    m_compact_transfers = true;
+    compactTransfersLocked();
+  });
+}
+
+void Wallet::enableBlockCache() {
+  m_call_state->use_block_cache.store(true);
+}
+
+// Keeps of each owned output's tx prefix only what wallet2 reads when
+// spending it and what the history snapshot reads: version, unlock time,
+// outputs and extra.  The inputs, which hold the ring members and key
+// images of the funding tx and are most of its size, are dropped.
+void Wallet::compactTransfersLocked() {
+  auto& transfers = Wallet2Accessor::transfers(m_wallet);
+  // A reorg may have detached compacted outputs.
+  m_compacted_transfers = std::min(m_compacted_transfers, transfers.size());
+  size_t compacted = 0;
+  size_t blob_bytes_saved = 0;
+  size_t heap_bytes_saved = 0;
+  for (size_t i = m_compacted_transfers; i < transfers.size(); ++i) {
+    auto& vin = transfers[i].m_tx.vin;
+    if (vin.empty()) {
+      continue;
+    }
+    std::string blob;
+    if (::serialization::dump_binary(vin, blob)) {
+      blob_bytes_saved += blob.size();
+    }
+    heap_bytes_saved += vin.capacity() * sizeof(cryptonote::txin_v);
+    for (const auto& in: vin) {
+      if (in.type() == typeid(cryptonote::txin_to_key)) {
+        heap_bytes_saved += boost::get<cryptonote::txin_to_key>(in).key_offsets.capacity()
+            * sizeof(uint64_t);
+      }
+    }
+    std::vector<cryptonote::txin_v>().swap(vin);
+    ++compacted;
+  }
+  m_compacted_transfers = transfers.size();
+  if (compacted > 0) {
+    LOGI("Compacted %zu transfers: archive -%zu bytes, heap -%zu bytes",
+         compacted, blob_bytes_saved, heap_bytes_saved);
+  }
+}
+
 std::string FormatAccountAddress(
     const std::pair<cryptonote::subaddress_index, std::string>& pair) {
   std::stringstream ss;
@@ -138,7 +357,9 @@ std::string FormatAccountAddress(
 }
 
 std::string Wallet::addDetachedSubAddress(uint32_t index_major, uint32_t index_minor) {
-  return suspendRefreshAndRunLocked([&]() {
+  static LockSite site("wallet", "addDetachedSubAddress");
+  return suspendRefreshAndRunLocked(site, [&]() {
+    completeSubaddressLookaheadLocked();
     cryptonote::subaddress_index index = {index_major, index_minor};
     m_wallet.create_one_off_subaddress(index);
     return addSubaddressInternal(index);
@@ -146,7 +367,9 @@ std::string Wallet::addDetachedSubAddress(uint32_t index_major, uint32_t index_m
 }
 
 std::string Wallet::createSubAddressAccount() {
-  return suspendRefreshAndRunLocked([&]() {
+  static LockSite site("wallet", "createSubAddressAccount");
+  return suspendRefreshAndRunLocked(site, [&]() {
+    completeSubaddressLookaheadLocked();
     uint32_t index_major = m_wallet.get_num_subaddress_accounts();
     m_wallet.add_subaddress_account("");
     return addSubaddressInternal({index_major, 0});
@@ -154,7 +377,9 @@ std::string Wallet::createSubAddressAccount() {
 }
 
 std::string Wallet::createSubAddress(uint32_t index_major) {
-  return suspendRefreshAndRunLocked([&]() {
+  static LockSite site("wallet", "createSubAddress");
+  return suspendRefreshAndRunLocked(site, [&]() {
+    completeSubaddressLookaheadLocked();
     uint32_t index_minor = m_wallet.get_num_subaddresses(index_major);
     m_wallet.add_subaddress(index_major, "");
     return addSubaddressInternal({index_major, index_minor});
@@ -163,7 +388,8 @@ std::string Wallet::createSubAddress(uint32_t index_major) {
 
 std::string Wallet::addSubaddressInternal(const cryptonote::subaddress_index& index) {
   std::string subaddress = m_wallet.get_subaddress_as_str(index);
-  std::unique_lock<std::mutex> lock(m_subaddresses_mutex);
+  static LockSite site("subaddresses", "addSubaddressInternal");
+  ProfiledLock lock(m_subaddresses_mutex, site);
   auto ret = m_subaddresses.insert({index, subaddress});
   return FormatAccountAddress(*ret.first);
 }
@@ -174,7 +400,9 @@ std::unique_ptr<PendingTransfer> Wallet::createPayment(
     int priority,
     uint32_t account_index,
     const std::set<uint32_t>& subaddr_indexes) {
-  std::unique_lock<std::mutex> wallet_lock(m_wallet_mutex);
+  static LockSite site("wallet", "createPayment");
+  ProfiledLock wallet_lock(m_wallet_mutex, site);
+  WakeRefreshOnRelease wake(this, wallet_lock);
 
   std::vector<cryptonote::tx_destination_entry> dsts;
   dsts.reserve(addresses.size());
@@ -207,7 +435,9 @@ std::unique_ptr<PendingTransfer> Wallet::createPayment(
 }
 
 void Wallet::commit_transfer(PendingTransfer& pending_transfer) {
-  std::unique_lock<std::mutex> wallet_lock(m_wallet_mutex);
+  static LockSite site("wallet", "commitTransfer");
+  ProfiledLock wallet_lock(m_wallet_mutex, site);
+  WakeRefreshOnRelease wake(this, wallet_lock);
 
   while (!pending_transfer.m_ptxs.empty()) {
     m_wallet.commit_tx(pending_transfer.m_ptxs.back());
@@ -220,14 +450,56 @@ void Wallet::commit_transfer(PendingTransfer& pending_transfer) {
   }
 }
 
-template<typename Consumer>
-void Wallet::withTxHistory(Consumer consumer) {
-  std::lock_guard<std::mutex> lock(m_tx_history_mutex);
-  consumer(m_tx_history);
+std::vector<uint64_t> Wallet::fetchBaseFeeEstimate() {
+  std::vector<uint64_t> fees;
+  uint64_t height = m_last_block_height;
+  if (m_fee_cache.lookup(height, &fees)) {
+    return fees;
+  }
+  std::lock_guard<std::mutex> lock(m_fee_fetch_mutex);
+  // Another caller may have refreshed the entry while we were waiting.
+  if (m_fee_cache.peek(height, &fees)) {
+    return fees;
+  }
+  fees = m_wallet.get_dynamic_base_fee_scaling_estimate();
+  if (!fees.empty()) {
+    m_fee_cache.store(height, fees);
+  }
+  LOGV("Fee estimate cache miss: height=%" PRIu64 ", hits=%" PRIu64 ", misses=%" PRIu64,
+       height, m_fee_cache.hits(), m_fee_cache.misses());
+  return fees;
 }
 
-std::vector<uint64_t> Wallet::fetchBaseFeeEstimate() {
-  return m_wallet.get_dynamic_base_fee_scaling_estimate();
+std::string Wallet::dumpStats() {
+  std::ostringstream out;
+  out << LockProfiler::dump();
+  out << "fee_cache.hits " << m_fee_cache.hits() << "\n"
+      << "fee_cache.misses " << m_fee_cache.misses() << "\n";
+  BlockCache* cache = m_call_state->use_block_cache.load()
+                      ? BlockCache::forNetwork(m_wallet.nettype())
+                      : nullptr;
+  if (cache != nullptr) {
+    out << "block_cache.hits " << cache->hits() << "\n"
+        << "block_cache.misses " << cache->misses() << "\n";
+  }
+  const BlockFeed& feed = BlockFeed::forNetwork(m_wallet.nettype());
+  out << "block_feed.fetches " << feed.fetches() << "\n"
+      << "block_feed.shared " << feed.shared() << "\n";
+  RefreshScheduler::Progress progress;
+  if (RefreshScheduler::instance()->progress(this, &progress)) {
+    out << "refresh.slices " << progress.slices << "\n"
+        << "refresh.blocks_fetched " << progress.blocks_fetched << "\n"
+        << "refresh.run_time_ms " << progress.run_time.count() << "\n"
+        << "refresh.queue_time_ms " << progress.queue_time.count() << "\n";
+  }
+  out << "transport.bytes_sent " << m_call_state->bytes_sent.load() << "\n"
+      << "transport.bytes_received " << m_call_state->bytes_received.load() << "\n"
+      << "transport.bytes_decoded " << m_call_state->bytes_decoded.load() << "\n";
+  SecretArena::Stats secrets = SecretArena::instance().stats();
+  out << "secret_arena.in_use " << secrets.in_use << "\n"
+      << "secret_arena.fallbacks " << secrets.fallbacks << "\n"
+      << "secret_arena.locked_bytes " << secrets.locked_bytes << "\n";
+  return out.str();
 }
 
 std::string Wallet::public_address() const {
@@ -235,7 +507,8 @@ std::string Wallet::public_address() const {
 }
 
 std::vector<std::string> Wallet::formatted_subaddresses(uint32_t index_major) {
-  std::lock_guard<std::mutex> lock(m_subaddresses_mutex);
+  static LockSite site("subaddresses", "formatted_subaddresses");
+  ProfiledLock lock(m_subaddresses_mutex, site);
 
   std::vector<std::string> ret;
   ret.reserve(m_subaddresses.size());
@@ -299,11 +572,12 @@ const wallet2::confirmed_transfer_details* Find_transfer_by_txid(
 // Only call this function from the callback thread or during initialization,
 // as there is no locking mechanism to safeguard reading transaction history
 // from wallet2.
-void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
-  snapshot.clear();
+void Wallet::captureTxHistorySnapshot(TxHistory& history) {
+  history.clear();
 
   std::vector<wallet2::transfer_details> tds;
   m_wallet.get_transfers(tds);
+  history.reserve(tds.size());
 
   uint64_t min_height = 0;
 
@@ -318,8 +592,7 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
 
   // Iterate through the known owned outputs.
   for (const auto& td: tds) {
-    snapshot.emplace_back(td.m_txid, TxInfo::INCOMING);
-    TxInfo& recv = snapshot.back();
+    TxInfo recv(td.m_txid, TxInfo::INCOMING);
     recv.m_public_key = td.get_public_key();
     recv.m_public_key_known = true;
     recv.m_key_image = td.m_key_image;
@@ -344,6 +617,7 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
     } else {
       recv.m_state = TxInfo::OFF_CHAIN;
     }
+    history.append(recv);
   }
 
   // Confirmed outgoing transactions.
@@ -352,8 +626,7 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
     uint64_t fee = tx.m_amount_in - tx.m_amount_out;
 
     for (const auto& dest: tx.m_dests) {
-      snapshot.emplace_back(pair.first, TxInfo::OUTGOING);
-      TxInfo& spent = snapshot.back();
+      TxInfo spent(pair.first, TxInfo::OUTGOING);
       spent.m_recipient = dest.address(m_wallet.nettype(), tx.m_payment_id);
       spent.m_amount = dest.amount;
       spent.m_height = tx.m_block_height;
@@ -362,11 +635,11 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
       spent.m_fee = fee;
       spent.m_change = tx.m_change;
       spent.m_state = TxInfo::ON_CHAIN;
+      history.append(spent);
     }
 
     for (const auto& ring: tx.m_rings) {
-      snapshot.emplace_back(pair.first, TxInfo::OUTGOING);
-      TxInfo& spent = snapshot.back();
+      TxInfo spent(pair.first, TxInfo::OUTGOING);
       spent.m_key_image = ring.first;
       spent.m_key_image_known = true;
       spent.m_height = tx.m_block_height;
@@ -375,6 +648,7 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
       spent.m_fee = fee;
       spent.m_change = tx.m_change;
       spent.m_state = TxInfo::ON_CHAIN;
+      history.append(spent);
     }
   }
 
@@ -389,8 +663,7 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
     for (const auto& dest: utx.m_dests) {
       if (const auto dest_subaddr_idx = m_wallet.get_subaddress_index(dest.addr)) {
         // Add pending transfers to our own wallet.
-        snapshot.emplace_back(pair.first, TxInfo::INCOMING);
-        TxInfo& recv = snapshot.back();
+        TxInfo recv(pair.first, TxInfo::INCOMING);
         recv.m_subaddress_major = (*dest_subaddr_idx).major;
         recv.m_subaddress_minor = (*dest_subaddr_idx).minor;
         recv.m_amount = dest.amount;
@@ -398,9 +671,9 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
         recv.m_timestamp = utx.m_timestamp;
         recv.m_fee = fee;
         recv.m_state = state;
+        history.append(recv);
       } else {
-        snapshot.emplace_back(pair.first, TxInfo::OUTGOING);
-        TxInfo& spent = snapshot.back();
+        TxInfo spent(pair.first, TxInfo::OUTGOING);
         spent.m_recipient = dest.address(m_wallet.nettype(), utx.m_payment_id);
         spent.m_amount = dest.amount;
         spent.m_unlock_time = utx.m_tx.unlock_time;
@@ -408,13 +681,13 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
         spent.m_fee = fee;
         spent.m_change = utx.m_change;
         spent.m_state = state;
+        history.append(spent);
       }
     }
 
     // Change is ours too, but the output is not yet in transfer_details
     if (utx.m_change > 0) {
-      snapshot.emplace_back(pair.first, TxInfo::INCOMING);
-      TxInfo& change = snapshot.back();
+      TxInfo change(pair.first, TxInfo::INCOMING);
       change.m_subaddress_major = utx.m_subaddr_account;
       change.m_subaddress_minor = 0;  // All changes go to 0-th subaddress
       change.m_amount = utx.m_change;
@@ -422,17 +695,18 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
       change.m_timestamp = utx.m_timestamp;
       change.m_fee = fee;
       change.m_state = state;
+      history.append(change);
     }
 
     for (const auto& ring: utx.m_rings) {
-      snapshot.emplace_back(pair.first, TxInfo::OUTGOING);
-      TxInfo& spent = snapshot.back();
+      TxInfo spent(pair.first, TxInfo::OUTGOING);
       spent.m_key_image = ring.first;
       spent.m_key_image_known = true;
       spent.m_timestamp = utx.m_timestamp;
       spent.m_fee = fee;
       spent.m_change = utx.m_change;
       spent.m_state = state;
+      history.append(spent);
     }
   }
 
@@ -449,8 +723,7 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
     if (it != utxs.end()) continue;
     // Denormalize individual amounts sent to a single subaddress in a single tx.
     for (uint64_t amount: upd.m_amounts) {
-      snapshot.emplace_back(upd.m_tx_hash, TxInfo::INCOMING);
-      TxInfo& recv = snapshot.back();
+      TxInfo recv(upd.m_tx_hash, TxInfo::INCOMING);
       recv.m_subaddress_major = upd.m_subaddr_index.major;
       recv.m_subaddress_minor = upd.m_subaddr_index.minor;
       recv.m_amount = amount;
@@ -459,8 +732,75 @@ void Wallet::captureTxHistorySnapshot(std::vector<TxInfo>& snapshot) {
       recv.m_fee = upd.m_fee;
       recv.m_coinbase = upd.m_coinbase;
       recv.m_state = TxInfo::PENDING;
+      history.append(recv);
     }
   }
+
+  history.seal();
+  LOGD("Tx history captured: %zu entries, %zu bytes", history.size(), history.memory_usage());
+}
+
+// Installs the lookahead table of a restored account into wallet2, waiting
+// for it if it is still being derived.  Called before wallet2 reads or
+// extends its subaddress map.
+void Wallet::completeSubaddressLookaheadLocked() {
+  SubaddressLookahead::Table table;
+  if (!m_subaddress_lookahead.take(&table)) {
+    return;
+  }
+  auto& subaddresses = Wallet2Accessor::subaddresses(m_wallet);
+  for (const auto& entry: table) {
+    subaddresses[entry.first] = entry.second;
+  }
+  // Later expansions of the table look ahead as far as wallet2 would have.
+  m_wallet.set_subaddress_lookahead(SUBADDRESS_LOOKAHEAD_MAJOR, SUBADDRESS_LOOKAHEAD_MINOR);
+}
+
+// Swaps in a new snapshot and recomputes the balances from it.
+void Wallet::installTxHistory(TxHistory& history) {
+  static LockSite site("tx_history", "installTxHistory");
+  ProfiledLock lock(m_tx_history_mutex, site);
+  TxHistoryChange change = {history.generation(), false, 0};
+  change.changed = history.first_difference(m_tx_history, &change.height);
+  m_tx_history.swap(history);
+  m_balances.rebuild(m_tx_history, m_last_block_height, m_last_block_timestamp);
+  m_tx_history_changes.push_back(change);
+  if (m_tx_history_changes.size() > kTxHistoryChangesKept) {
+    m_tx_history_changes.pop_front();
+  }
+}
+
+bool Wallet::txHistoryChangedSince(uint32_t generation, uint64_t* height) const {
+  if (generation == m_tx_history.generation()) {
+    return false;
+  }
+  auto it = std::find_if(m_tx_history_changes.begin(), m_tx_history_changes.end(),
+                         [generation](const TxHistoryChange& change) {
+                           return change.generation == generation;
+                         });
+  if (it == m_tx_history_changes.end()) {
+    *height = 0;
+    return true;
+  }
+  bool changed = false;
+  uint64_t lowest = TxHistory::kUnconfirmedHeight;
+  for (++it; it != m_tx_history_changes.end(); ++it) {
+    if (it->changed) {
+      changed = true;
+      lowest = std::min(lowest, it->height);
+    }
+  }
+  *height = lowest;
+  return changed;
+}
+
+BalanceAggregate Wallet::queryBalance(uint32_t index_major, uint32_t index_minor) {
+  static LockSite site("tx_history", "queryBalance");
+  ProfiledLock lock(m_tx_history_mutex, site);
+  if (index_minor == static_cast<uint32_t>(-1)) {
+    return m_balances.query(index_major);
+  }
+  return m_balances.query(cryptonote::subaddress_index{index_major, index_minor});
 }
 
 // Only call this function from the callback thread or during initialization.
@@ -482,8 +822,28 @@ void Wallet::updateSubaddressMap(std::map<cryptonote::subaddress_index, std::str
 
 void Wallet::handleNewBlock(uint64_t height, uint64_t timestamp) {
   LOG_FATAL_IF(height >= CRYPTONOTE_MAX_BLOCK_NUMBER, "Blockchain max height reached");
+  if (height > m_last_block_height) {
+    m_fee_cache.invalidateBelow(height);
+  }
+  BlockTimeTable::forNetwork(m_wallet.nettype()).observe(height, timestamp);
+  if (m_hashchain_seeded && height > m_hashchain_checkpoint) {
+    // The node extended the seeded hashchain, so it knows the checkpoint.
+    m_hashchain_seeded = false;
+  }
+  if (m_restore_timing && height >= m_restore_height) {
+    m_restore_timing = false;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_restore_start_time);
+    LOGI("First block scanned after restore: height=%" PRIu64 ", elapsed=%lld ms",
+         height, static_cast<long long>(elapsed.count()));
+  }
   m_last_block_height = height;
   m_last_block_timestamp = timestamp;
+  {
+    static LockSite site("tx_history", "handleNewBlock");
+    ProfiledLock lock(m_tx_history_mutex, site);
+    m_balances.advanceTo(height, timestamp);
+  }
   processBalanceChanges(true);
 }
 
@@ -497,12 +857,14 @@ void Wallet::handleMoneyEvent(uint64_t at_block_height) {
 
 void Wallet::processBalanceChanges(bool refresh_running) {
   if (m_balance_changed) {
-    m_subaddresses_mutex.lock();
-    updateSubaddressMap(m_subaddresses);
-    m_subaddresses_mutex.unlock();
-    m_tx_history_mutex.lock();
-    captureTxHistorySnapshot(m_tx_history);
-    m_tx_history_mutex.unlock();
+    {
+      static LockSite site("subaddresses", "processBalanceChanges");
+      ProfiledLock lock(m_subaddresses_mutex, site);
+      updateSubaddressMap(m_subaddresses);
+    }
+    TxHistory history;
+    captureTxHistorySnapshot(history);
+    installTxHistory(history);
   }
   notifyRefreshState(!m_balance_changed && refresh_running);
   m_balance_changed = false;
@@ -526,431 +888,146 @@ void Wallet::notifyRefreshState(bool debounce) {
     last_time = std::chrono::steady_clock::now();
   }
   if (!debounce) {
-    CallVoidMethod(GetJniEnv(), m_callback.obj(), NativeWallet_onRefresh,
-                   height, ts, m_balance_changed);
+    m_listener->onRefresh(height, ts, m_balance_changed);
   }
 }
 
-Wallet::Status Wallet::nonReentrantRefresh(bool skip_coinbase) {
-  LOG_FATAL_IF(m_refresh_running.exchange(true),
-               "Refresh should not be called concurrently");
-  Status ret;
-  std::unique_lock<std::mutex> wallet_lock(m_wallet_mutex);
-  m_wallet.set_refresh_type(skip_coinbase ? wallet2::RefreshType::RefreshNoCoinbase
-                                          : wallet2::RefreshType::RefreshDefault);
-  while (!m_refresh_canceled) {
-    m_wallet.set_refresh_from_block_height(m_restore_height);
-    try {
-      // refresh() will block until stop() is called or it syncs successfully.
-      m_wallet.refresh(false /* trusted_daemon */);
-      if (!m_wallet.stopped()) {
-        m_wallet.stop();
-        ret = Status::OK;
-        break;
-      }
-    } catch (const error::no_connection_to_daemon&) {
-      ret = Status::NO_NETWORK_CONNECTIVITY;
-      break;
-    } catch (const error::refresh_error&) {
-      ret = Status::REFRESH_ERROR;
-      break;
-    }
-    m_refresh_cond.wait(wallet_lock);
+Wallet::SliceResult Wallet::refreshSlice(bool skip_coinbase,
+                                         uint64_t max_blocks,
+                                         uint64_t* blocks_fetched,
+                                         Wallet::Status* status) {
+  *blocks_fetched = 0;
+  static LockSite site("wallet", "refreshSlice");
+  ProfiledLock wallet_lock(m_wallet_mutex, site, std::try_to_lock);
+  if (!wallet_lock.owns_lock()) {
+    // Refresh is suspended while another call holds the wallet.
+    return SliceResult::BUSY;
   }
-  if (m_refresh_canceled) {
+  if (m_refresh_canceled || m_call_state->closing.load()) {
     m_refresh_canceled = false;
-    ret = Status::INTERRUPTED;
+    *status = Status::INTERRUPTED;
+  } else if (!refreshLocked(skip_coinbase, max_blocks, blocks_fetched, status)) {
+    return SliceResult::MORE;
   }
-  m_refresh_running.store(false);
   // Ensure the latest block and pool state are consistently processed.
   processBalanceChanges(false);
-  return ret;
+  return SliceResult::DONE;
+}
+
+bool Wallet::refreshLocked(bool skip_coinbase,
+                           uint64_t max_blocks,
+                           uint64_t* blocks_fetched,
+                           Wallet::Status* status) {
+  // Blocks are held until the lookahead table is complete, so that outputs
+  // to subaddresses in it are not missed.
+  completeSubaddressLookaheadLocked();
+  m_wallet.set_refresh_type(skip_coinbase ? wallet2::RefreshType::RefreshNoCoinbase
+                                          : wallet2::RefreshType::RefreshDefault);
+  m_wallet.set_refresh_from_block_height(m_restore_height);
+  bool received_money = false;
+  try {
+    // refresh() returns when stop() is called, after `max_blocks` blocks, or
+    // once it syncs successfully.  Its trusted_daemon flag only selects the
+    // granularity of the short chain history: the coarse one used on a first
+    // refresh would leave out a seeded checkpoint hash.
+    m_wallet.refresh(m_hashchain_seeded /* trusted_daemon */, 0 /* start_height */,
+                     *blocks_fetched, received_money,
+                     true /* check_pool */, true /* try_incremental */,
+                     max_blocks);
+  } catch (const error::wallet_internal_error&) {
+    // A node on a different chain does not know the seeded checkpoint.
+    if (!seededCheckpointRejected()) {
+      throw;
+    }
+    resetHashchain();
+    return false;
+  } catch (const error::no_connection_to_daemon&) {
+    *status = m_call_state->timed_out.load() ? Status::TIMEOUT
+                                             : Status::NO_NETWORK_CONNECTIVITY;
+    return true;
+  } catch (const error::refresh_error&) {
+    if (seededCheckpointRejected()) {
+      resetHashchain();
+      return false;
+    }
+    *status = Status::REFRESH_ERROR;
+    return true;
+  }
+  if (m_hashchain_seeded
+      && m_wallet.get_blockchain_current_height() > m_hashchain_checkpoint + 1) {
+    m_hashchain_seeded = false;
+  }
+  if (m_compact_transfers) {
+    compactTransfersLocked();
+  }
+  if (m_wallet.stopped() || *blocks_fetched >= max_blocks) {
+    return false;
+  }
+  m_wallet.stop();
+  m_hashchain_seeded = false;
+  fetchMissingBlockTimesLocked();
+  BlockTimeTable::forNetwork(m_wallet.nettype()).persist();
+  *status = Status::OK;
+  return true;
+}
+
+void Wallet::fetchMissingBlockTimesLocked() {
+  BlockTimeTable& table = BlockTimeTable::forNetwork(m_wallet.nettype());
+  for (uint64_t height: table.missingSamples(m_last_block_height, kBlockTimeSamplesPerRefresh)) {
+    cryptonote::COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::request req = AUTO_VAL_INIT(req);
+    cryptonote::COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::response res = AUTO_VAL_INIT(res);
+    req.height = height;
+    req.fill_pow_hash = false;
+    if (!m_wallet.invoke_http_json_rpc("/json_rpc", "getblockheaderbyheight", req, res)
+        || res.status != CORE_RPC_STATUS_OK) {
+      // Tried again after the next refresh.
+      return;
+    }
+    table.observe(height, res.block_header.timestamp);
+  }
+}
+
+void Wallet::onRefreshResult(Wallet::Status status) {
+  m_listener->onRefreshResult(status);
 }
 
 template<typename T>
-auto Wallet::suspendRefreshAndRunLocked(T block) -> decltype(block()) {
-  std::unique_lock<std::mutex> wallet_lock(m_wallet_mutex, std::try_to_lock);
+auto Wallet::suspendRefreshAndRunLocked(LockSite& site, T block) -> decltype(block()) {
+  ProfiledLock wallet_lock(m_wallet_mutex, site, std::try_to_lock);
   if (!wallet_lock.owns_lock()) {
-    JNIEnv* env = GetJniEnv();
     for (;;) {
       if (!m_wallet.stopped()) {
         m_wallet.stop();
-        CallVoidMethod(env, m_callback.obj(),
-                       NativeWallet_onSuspendRefresh, true);
+        m_listener->onSuspendRefresh(true);
       }
       if (wallet_lock.try_lock()) {
         break;
       }
       std::this_thread::yield();
     }
-    CallVoidMethod(env, m_callback.obj(),
-                   NativeWallet_onSuspendRefresh, false);
-    m_refresh_cond.notify_one();
+    m_listener->onSuspendRefresh(false);
   }
+  WakeRefreshOnRelease wake(this, wallet_lock);
   // Call the lambda and release the mutex upon completion.
   return block();
 }
 
 void Wallet::cancelRefresh() {
-  suspendRefreshAndRunLocked([&]() {
+  static LockSite site("wallet", "cancelRefresh");
+  suspendRefreshAndRunLocked(site, [&]() {
     m_refresh_canceled = true;
   });
 }
 
 void Wallet::setRefreshSince(long height_or_timestamp) {
-  suspendRefreshAndRunLocked([&]() {
+  static LockSite site("wallet", "setRefreshSince");
+  suspendRefreshAndRunLocked(site, [&]() {
     if (height_or_timestamp < CRYPTONOTE_MAX_BLOCK_NUMBER) {
       m_restore_height = height_or_timestamp;
     } else {
-      LOG_FATAL("TODO");
+      m_restore_height = estimateRestoreHeight(height_or_timestamp);
     }
   });
 }
 
-extern "C"
-JNIEXPORT jlong JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreate(
-    JNIEnv* env,
-    jobject thiz,
-    jint network_id) {
-  auto* wallet = new Wallet(env, network_id, JavaParamRef<jobject>(thiz));
-  return NativeToJavaPointer(wallet);
-}
-
-extern "C"
-JNIEXPORT void JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeDispose(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  delete reinterpret_cast<Wallet*>(handle);
-}
-
-extern "C"
-JNIEXPORT void JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeRestoreAccount(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle,
-    jbyteArray j_secret_scalar,
-    jlong restore_point) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  std::vector<char> secret_scalar = JavaToNativeByteArray(env, j_secret_scalar);
-  Eraser secret_eraser(secret_scalar);
-  wallet->restoreAccount(secret_scalar, restore_point);
-}
-
-extern "C"
-JNIEXPORT jboolean JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeLoad(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle,
-    jint fd) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  io::stream<io::file_descriptor_source> in_stream(fd, io::never_close_handle);
-  return wallet->parseFrom(in_stream);
-}
-
-extern "C"
-JNIEXPORT jboolean JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeSave(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle, jint fd) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  io::stream<io::file_descriptor_sink> out_stream(fd, io::never_close_handle);
-  return wallet->writeTo(out_stream);
-}
-
-extern "C"
-JNIEXPORT jint JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeNonReentrantRefresh
-    (JNIEnv* env,
-     jobject thiz,
-     jlong handle,
-     jboolean skip_coinbase) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  return wallet->nonReentrantRefresh(skip_coinbase);
-}
-
-extern "C"
-JNIEXPORT void JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeCancelRefresh(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  wallet->cancelRefresh();
-}
-
-extern "C"
-JNIEXPORT void JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeSetRefreshSince(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle,
-    jlong height_or_timestamp) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  wallet->setRefreshSince(height_or_timestamp);
-}
-
-extern "C"
-JNIEXPORT jbyteArray JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetSpendSecretKey(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  auto key = wallet->spend_secret_key();
-  return NativeToJavaByteArray(env, key.data, sizeof(key.data));
-}
-
-extern "C"
-JNIEXPORT jbyteArray JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetViewSecretKey(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  auto key = wallet->view_secret_key();
-  return NativeToJavaByteArray(env, key.data, sizeof(key.data));
-}
-
-extern "C"
-JNIEXPORT jstring JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetPublicAddress(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  return NativeToJavaString(env, wallet->public_address());
-}
-
-extern "C"
-JNIEXPORT jstring JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeAddDetachedSubAddress(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle,
-    jint sub_address_major,
-    jint sub_address_minor) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  return NativeToJavaString(
-      env, wallet->addDetachedSubAddress(sub_address_major, sub_address_minor));
-}
-
-extern "C"
-JNIEXPORT jstring JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreateSubAddressAccount(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  return NativeToJavaString(env, wallet->createSubAddressAccount());
-}
-
-extern "C"
-JNIEXPORT jstring JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreateSubAddress(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle,
-    jint sub_address_major) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  try {
-    return NativeToJavaString(env, wallet->createSubAddress(sub_address_major));
-  } catch (error::account_index_outofbound& e) {
-    return nullptr;
-  }
-}
-
-extern "C"
-JNIEXPORT jobjectArray JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetSubAddresses(
-    JNIEnv* env,
-    jobject thiz,
-    jint sub_address_major,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  try {
-    auto subaddresses = wallet->formatted_subaddresses(sub_address_major);
-    return NativeToJavaStringArray(env, subaddresses);
-  } catch (error::account_index_outofbound& e) {
-    return NativeToJavaStringArray(env, {});
-  }
-}
-
-extern "C"
-JNIEXPORT jint JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetCurrentBlockchainHeight(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  return wallet->current_blockchain_height();
-}
-
-extern "C"
-JNIEXPORT jlong JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetCurrentBlockchainTimestamp(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  return wallet->current_blockchain_timestamp();
-}
-
-ScopedJavaLocalRef<jobject> NativeToJavaTxInfo(JNIEnv* env,
-                                               const TxInfo& tx) {
-  LOG_FATAL_IF(tx.m_height >= CRYPTONOTE_MAX_BLOCK_NUMBER,
-               "Blockchain max height reached");
-  // TODO: Check amount overflow
-  return {env, NewObject(
-      env,
-      TxInfoClass.obj(), TxInfo_ctor,
-      ScopedJavaLocalRef<jstring>(
-          env, NativeToJavaString(env, pod_to_hex(tx.m_tx_hash))).obj(),
-      tx.m_public_key_known ? ScopedJavaLocalRef<jstring>(
-          env, NativeToJavaString(env, pod_to_hex(tx.m_public_key))).obj()
-                            : nullptr,
-      tx.m_key_image_known ? ScopedJavaLocalRef<jstring>(
-          env, NativeToJavaString(env, pod_to_hex(tx.m_key_image))).obj()
-                           : nullptr,
-      tx.m_subaddress_major,
-      tx.m_subaddress_minor,
-      (!tx.m_recipient.empty()) ? ScopedJavaLocalRef<jstring>(
-          env, NativeToJavaString(env, tx.m_recipient)).obj()
-                                : nullptr,
-      tx.m_amount,
-      static_cast<jint>(tx.m_height),
-      tx.m_unlock_time,
-      tx.m_timestamp,
-      tx.m_fee,
-      tx.m_change,
-      static_cast<jbyte>(tx.m_state),
-      tx.m_coinbase,
-      tx.m_type == TxInfo::INCOMING)
-  };
-}
-
-extern "C"
-JNIEXPORT jobjectArray JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeGetTxHistory(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  jobjectArray j_array;
-  wallet->withTxHistory([env, &j_array](std::vector<TxInfo> const& txs) {
-    j_array = NativeToJavaObjectArray<TxInfo>(env,
-                                              txs,
-                                              TxInfoClass.obj(),
-                                              &NativeToJavaTxInfo);
-  });
-  return j_array;
-}
-
-extern "C"
-JNIEXPORT void JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeCreatePayment(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle,
-    jobjectArray j_addresses,
-    jlongArray j_amounts,
-    jint priority,
-    jint account_index,
-    jintArray j_subaddr_indexes,
-    jobject j_callback) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-
-  const auto& addresses = JavaToNativeVector<std::string, jstring>(
-      env, j_addresses, &JavaToNativeString);
-  const auto& amounts = JavaToNativeLongArray(env, j_amounts);
-  const auto& subaddr_indexes = JavaToNativeIntArray(env, j_subaddr_indexes);
-
-  std::unique_ptr<PendingTransfer> pending_transfer;
-
-  try {
-    pending_transfer = wallet->createPayment(
-        addresses,
-        {amounts.begin(), amounts.end()},
-        priority,
-        account_index,
-        {subaddr_indexes.begin(), subaddr_indexes.end()});
-//  } catch (error::daemon_busy& e) {
-//  } catch (error::no_connection_to_daemon& e) {
-//  } catch (error::wallet_rpc_error& e) {
-//  } catch (error::get_outs_error& e) {
-//  } catch (error::not_enough_unlocked_money& e) {
-//  } catch (error::not_enough_money& e) {
-//  } catch (error::tx_not_possible& e) {
-//  } catch (error::not_enough_outs_to_mix& e) {
-//  } catch (error::tx_not_constructed& e) {
-//  } catch (error::tx_rejected& e) {
-//  } catch (error::tx_sum_overflow& e) {
-//  } catch (error::zero_amount& e) {
-//  } catch (error::zero_destination& e) {
-//  } catch (error::tx_too_big& e) {
-//  } catch (error::transfer_error& e) {
-//  } catch (error::wallet_internal_error& e) {
-//  } catch (error::wallet_logic_error& e) {
-  } catch (const std::exception& e) {
-    LOGW("Caught unhandled exception: %s", e.what());
-    CallVoidMethod(env, j_callback,
-                   ITransferCallback_onUnexpectedError,
-                   NativeToJavaString(env, e.what()));
-    return;
-  }
-
-  PendingTransfer* ptr = pending_transfer.release();
-
-  jobject j_pending_transfer = CallObjectMethod(
-      env, thiz,
-      NativeWallet_createPendingTransfer,
-      NativeToJavaPointer(ptr),
-      ptr->amount(),
-      ptr->fee(),
-      ptr->txCount());
-
-  CallVoidMethod(env, j_callback,
-                 ITransferCallback_onTransferCreated, j_pending_transfer);
-}
-
-extern "C"
-JNIEXPORT void JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeCommitPendingTransfer(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle,
-    jlong transfer_handle,
-    jobject j_callback) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  auto* pending_transfer = reinterpret_cast<PendingTransfer*>(transfer_handle);
-
-  try {
-    wallet->commit_transfer(*pending_transfer);
-  } catch (const std::exception& e) {
-    LOGW("Caught unhandled exception: %s", e.what());
-    CallVoidMethod(env, j_callback,
-                   ITransferCallback_onUnexpectedError,
-                   NativeToJavaString(env, e.what()));
-    return;
-  }
-
-  CallVoidMethod(env, j_callback, ITransferCallback_onTransferCommitted);
-}
-
-extern "C"
-JNIEXPORT jlongArray JNICALL
-Java_im_molly_monero_sdk_internal_NativeWallet_nativeFetchBaseFeeEstimate(
-    JNIEnv* env,
-    jobject thiz,
-    jlong handle) {
-  auto* wallet = reinterpret_cast<Wallet*>(handle);
-  std::vector<uint64_t> fees = wallet->fetchBaseFeeEstimate();
-  return NativeToJavaLongArray(env, fees.data(), fees.size());
-}
-
 }  // namespace monero
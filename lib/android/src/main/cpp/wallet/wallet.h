@@ -1,12 +1,20 @@
 #ifndef WALLET_WALLET_H_
 #define WALLET_WALLET_H_
 
+#include <deque>
+#include <memory>
 #include <ostream>
 
-#include "common/jvm.h"
+#include "common/secret_arena.h"
 
+#include "balance_tracker.h"
+#include "fee_cache.h"
 #include "transfer.h"
 #include "http_client.h"
+#include "ledger_summary.h"
+#include "lock_profiler.h"
+#include "subaddress_lookahead.h"
+#include "tx_history.h"
 
 #include "wallet2.h"
 
@@ -17,57 +25,7 @@ namespace error = tools::error;
 using wallet2 = tools::wallet2;
 using i_wallet2_callback = tools::i_wallet2_callback;
 
-// Basic structure combining transaction details with input or output info.
-struct TxInfo {
-  crypto::hash m_tx_hash;
-  crypto::public_key m_public_key;
-  crypto::key_image m_key_image;
-  uint32_t m_subaddress_major;
-  uint32_t m_subaddress_minor;
-  std::string m_recipient;
-  uint64_t m_amount;
-  uint64_t m_height;
-  uint64_t m_unlock_time;
-  uint64_t m_timestamp;
-  uint64_t m_fee;
-  uint64_t m_change;
-  bool m_coinbase;
-  bool m_public_key_known;
-  bool m_key_image_known;
-
-  enum TxType {
-    INCOMING = 0,
-    OUTGOING = 1,
-  } m_type;
-
-  enum TxState {
-    OFF_CHAIN = 1,
-    PENDING = 2,
-    FAILED = 3,
-    ON_CHAIN = 4,
-  } m_state;
-
-  TxInfo(crypto::hash tx_hash, TxType type) :
-      m_tx_hash(tx_hash),
-      m_public_key(crypto::public_key{}),
-      m_key_image(crypto::key_image{}),
-      m_subaddress_major(-1),
-      m_subaddress_minor(-1),
-      m_recipient(),
-      m_amount(0),
-      m_height(0),
-      m_unlock_time(0),
-      m_timestamp(0),
-      m_fee(0),
-      m_change(0),
-      m_coinbase(false),
-      m_public_key_known(false),
-      m_key_image_known(false),
-      m_type(type),
-      m_state(OFF_CHAIN) {}
-
-  // TODO: Factory functions for various types of transactions.
-};
+class WalletListener;
 
 // Wrapper for wallet2.h core API.
 class Wallet : i_wallet2_callback {
@@ -77,23 +35,48 @@ class Wallet : i_wallet2_callback {
     INTERRUPTED = 1,
     NO_NETWORK_CONNECTIVITY = 2,
     REFRESH_ERROR = 3,
+    TIMEOUT = 4,
   };
 
  public:
-  Wallet(JNIEnv* env,
-         int network_id,
-         const JavaRef<jobject>& wallet_native);
+  // Calls to the node go through `transport` unless a synthetic chain or an
+  // RPC trace is being served.
+  Wallet(int network_id,
+         std::shared_ptr<NodeTransport> transport,
+         std::unique_ptr<WalletListener> listener);
 
-  void restoreAccount(const std::vector<char>& secret_scalar, uint64_t restore_point);
+  void restoreAccount(const SecretBuffer& secret_scalar, uint64_t restore_point);
   uint64_t estimateRestoreHeight(uint64_t timestamp);
 
   bool parseFrom(std::istream& input);
   bool writeTo(std::ostream& output);
 
-  Wallet::Status nonReentrantRefresh(bool skip_coinbase);
+  ~Wallet();
+
+  enum class SliceResult {
+    DONE,  // The refresh is over, with the outcome in `*status`.
+    MORE,  // The refresh must be resumed with another slice.
+    BUSY,  // Another call holds the wallet; resume once it releases it.
+  };
+
+  // Runs one slice of refresh work of at most `max_blocks` blocks.  Called
+  // from RefreshScheduler workers.
+  SliceResult refreshSlice(bool skip_coinbase,
+                           uint64_t max_blocks,
+                           uint64_t* blocks_fetched,
+                           Wallet::Status* status);
+  void onRefreshResult(Wallet::Status status);
   void cancelRefresh();
   void setRefreshSince(long height_or_timestamp);
 
+  // Drops the tx inputs kept with every owned output, now and as new outputs
+  // are found.  The setting is saved with the wallet.
+  void enableCompactTransfers();
+
+  // Lets block requests of this wallet go through the process-wide block
+  // cache, once it has been configured.  Not saved with the wallet.
+  void enableBlockCache();
+
   std::string addDetachedSubAddress(uint32_t index_major, uint32_t index_minor);
   std::string createSubAddressAccount();
   std::string createSubAddress(uint32_t index_major);
@@ -108,10 +91,26 @@ class Wallet : i_wallet2_callback {
   void commit_transfer(PendingTransfer& pending_transfer);
 
   template<typename Consumer>
-  void withTxHistory(Consumer consumer);
+  void withTxHistory(LockSite& site, Consumer consumer);
+
+  // Stores in `height` the height from which the current history differs
+  // from the snapshot of `generation`, or 0 if that snapshot is too old to
+  // tell.  Returns false if nothing changed.  Call from withTxHistory().
+  bool txHistoryChangedSince(uint32_t generation, uint64_t* height) const;
 
   std::vector<uint64_t> fetchBaseFeeEstimate();
 
+  // Balance of one subaddress, or of a whole account when `index_minor` is
+  // -1, or of every account when both are -1.
+  BalanceAggregate queryBalance(uint32_t index_major, uint32_t index_minor);
+
+  uint64_t fee_cache_hits() const { return m_fee_cache.hits(); }
+  uint64_t fee_cache_misses() const { return m_fee_cache.misses(); }
+
+  // Lock profile of the process and counters of this wallet, as
+  // "name value" lines.
+  std::string dumpStats();
+
   std::string public_address() const;
   std::vector<std::string> formatted_subaddresses(uint32_t index_major = -1);
 
@@ -123,38 +122,80 @@ class Wallet : i_wallet2_callback {
 
   // Extra state that must be persistent but isn't restored by wallet2's serializer.
   BEGIN_SERIALIZE_OBJECT()
-    VERSION_FIELD(0)
+    VERSION_FIELD(1)
     FIELD(m_restore_height)
     FIELD(m_last_block_height)
     FIELD(m_last_block_timestamp)
+    if (version < 1) {
+      m_compact_transfers = false;
+      return true;
+    }
+    FIELD(m_compact_transfers)
   END_SERIALIZE()
 
  private:
   cryptonote::account_base& require_account();
   const cryptonote::account_base& require_account() const;
 
+  // Shared with the RPC clients created by wallet2, so declared first.
+  const std::shared_ptr<RemoteNodeCallState> m_call_state;
+  const std::shared_ptr<NodeTransport> m_transport;
+
   wallet2 m_wallet;
 
   bool m_account_ready;
+  // Set while the hashchain starts at a checkpoint that the node has not
+  // confirmed yet by serving a block above it.
+  bool m_hashchain_seeded;
+  uint64_t m_hashchain_checkpoint;
   uint64_t m_restore_height;
   uint64_t m_last_block_height;
   uint64_t m_last_block_timestamp;
 
+  // Whether transfer_details keep only the tx prefix fields read when
+  // spending or building the history.  Outputs below m_compacted_transfers
+  // are already compacted.
+  bool m_compact_transfers;
+  size_t m_compacted_transfers;
+
   std::map<cryptonote::subaddress_index, std::string> m_subaddresses;
 
+  // Lookahead table of a restored account, until installed into m_wallet.
+  SubaddressLookahead m_subaddress_lookahead;
+
   // Saved transaction history.
-  std::vector<TxInfo> m_tx_history;
+  TxHistory m_tx_history;
+
+  // Balances derived from m_tx_history, guarded by the same mutex.
+  BalanceTracker m_balances;
+
+  struct TxHistoryChange {
+    uint32_t generation;
+    bool changed;
+    uint64_t height;
+  };
+
+  // Recent snapshots, oldest first, with the height from which each one
+  // differs from the one before.  Guarded by m_tx_history_mutex.
+  std::deque<TxHistoryChange> m_tx_history_changes;
 
   // Protects access to m_wallet instance and state fields.
-  std::mutex m_wallet_mutex;
-  std::mutex m_tx_history_mutex;
-  std::mutex m_subaddresses_mutex;
+  ProfiledMutex m_wallet_mutex;
+  ProfiledMutex m_tx_history_mutex;
+  ProfiledMutex m_subaddresses_mutex;
+
+  // Fee estimates keyed by chain height.  Readers never take m_wallet_mutex;
+  // m_fee_fetch_mutex only collapses concurrent misses into a single RPC.
+  FeeEstimateCache m_fee_cache;
+  std::mutex m_fee_fetch_mutex;
+
+  // Receiver of refresh events, the Kotlin wallet instance on Android.
+  const std::unique_ptr<WalletListener> m_listener;
 
-  // Reference to Kotlin wallet instance.
-  const ScopedJavaGlobalRef<jobject> m_callback;
+  // Time when the account was restored, until the first block is scanned.
+  std::chrono::steady_clock::time_point m_restore_start_time;
+  bool m_restore_timing;
 
-  std::condition_variable m_refresh_cond;
-  std::atomic<bool> m_refresh_running;
   bool m_refresh_canceled;
   bool m_balance_changed;
 
@@ -162,9 +203,26 @@ class Wallet : i_wallet2_callback {
   void notifyRefreshState(bool debounce);
 
   template<typename T>
-  auto suspendRefreshAndRunLocked(T block) -> decltype(block());
-
-  void captureTxHistorySnapshot(std::vector<TxInfo>& snapshot);
+  auto suspendRefreshAndRunLocked(LockSite& site, T block) -> decltype(block());
+
+  bool refreshLocked(bool skip_coinbase,
+                     uint64_t max_blocks,
+                     uint64_t* blocks_fetched,
+                     Wallet::Status* status);
+
+  // Fills a few gaps of the block time table that scanning cannot, such as
+  // heights below the restore height.
+  void fetchMissingBlockTimesLocked();
+
+  bool seedHashchain(uint64_t height);
+  bool seededCheckpointRejected();
+  void resetHashchain();
+
+  void compactTransfersLocked();
+  void completeSubaddressLookaheadLocked();
+  void captureTxHistorySnapshot(TxHistory& snapshot);
+  void installTxHistory(TxHistory& history);
+  void captureLedgerSummary(LedgerSummary* summary);
   void updateSubaddressMap(std::map<cryptonote::subaddress_index, std::string>& map);
   std::string addSubaddressInternal(const cryptonote::subaddress_index& index);
   void handleNewBlock(uint64_t height, uint64_t timestamp);
@@ -211,6 +269,24 @@ class Wallet : i_wallet2_callback {
   };
 };
 
+template<typename Consumer>
+void Wallet::withTxHistory(LockSite& site, Consumer consumer) {
+  ProfiledLock lock(m_tx_history_mutex, site);
+  consumer(m_tx_history);
+}
+
+// Events raised by a Wallet, delivered on the thread that raises them.
+class WalletListener {
+ public:
+  virtual ~WalletListener() = default;
+
+  virtual void onRefresh(uint32_t height, uint64_t timestamp, bool balance_changed) = 0;
+  virtual void onRefreshResult(Wallet::Status status) = 0;
+  // Refresh is paused around calls that need the wallet lock, and resumed
+  // once they are done.
+  virtual void onSuspendRefresh(bool suspended) = 0;
+};
+
 }  // namespace monero
 
 #endif  // WALLET_WALLET_H_
@@ -0,0 +1,26 @@
+#ifndef WALLET_WALLET2_ACCESSOR_H_
+#define WALLET_WALLET2_ACCESSOR_H_
+
+#include "wallet2.h"
+
+// wallet2 declares this class as a friend for monero's own unit tests, which
+// are not linked into the SDK.  It is defined here to reach wallet2 state that
+// has no public accessor.  Keep its use to a minimum.
+class wallet_accessor_test {
+ public:
+  static tools::wallet2::transfer_container& transfers(tools::wallet2& wallet) {
+    return wallet.m_transfers;
+  }
+
+  static auto subaddresses(tools::wallet2& wallet) -> decltype((wallet.m_subaddresses)) {
+    return wallet.m_subaddresses;
+  }
+};
+
+namespace monero {
+
+using Wallet2Accessor = ::wallet_accessor_test;
+
+}  // namespace monero
+
+#endif  // WALLET_WALLET2_ACCESSOR_H_
@@ -11,6 +11,11 @@ data class Balance(
         val EMPTY = Balance(emptyList())
     }
 
+    operator fun plus(other: Balance) = Balance(
+        lockableAmounts = lockableAmounts + other.lockableAmounts,
+        pendingAmount = pendingAmount + other.pendingAmount,
+    )
+
     fun unlockedAmountAt(targetTime: BlockchainTime): MoneroAmount {
         return lockableAmounts
             .filter { it.isUnlocked(targetTime) }
@@ -42,3 +47,6 @@ fun Iterable<TimeLocked<Enote>>.calculateBalance(
 
     return Balance(lockableAmounts, pendingAmount)
 }
+
+fun Iterable<TimeLocked<Enote>>.calculateBalanceByAccount(): Map<Int, Balance> =
+    groupBy { it.value.owner.accountIndex }.mapValues { (_, enotes) -> enotes.calculateBalance() }
@@ -0,0 +1,30 @@
+package im.molly.monero.sdk
+
+/**
+ * One row of the wallet history: an output received, an output spent, or a payment sent.
+ * Rows of the same transaction share [txId].
+ */
+data class HistoryEntry(
+    val txId: String,
+    val state: TxState,
+    val incoming: Boolean,
+    val amount: MoneroAmount,
+    /** Sub-address that received an incoming entry. */
+    val accountIndex: Int?,
+    val subAddressIndex: Int?,
+    /** Destination of a payment. */
+    val recipient: PublicAddress?,
+    val keyImage: HashDigest?,
+    val fee: MoneroAmount,
+) {
+    val blockHeight: Int? = (state as? TxState.OnChain)?.blockHeader?.height
+}
+
+/**
+ * A page of [HistoryEntry] rows.  [nextCursor] resumes the query, or is null once all
+ * matching entries were returned.
+ */
+data class HistoryPage(
+    val entries: List<HistoryEntry>,
+    val nextCursor: Long?,
+)
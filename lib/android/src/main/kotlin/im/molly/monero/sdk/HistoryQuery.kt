@@ -0,0 +1,48 @@
+package im.molly.monero.sdk
+
+import android.os.Parcelable
+import im.molly.monero.sdk.internal.LongRangeParceler
+import kotlinx.parcelize.Parcelize
+import kotlinx.parcelize.WriteWith
+
+/**
+ * Filters and ordering of a [MoneroWallet.queryHistory] call.  Null fields match any entry.
+ * Entries still in the pool have no height and are left out by a [heightRange].
+ */
+@Parcelize
+data class HistoryQuery(
+    val accountIndex: Int? = null,
+    val subAddressIndex: Int? = null,
+    val incoming: Boolean? = null,
+    val states: Set<State>? = null,
+    val heightRange: @WriteWith<LongRangeParceler> LongRange? = null,
+    val timestampRange: @WriteWith<LongRangeParceler> LongRange? = null,
+    val order: Order = Order.HEIGHT_DESCENDING,
+) : Parcelable {
+    init {
+        require(subAddressIndex == null || accountIndex != null) {
+            "Sub-address index requires an account index"
+        }
+        require(heightRange == null || heightRange.first >= 0)
+        require(timestampRange == null || timestampRange.first >= 0)
+    }
+
+    /** Must match `TxInfo::TxState` in native code, which starts at 1. */
+    enum class State {
+        OFF_CHAIN,
+        IN_MEMORY_POOL,
+        FAILED,
+        ON_CHAIN,
+    }
+
+    /** Must match `TxHistoryQuery::Order` in native code. */
+    enum class Order {
+        HEIGHT_ASCENDING,
+        HEIGHT_DESCENDING,
+        TIMESTAMP_ASCENDING,
+        TIMESTAMP_DESCENDING,
+    }
+
+    internal val stateMask: Int
+        get() = states?.fold(0) { mask, state -> mask or (1 shl (state.ordinal + 1)) } ?: 0
+}
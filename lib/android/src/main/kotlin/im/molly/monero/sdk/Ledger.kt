@@ -6,6 +6,8 @@ data class Ledger(
     val transactionById: Map<String, Transaction>,
     val enoteSet: Set<TimeLocked<Enote>>,
     val checkedAt: BlockchainTime,
+    /** Balance of each account holding enotes, computed once rather than on every call. */
+    val balanceByAccount: Map<Int, Balance> = enoteSet.calculateBalanceByAccount(),
 ) {
     val transactions: Collection<Transaction>
         get() = transactionById.values
@@ -16,8 +18,8 @@ data class Ledger(
     val isBalanceZero: Boolean
         get() = getBalance().totalAmount.isZero
 
-    fun getBalance(): Balance = enoteSet.calculateBalance()
+    fun getBalance(): Balance = balanceByAccount.values.fold(Balance.EMPTY, Balance::plus)
 
     fun getBalanceForAccount(accountIndex: Int): Balance =
-        enoteSet.calculateBalance { it.accountIndex == accountIndex }
+        balanceByAccount[accountIndex] ?: Balance.EMPTY
 }
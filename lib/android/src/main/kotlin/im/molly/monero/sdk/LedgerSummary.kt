@@ -0,0 +1,165 @@
+package im.molly.monero.sdk
+
+import java.io.DataInputStream
+import java.io.EOFException
+import java.io.IOException
+import java.io.InputStream
+
+/**
+ * Balance-relevant state of a saved wallet, read from the header the native wallet writes
+ * in front of its data on every save.
+ *
+ * Reading the summary does not load the wallet, so it can be shown while [WalletProvider.openWallet]
+ * deserializes the full wallet in the background.  Wallet data saved by older versions has
+ * no summary.
+ */
+data class LedgerSummary(
+    val publicAddress: PublicAddress,
+    val blockHeight: Int,
+    val ownedTxOuts: List<OwnedTxOut>,
+) {
+    data class OwnedTxOut(
+        val txId: HashDigest,
+        val amount: MoneroAmount,
+        val blockHeight: Int,
+        val spentHeight: Int?,
+        /** Spent by a transaction that is still in the pool, so [spentHeight] is unknown. */
+        val spentInPool: Boolean = false,
+    ) {
+        val isSpent: Boolean
+            get() = spentHeight != null || spentInPool
+    }
+
+    val unspentAmount: MoneroAmount
+        get() = ownedTxOuts.filterNot { it.isSpent }.sumOf { it.amount }
+
+    companion object {
+        private val MAGIC = byteArrayOf(0xff.toByte(), 'L'.code.toByte(), 'G'.code.toByte(), 'R'.code.toByte())
+
+        /**
+         * Largest summary read, far above what any wallet writes, so that a corrupt size
+         * field cannot make [readFrom] allocate gigabytes.
+         */
+        private const val MAX_SIZE = 16 * 1024 * 1024
+
+        /**
+         * Reads the summary header from the start of saved wallet data, leaving the stream
+         * positioned after it.  Returns null if the data has no summary, or if its size
+         * is out of bounds.
+         */
+        @Throws(IOException::class)
+        fun readFrom(input: InputStream): LedgerSummary? {
+            val data = DataInputStream(input)
+            val magic = ByteArray(MAGIC.size)
+            try {
+                data.readFully(magic)
+            } catch (e: EOFException) {
+                return null
+            }
+            if (!magic.contentEquals(MAGIC)) {
+                return null
+            }
+            val size = Integer.reverseBytes(data.readInt())
+            if (size < 0 || size > MAX_SIZE) {
+                return null
+            }
+            val proto = ByteArray(size).also { data.readFully(it) }
+            return parseLedgerProto(proto)
+        }
+
+        /** Decodes a `LedgerProto` message, as defined in `proto/ledger.proto`. */
+        @Throws(IOException::class)
+        fun parseLedgerProto(bytes: ByteArray): LedgerSummary {
+            var publicAddress = ""
+            var blockHeight = 0L
+            val ownedTxOuts = mutableListOf<OwnedTxOut>()
+            ProtoReader(bytes).forEachField { field, reader ->
+                when (field) {
+                    1 -> publicAddress = String(reader.readBytes())
+                    2 -> blockHeight = reader.readVarint()
+                    3 -> ownedTxOuts.add(parseOwnedTxOutProto(reader.readBytes()))
+                    else -> reader.skip()
+                }
+            }
+            return LedgerSummary(
+                publicAddress = PublicAddress.parse(publicAddress),
+                blockHeight = blockHeight.toInt(),
+                ownedTxOuts = ownedTxOuts,
+            )
+        }
+
+        private fun parseOwnedTxOutProto(bytes: ByteArray): OwnedTxOut {
+            var txId = ByteArray(0)
+            var amount = 0L
+            var blockHeight = 0L
+            var spentHeight = 0L
+            var spentInPool = false
+            ProtoReader(bytes).forEachField { field, reader ->
+                when (field) {
+                    1 -> txId = reader.readBytes()
+                    2 -> amount = reader.readVarint()
+                    3 -> blockHeight = reader.readVarint()
+                    4 -> spentHeight = reader.readVarint()
+                    5 -> spentInPool = reader.readVarint() != 0L
+                    else -> reader.skip()
+                }
+            }
+            return OwnedTxOut(
+                txId = HashDigest(txId),
+                amount = MoneroAmount(amount),
+                blockHeight = blockHeight.toInt(),
+                spentHeight = if (spentHeight != 0L) spentHeight.toInt() else null,
+                spentInPool = spentInPool,
+            )
+        }
+    }
+}
+
+/** Minimal reader for the protobuf wire format. */
+private class ProtoReader(private val bytes: ByteArray) {
+    private var pos = 0
+    private var wireType = 0
+
+    fun forEachField(action: (field: Int, reader: ProtoReader) -> Unit) {
+        while (pos < bytes.size) {
+            val tag = readVarint()
+            wireType = (tag and 0x7).toInt()
+            action((tag ushr 3).toInt(), this)
+        }
+    }
+
+    fun readVarint(): Long {
+        var result = 0L
+        var shift = 0
+        while (shift < 64) {
+            if (pos >= bytes.size) throw IOException("Truncated varint")
+            val b = bytes[pos++].toInt()
+            result = result or ((b and 0x7f).toLong() shl shift)
+            if (b and 0x80 == 0) return result
+            shift += 7
+        }
+        throw IOException("Malformed varint")
+    }
+
+    fun readBytes(): ByteArray {
+        if (wireType != 2) throw IOException("Unexpected wire type $wireType")
+        val length = readVarint()
+        if (length < 0 || length > bytes.size - pos) throw IOException("Truncated field")
+        return bytes.copyOfRange(pos, pos + length.toInt()).also { pos += length.toInt() }
+    }
+
+    fun skip() {
+        when (wireType) {
+            0 -> readVarint()
+            1 -> advance(8)
+            2 -> readBytes()
+            5 -> advance(4)
+            else -> throw IOException("Unsupported wire type $wireType")
+        }
+    }
+
+    private fun advance(count: Int) {
+        if (count > bytes.size - pos) throw IOException("Truncated field")
+        pos += count
+    }
+}
@@ -10,8 +10,13 @@ import im.molly.monero.sdk.internal.IWallet
 import im.molly.monero.sdk.internal.IWalletCallbacks
 import im.molly.monero.sdk.internal.LedgerFactory
 import im.molly.monero.sdk.internal.NativeWallet
+import im.molly.monero.sdk.internal.TxHistoryPage
 import im.molly.monero.sdk.internal.TxInfo
 import im.molly.monero.sdk.internal.loggerFor
+import im.molly.monero.sdk.internal.replaceFrom
+import im.molly.monero.sdk.internal.toBalance
+import im.molly.monero.sdk.internal.toHistoryEntry
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.ExperimentalCoroutinesApi
 import kotlinx.coroutines.channels.awaitClose
 import kotlinx.coroutines.channels.trySendBlocking
@@ -22,6 +27,7 @@ import kotlinx.coroutines.flow.conflate
 import kotlinx.coroutines.flow.first
 import kotlinx.coroutines.flow.flow
 import kotlinx.coroutines.suspendCancellableCoroutine
+import kotlinx.coroutines.withContext
 import kotlin.coroutines.resume
 import kotlin.coroutines.resumeWithException
 import kotlin.coroutines.suspendCoroutine
@@ -143,6 +149,36 @@ class MoneroWallet internal constructor(
         }
     }
 
+    /**
+     * Returns the balance of a sub-address, an account, or the whole wallet, read from
+     * aggregates that the wallet service keeps up to date, without exporting the history.
+     */
+    suspend fun getBalance(accountIndex: Int? = null, subAddressIndex: Int? = null): Balance {
+        require(subAddressIndex == null || accountIndex != null) {
+            "Sub-address index requires an account index"
+        }
+        val buckets = withContext(Dispatchers.IO) {
+            wallet.getBalanceBuckets(accountIndex ?: -1, subAddressIndex ?: -1)
+        }
+        return buckets.toBalance(network)
+    }
+
+    /**
+     * Returns up to [limit] history entries matching [query], starting at [cursor], without
+     * exporting the whole history.  Returns null if the history changed since [cursor] was
+     * handed out; the query must then restart without a cursor.
+     */
+    suspend fun queryHistory(
+        query: HistoryQuery = HistoryQuery(),
+        cursor: Long? = null,
+        limit: Int = 20,
+    ): HistoryPage? {
+        val page = withContext(Dispatchers.IO) {
+            wallet.queryTxHistory(query, cursor ?: TxHistoryPage.CURSOR_START, limit)
+        } ?: return null
+        return HistoryPage(page.txs.map { it.toHistoryEntry() }, page.nextCursor)
+    }
+
     /**
      * A [Flow] of ledger changes.
      */
@@ -150,15 +186,21 @@ class MoneroWallet internal constructor(
         val listener = object : IBalanceListener.Stub() {
             private lateinit var lastKnownLedger: Ledger
 
+            private var txList = emptyList<TxInfo>()
+
             private val txListBuffer = mutableListOf<TxInfo>()
 
+            /**
+             * Refreshes only send the entries from the height where the history changed.
+             */
             override fun onBalanceUpdateFinalized(
                 txBatch: List<TxInfo>,
+                replacedFromHeight: Long,
                 allSubAddresses: Array<String>,
                 blockchainTime: BlockchainTime,
             ) {
-                val txList =
-                    if (txListBuffer.isEmpty()) txBatch else txListBuffer.apply { addAll(txBatch) }
+                txListBuffer.addAll(txBatch)
+                txList = txList.replaceFrom(replacedFromHeight, txListBuffer)
 
                 val accounts = parseAndAggregateAddresses(allSubAddresses.asIterable())
                 val ledger = LedgerFactory.createFromTxHistory(
@@ -197,10 +239,17 @@ class MoneroWallet internal constructor(
         awaitClose { wallet.removeBalanceListener(listener) }
     }.conflate()
 
+    /**
+     * Refreshes the wallet until it is in sync with the blockchain.
+     *
+     * Refreshes of all wallets share a pool of native threads.  Set [background] for wallets
+     * that are not shown to the user so that they yield to foreground ones.
+     */
     suspend fun awaitRefresh(
         ignoreMiningRewards: Boolean = true,
+        background: Boolean = false,
     ): RefreshResult = suspendCancellableCoroutine { continuation ->
-        wallet.resumeRefresh(ignoreMiningRewards, object : BaseWalletCallbacks() {
+        wallet.resumeRefresh(ignoreMiningRewards, background, object : BaseWalletCallbacks() {
             override fun onRefreshResult(blockchainTime: BlockchainTime, status: Int) {
                 val result = RefreshResult(blockchainTime, status)
                 continuation.resume(result) {}
@@ -318,4 +367,7 @@ private abstract class BaseWalletCallbacks : IWalletCallbacks.Stub() {
 
 class RefreshResult(val blockchainTime: BlockchainTime, private val status: Int) {
     fun isError() = status != NativeWallet.Status.OK
+
+    /** The remote node did not answer in time. */
+    fun isTimeout() = status == NativeWallet.Status.TIMEOUT
 }
@@ -1,6 +1,9 @@
 package im.molly.monero.sdk
 
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.withContext
 import java.io.Closeable
+import java.io.File
 
 interface WalletProvider : Closeable {
     suspend fun createNewWallet(
@@ -23,6 +26,27 @@ interface WalletProvider : Closeable {
         client: MoneroNodeClient? = null,
     ): MoneroWallet
 
+    /**
+     * Reads the [LedgerSummary] saved with the wallet in [dataStore] without opening it, or
+     * returns null if the data predates summaries.  Meant to show a balance at startup while
+     * [openWallet] runs.
+     */
+    suspend fun readLedgerSummary(dataStore: WalletDataStore): LedgerSummary? =
+        withContext(Dispatchers.IO) {
+            dataStore.load().use { LedgerSummary.readFrom(it) }
+        }
+
+    /**
+     * Adds the block hash checkpoints in [checkpoints] to those built into monero for [network].
+     * Wallets restored afterwards start their hashchain at the highest checkpoint below the
+     * restore height, instead of downloading every block hash from genesis.  A node that does
+     * not confirm the checkpoint makes the wallet fall back to a full hashchain.
+     *
+     * The file holds a "MCKP" header giving the first height and the interval between
+     * checkpoints, followed by the block hash of each checkpoint.  Returns false if it is invalid.
+     */
+    suspend fun loadCheckpoints(network: MoneroNetwork, checkpoints: File): Boolean
+
     fun isServiceSandboxed(): Boolean
 
     fun disconnect()
@@ -0,0 +1,39 @@
+package im.molly.monero.sdk.internal
+
+import im.molly.monero.sdk.Balance
+import im.molly.monero.sdk.MoneroAmount
+import im.molly.monero.sdk.MoneroNetwork
+import im.molly.monero.sdk.TimeLocked
+import im.molly.monero.sdk.UnlockTime
+import im.molly.monero.sdk.lockedUntil
+import im.molly.monero.sdk.unlocked
+import java.time.Instant
+
+/**
+ * Decodes a balance flattened by native code as
+ * `[pending, unlocked, n, (height, amount) * n, m, (timestamp, amount) * m]`.
+ */
+internal fun LongArray.toBalance(network: MoneroNetwork): Balance {
+    val lockableAmounts = mutableListOf<TimeLocked<MoneroAmount>>()
+    if (this[1] != 0L) {
+        lockableAmounts.add(MoneroAmount(this[1]).unlocked())
+    }
+    var pos = 2
+    val heightBuckets = this[pos++].toInt()
+    repeat(heightBuckets) {
+        val unlockTime = UnlockTime.Block(this[pos].toInt(), network)
+        lockableAmounts.add(MoneroAmount(this[pos + 1]).lockedUntil(unlockTime))
+        pos += 2
+    }
+    val timestampBuckets = this[pos++].toInt()
+    repeat(timestampBuckets) {
+        val epochSecond = this[pos]
+        val timestamp = if (epochSecond in network.epoch..Instant.MAX.epochSecond) {
+            Instant.ofEpochSecond(epochSecond)
+        } else Instant.MAX
+        val unlockTime = UnlockTime.Timestamp(timestamp, network)
+        lockableAmounts.add(MoneroAmount(this[pos + 1]).lockedUntil(unlockTime))
+        pos += 2
+    }
+    return Balance(lockableAmounts, pendingAmount = MoneroAmount(this[0]))
+}
@@ -9,10 +9,12 @@ data class HttpRequest(
     val path: String,
     val header: String?,
     val bodyBytes: ByteArray?,
+    /** Time allowed for the whole call including retries, or zero for no limit. */
+    val timeoutMillis: Long = 0,
 ) : Parcelable {
 
     override fun toString(): String =
-        "HttpRequest(method=$method, path=$path, headers=${header?.length}, body=${bodyBytes?.size})"
+        "HttpRequest(method=$method, path=$path, headers=${header?.length}, body=${bodyBytes?.size}, timeoutMillis=$timeoutMillis)"
 
     override fun equals(other: Any?): Boolean {
         if (this === other) return true
@@ -23,6 +25,7 @@ data class HttpRequest(
         if (method != other.method) return false
         if (path != other.path) return false
         if (header != other.header) return false
+        if (timeoutMillis != other.timeoutMillis) return false
         if (bodyBytes != null) {
             if (other.bodyBytes == null) return false
             if (!bodyBytes.contentEquals(other.bodyBytes)) return false
@@ -36,6 +39,7 @@ data class HttpRequest(
         result = 31 * result + path.hashCode()
         result = 31 * result + (header?.hashCode() ?: 0)
         result = 31 * result + (bodyBytes?.contentHashCode() ?: 0)
+        result = 31 * result + timeoutMillis.hashCode()
         return result
     }
 }
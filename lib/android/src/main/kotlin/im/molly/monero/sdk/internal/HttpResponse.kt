@@ -9,8 +9,15 @@ data class HttpResponse(
     val code: Int,
     val contentType: String? = null,
     val body: ParcelFileDescriptor? = null,
+    /** Content-Encoding of [body], which is passed on still encoded. */
+    val contentEncoding: String? = null,
 ) : AutoCloseable, Parcelable {
     override fun close() {
         body?.close()
     }
+
+    companion object {
+        /** Status reported when a call does not complete before its deadline. */
+        const val CODE_TIMEOUT = 408
+    }
 }
@@ -0,0 +1,19 @@
+package im.molly.monero.sdk.internal
+
+import android.os.Parcel
+import kotlinx.parcelize.Parceler
+
+object LongRangeParceler : Parceler<LongRange?> {
+    override fun create(parcel: Parcel): LongRange? =
+        if (parcel.readInt() != 0) parcel.readLong()..parcel.readLong() else null
+
+    override fun LongRange?.write(parcel: Parcel, flags: Int) {
+        if (this == null) {
+            parcel.writeInt(0)
+        } else {
+            parcel.writeInt(1)
+            parcel.writeLong(first)
+            parcel.writeLong(last)
+        }
+    }
+}
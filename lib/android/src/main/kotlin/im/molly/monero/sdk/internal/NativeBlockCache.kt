@@ -0,0 +1,20 @@
+package im.molly.monero.sdk.internal
+
+import java.io.File
+
+/**
+ * On-disk cache of blocks fetched from remote nodes, shared by all wallets in the process.
+ *
+ * Rescans and restores of additional wallets are served from the cache instead of the network.
+ * Only wallets whose [WalletConfig.blockCache] is set use it.  The cache is not keyed by node, so
+ * those wallets share the blocks fetched from each other's nodes.
+ */
+internal object NativeBlockCache {
+    const val DEFAULT_MAX_SIZE_BYTES = 256L * 1024 * 1024
+
+    fun open(dir: File, maxSizeBytes: Long = DEFAULT_MAX_SIZE_BYTES): Boolean {
+        return nativeConfigure(dir.absolutePath, maxSizeBytes)
+    }
+
+    private external fun nativeConfigure(path: String, maxSizeBytes: Long): Boolean
+}
@@ -0,0 +1,43 @@
+package im.molly.monero.sdk.internal
+
+import android.content.res.AssetManager
+import im.molly.monero.sdk.MoneroNetwork
+import java.io.File
+import java.io.FileNotFoundException
+
+/**
+ * Block timestamp tables used to turn restore dates into heights, shared by all wallets in the
+ * process.
+ *
+ * Tables bundled in the library assets are loaded first.  Tables found in the directory are
+ * loaded on open, and updated with the timestamps seen while scanning, so that later restores
+ * from a date need not start from a conservative height.
+ */
+internal object NativeBlockTimeTable {
+    private const val ASSET_DIR = "block_times"
+
+    /**
+     * Maps the tables bundled in [assets].  They are stored uncompressed, so they can be mapped
+     * straight from the APK, also from isolated processes.
+     */
+    fun loadBundled(assets: AssetManager) {
+        for (network in MoneroNetwork.entries) {
+            val name = "$ASSET_DIR/${network.name.lowercase()}.mbtt"
+            try {
+                assets.openFd(name).use { afd ->
+                    nativeLoad(network.id, afd.parcelFileDescriptor.fd, afd.startOffset, afd.length)
+                }
+            } catch (_: FileNotFoundException) {
+                // No table bundled for this network.
+            }
+        }
+    }
+
+    fun open(dir: File): Boolean {
+        return nativeConfigure(dir.absolutePath)
+    }
+
+    private external fun nativeLoad(networkId: Int, fd: Int, offset: Long, length: Long): Boolean
+
+    private external fun nativeConfigure(path: String): Boolean
+}
@@ -0,0 +1,17 @@
+package im.molly.monero.sdk.internal
+
+/**
+ * Block hash checkpoints used to seed the hashchain of restored wallets, in addition to those
+ * built into monero.  Shared by all wallets in the process.
+ */
+internal object NativeCheckpointChain {
+    /**
+     * Maps the checkpoint file open as [fd] for [networkId], replacing any previously loaded one.
+     * The descriptor can be closed afterwards.  Returns false if the file is invalid.
+     */
+    fun load(networkId: Int, fd: Int): Boolean {
+        return nativeLoad(networkId, fd)
+    }
+
+    private external fun nativeLoad(networkId: Int, fd: Int): Boolean
+}
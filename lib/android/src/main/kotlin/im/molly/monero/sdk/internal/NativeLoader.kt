@@ -1,5 +1,7 @@
 package im.molly.monero.sdk.internal
 
+import android.os.SystemClock
+import java.io.File
 import java.util.concurrent.atomic.AtomicBoolean
 
 internal object NativeLoader {
@@ -10,8 +12,14 @@ internal object NativeLoader {
         if (wallet.getAndSet(true)) {
             return
         }
+        val rssBefore = readRssKb()
+        val startTime = SystemClock.elapsedRealtimeNanos()
         System.loadLibrary("monero_wallet")
+        val elapsedMs = (SystemClock.elapsedRealtimeNanos() - startTime) / 1_000_000.0
         nativeSetLogger(logger)
+        logger.i {
+            "Loaded monero_wallet in %.1f ms, RSS +%d kB".format(elapsedMs, readRssKb() - rssBefore)
+        }
     }
 
     fun loadMnemonicsLibrary() {
@@ -20,6 +28,16 @@ internal object NativeLoader {
         }
         System.loadLibrary("monero_mnemonics")
     }
+
+    /** Resident set size of this process, or 0 if unknown. */
+    private fun readRssKb(): Long = try {
+        File("/proc/self/status").useLines { lines ->
+            lines.firstOrNull { it.startsWith("VmRSS:") }
+                ?.split(Regex("\\s+"))?.getOrNull(1)?.toLongOrNull()
+        } ?: 0
+    } catch (e: Exception) {
+        0
+    }
 }
 
 private external fun nativeSetLogger(logger: Logger)
@@ -0,0 +1,15 @@
+package im.molly.monero.sdk.internal
+
+/**
+ * Times the acquisitions of the native wallet locks, per call site, for [NativeWallet.dumpStats].
+ *
+ * Off by default.  With a sample period of N, one acquisition in N is timed on each thread.
+ */
+internal object NativeLockProfiler {
+    fun setSamplePeriod(period: Int) {
+        require(period >= 0)
+        nativeSetSamplePeriod(period)
+    }
+
+    private external fun nativeSetSamplePeriod(period: Int)
+}
@@ -0,0 +1,29 @@
+package im.molly.monero.sdk.internal
+
+import java.io.File
+
+/**
+ * Records the node calls of all wallets in the process to a trace file, or replays one.
+ *
+ * While replaying, wallets created from then on are answered from the trace, keyed by method,
+ * URI and request body, and never reach the network.  A recorded restore and sync can then be
+ * run again offline, with identical inputs, to benchmark or check changes to the scanner.
+ *
+ * Traces are sensitive.  Authorization and cookie headers are left out, but request and
+ * response bodies are stored verbatim, including wallet addresses and the outputs they asked
+ * about.  Keep trace files out of shared storage and bug reports.
+ *
+ * Only debug builds of the native library, configured with WALLET_TEST_NODES, have it.
+ */
+internal object NativeRpcTrace {
+    fun startRecording(file: File): Boolean = nativeStartRecording(file.absolutePath)
+
+    fun startReplay(file: File): Boolean = nativeStartReplay(file.absolutePath)
+
+    /** Ends recording or replay.  Returns false if the recorded trace could not be completed. */
+    fun stop(): Boolean = nativeStop()
+
+    private external fun nativeStartRecording(path: String): Boolean
+    private external fun nativeStartReplay(path: String): Boolean
+    private external fun nativeStop(): Boolean
+}
@@ -0,0 +1,67 @@
+package im.molly.monero.sdk.internal
+
+import im.molly.monero.sdk.SecretKey
+
+/**
+ * Stand-in node serving a generated chain to all wallets in the process, for load tests.
+ *
+ * Blocks pay a share of their outputs to the given address and its subaddresses, derived with
+ * the view key, and can be reorganized at will.  While a chain is served, wallets created from
+ * then on scan it instead of reaching the network.
+ *
+ * Only debug builds of the native library, configured with WALLET_TEST_NODES, have it.
+ */
+internal object NativeSyntheticChain {
+    data class Params(
+        val seed: Long = 0,
+        val blocks: Long = 1000,
+        val txsPerBlock: Int = 4,
+        val outputsPerTx: Int = 2,
+        /** Outputs paying the wallet, per thousand. */
+        val ownedPerMille: Int = 500,
+        val accounts: Int = 1,
+        val subAddressesPerAccount: Int = 1,
+        val minAmount: Long = 1_000_000,
+        val maxAmount: Long = 1_000_000_000_000,
+    )
+
+    data class Stats(
+        val height: Long,
+        val ownedOutputs: Long,
+        val ownedAmount: Long,
+    )
+
+    fun serve(networkId: Int, publicAddress: String, viewSecretKey: SecretKey, params: Params): Boolean =
+        with(params) {
+            nativeServe(
+                networkId, publicAddress, viewSecretKey.bytes, seed, blocks, txsPerBlock,
+                outputsPerTx, ownedPerMille, accounts, subAddressesPerAccount, minAmount, maxAmount,
+            )
+        }
+
+    /** Replaces the top [depth] blocks with a new branch of [newBlocks] blocks. */
+    fun reorg(depth: Long, newBlocks: Long) = nativeReorg(depth, newBlocks)
+
+    fun getStats(): Stats = nativeGetStats().let { Stats(it[0], it[1], it[2]) }
+
+    fun stop() = nativeStop()
+
+    private external fun nativeServe(
+        networkId: Int,
+        publicAddress: String,
+        viewSecretKey: ByteArray,
+        seed: Long,
+        blocks: Long,
+        txsPerBlock: Int,
+        outputsPerTx: Int,
+        ownedPerMille: Int,
+        accounts: Int,
+        subAddressesPerAccount: Int,
+        minAmount: Long,
+        maxAmount: Long,
+    ): Boolean
+
+    private external fun nativeReorg(depth: Long, newBlocks: Long)
+    private external fun nativeGetStats(): LongArray
+    private external fun nativeStop()
+}
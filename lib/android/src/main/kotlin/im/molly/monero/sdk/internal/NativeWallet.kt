@@ -1,8 +1,11 @@
 package im.molly.monero.sdk.internal
 
+import android.os.IBinder
 import android.os.ParcelFileDescriptor
 import androidx.annotation.GuardedBy
+import im.molly.monero.sdk.Balance
 import im.molly.monero.sdk.BlockchainTime
+import im.molly.monero.sdk.HistoryQuery
 import im.molly.monero.sdk.Ledger
 import im.molly.monero.sdk.MoneroNetwork
 import im.molly.monero.sdk.PaymentRequest
@@ -14,6 +17,7 @@ import im.molly.monero.sdk.parseAndAggregateAddresses
 import kotlinx.coroutines.*
 import java.io.Closeable
 import java.time.Instant
+import java.util.WeakHashMap
 import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicInteger
 import java.util.concurrent.locks.ReentrantLock
@@ -34,6 +38,8 @@ internal class NativeWallet private constructor(
             walletDataFd: ParcelFileDescriptor? = null,
             secretSpendKey: SecretKey? = null,
             restorePoint: Long? = null,
+            compactTransfers: Boolean = false,
+            blockCache: Boolean = false,
             coroutineContext: CoroutineContext = Dispatchers.Default + SupervisorJob(),
             ioDispatcher: CoroutineDispatcher = Dispatchers.IO,
         ) = NativeWallet(
@@ -51,6 +57,13 @@ internal class NativeWallet private constructor(
                 requireNotNull(walletDataFd)
                 restoreFromStorage(walletDataFd)
             }
+            // Wallets saved in compact mode stay compact regardless.
+            if (compactTransfers) {
+                nativeEnableCompactTransfers(handle)
+            }
+            if (blockCache) {
+                nativeEnableBlockCache(handle)
+            }
         }
 
         private fun NativeWallet.restoreFromKey(secretSpendKey: SecretKey, restorePoint: Long) {
@@ -61,6 +74,26 @@ internal class NativeWallet private constructor(
             val loaded = nativeLoad(handle, walletDataFd.fd)
             check(loaded)
         }
+
+        @GuardedBy("rpcClientIds")
+        private val rpcClientIds = WeakHashMap<IBinder, Long>()
+
+        @GuardedBy("rpcClientIds")
+        private var nextRpcClientId = 1L
+
+        /**
+         * Numbers the RPC clients wallets are created with.  Wallets with the same client reach the
+         * same nodes, and native code only shares block responses between those.  Binder proxies
+         * of the same remote client are the same object in a process.
+         */
+        private fun rpcClientIdOf(rpcClient: IHttpRpcClient?): Long {
+            if (rpcClient == null) {
+                return 0
+            }
+            return synchronized(rpcClientIds) {
+                rpcClientIds.getOrPut(rpcClient.asBinder()) { nextRpcClientId++ }
+            }
+        }
     }
 
     private val logger = loggerFor<NativeWallet>()
@@ -69,7 +102,7 @@ internal class NativeWallet private constructor(
         NativeLoader.loadWalletLibrary(logger = logger)
     }
 
-    private val handle: Long = nativeCreate(network.id)
+    private val handle: Long = nativeCreate(network.id, rpcClientIdOf(rpcClient))
 
     override fun getPublicAddress(): String = nativeGetPublicAddress(handle)
 
@@ -96,6 +129,24 @@ internal class NativeWallet private constructor(
         )
     }
 
+    /**
+     * Returns the balance of a sub-address, an account, or the whole wallet from the native
+     * aggregates, without exporting the transaction history.
+     */
+    fun getBalance(accountIndex: Int? = null, subAddressIndex: Int? = null): Balance {
+        require(subAddressIndex == null || accountIndex != null)
+        return getBalanceBuckets(accountIndex ?: -1, subAddressIndex ?: -1).toBalance(network)
+    }
+
+    override fun getBalanceBuckets(accountIndex: Int, subAddressIndex: Int): LongArray =
+        nativeGetBalance(handle, accountIndex, subAddressIndex)
+
+    /**
+     * Returns the native counters of this wallet, and the lock profile of the process (see
+     * [NativeLockProfiler]), as "name value" lines.
+     */
+    fun dumpStats(): String = nativeDumpStats(handle)
+
     private fun MoneroNetwork.blockchainTime(height: Int, epochSecond: Long): BlockchainTime {
         // Block timestamp could be zero during a fast refresh.
         val timestamp = when (epochSecond) {
@@ -109,36 +160,119 @@ internal class NativeWallet private constructor(
         return nativeGetSubAddresses(accountIndex ?: -1, handle)
     }
 
-    private fun getTxHistorySnapshot(): List<TxInfo> {
-        return nativeGetTxHistory(handle).toList()
+    /**
+     * History entries at [replacedFromHeight] and above, replacing those of an earlier export.
+     * Unconfirmed entries count as being at [Long.MAX_VALUE].
+     */
+    private class TxHistoryChanges(
+        val txs: List<TxInfo>,
+        val generation: Long,
+        val replacedFromHeight: Long,
+    )
+
+    /**
+     * Returns the history entries that changed since the export of [generation], or null if
+     * none did.  Generation 0 exports the whole history.
+     */
+    private fun getTxHistoryChangesSince(generation: Long): TxHistoryChanges? {
+        val out = LongArray(2)
+        val txs = nativeGetTxHistoryChanges(handle, generation, out) ?: return null
+        return TxHistoryChanges(txs.toList(), generation = out[0], replacedFromHeight = out[1])
+    }
+
+    internal fun getTxHistorySnapshot(): List<TxInfo> {
+        return getTxHistoryChangesSince(0)?.txs ?: emptyList()
     }
 
-    @GuardedBy("listenersLock")
+    /**
+     * Returns up to [limit] history entries matching [query], starting at [cursor], without
+     * exporting the whole history.  Returns null if the history was updated since [cursor]
+     * was handed out; the query must then restart from [TxHistoryPage.CURSOR_START].
+     */
+    override fun queryTxHistory(
+        query: HistoryQuery,
+        cursor: Long,
+        limit: Int,
+    ): TxHistoryPage? {
+        require(limit > 0)
+        val nextCursor = longArrayOf(TxHistoryPage.CURSOR_END)
+        val txs = nativeQueryTxHistory(
+            handle = handle,
+            accountIndex = query.accountIndex ?: -1,
+            subAddressIndex = query.subAddressIndex ?: -1,
+            direction = query.incoming?.let { if (it) 0 else 1 } ?: -1,
+            stateMask = query.stateMask,
+            minHeight = query.heightRange?.first ?: 0,
+            maxHeight = query.heightRange?.last ?: -1,
+            minTimestamp = query.timestampRange?.first ?: 0,
+            maxTimestamp = query.timestampRange?.last ?: -1,
+            order = query.order.ordinal,
+            cursor = cursor,
+            limit = limit,
+            nextCursor = nextCursor,
+        ) ?: return null
+        return TxHistoryPage(
+            txs = txs.toList(),
+            nextCursor = nextCursor[0].takeIf { it != TxHistoryPage.CURSOR_END },
+        )
+    }
+
+    @GuardedBy("balanceListenersLock")
     private val balanceListeners = mutableSetOf<IBalanceListener>()
 
+    /** History generation that every balance listener has, or is ahead of. */
+    @GuardedBy("balanceListenersLock")
+    private var notifiedTxHistoryGeneration = 0L
+
     private val balanceListenersLock = ReentrantLock()
 
     @OptIn(ExperimentalCoroutinesApi::class)
     private val singleThreadedDispatcher = ioDispatcher.limitedParallelism(1)
 
+    @GuardedBy("refreshWaitersLock")
+    private val refreshWaiters = mutableListOf<CancellableContinuation<Int>>()
+
+    private val refreshWaitersLock = ReentrantLock()
+
+    /**
+     * Refresh runs on the native scheduler's thread pool.  Calls made while a refresh is in
+     * progress share its result.  Cancelling one call only cancels the refresh if no other call
+     * is waiting for it.
+     */
     @OptIn(ExperimentalCoroutinesApi::class)
     override fun resumeRefresh(
         skipCoinbase: Boolean,
+        background: Boolean,
         callback: IWalletCallbacks?,
     ) {
         scope.launch {
             val status = suspendCancellableCoroutine { continuation ->
-                launch(singleThreadedDispatcher) {
-                    continuation.resume(nativeNonReentrantRefresh(handle, skipCoinbase)) {}
+                refreshWaitersLock.withLock {
+                    refreshWaiters.add(continuation)
                 }
+                nativeScheduleRefresh(handle, skipCoinbase, background)
                 continuation.invokeOnCancellation {
-                    nativeCancelRefresh(handle)
+                    val lastWaiter = refreshWaitersLock.withLock {
+                        refreshWaiters.remove(continuation) && refreshWaiters.isEmpty()
+                    }
+                    if (lastWaiter) {
+                        nativeCancelRefresh(handle)
+                    }
                 }
             }
             callback?.onRefreshResult(getCurrentBlockchainTime(), status)
         }
     }
 
+    @OptIn(ExperimentalCoroutinesApi::class)
+    @CalledByNative
+    private fun onRefreshResult(status: Int) {
+        val waiters = refreshWaitersLock.withLock {
+            refreshWaiters.toList().also { refreshWaiters.clear() }
+        }
+        waiters.forEach { it.resume(status) {} }
+    }
+
     override fun cancelRefresh() {
         scope.launch(ioDispatcher) {
             nativeCancelRefresh(handle)
@@ -245,13 +379,19 @@ internal class NativeWallet private constructor(
      * Also replays the last known balance whenever a new listener registers.
      */
     override fun addBalanceListener(listener: IBalanceListener) {
-        val txHistory = getTxHistorySnapshot()
         val subAddresses = getSubAddresses()
         val blockchainTime = getCurrentBlockchainTime()
 
         balanceListenersLock.withLock {
+            val txHistory = getTxHistoryChangesSince(0)
+            // Changes since an older generation also apply on top of a newer one.
+            if (balanceListeners.isEmpty()) {
+                notifiedTxHistoryGeneration = txHistory?.generation ?: 0
+            }
             balanceListeners.add(listener)
-            notifyBalanceInBatchesUnlock(listener, txHistory, subAddresses, blockchainTime)
+            notifyBalanceInBatchesUnlock(
+                listener, txHistory?.txs ?: emptyList(), 0, subAddresses, blockchainTime,
+            )
         }
     }
 
@@ -293,11 +433,14 @@ internal class NativeWallet private constructor(
     private fun notifyBalanceInBatchesUnlock(
         listener: IBalanceListener,
         txList: List<TxInfo>,
+        replacedFromHeight: Long,
         subAddresses: Array<String>,
         blockchainTime: BlockchainTime,
     ) {
         if (txList.isEmpty()) {
-            listener.onBalanceUpdateFinalized(emptyList(), subAddresses, blockchainTime)
+            listener.onBalanceUpdateFinalized(
+                emptyList(), replacedFromHeight, subAddresses, blockchainTime,
+            )
             return
         }
 
@@ -309,7 +452,9 @@ internal class NativeWallet private constructor(
             if (chunkedSeq.hasNext()) {
                 listener.onBalanceUpdateChunk(chunk)
             } else {
-                listener.onBalanceUpdateFinalized(chunk, subAddresses, blockchainTime)
+                listener.onBalanceUpdateFinalized(
+                    chunk, replacedFromHeight, subAddresses, blockchainTime,
+                )
             }
         }
     }
@@ -343,16 +488,31 @@ internal class NativeWallet private constructor(
         }
     }
 
+    /**
+     * Sends listeners only the history entries that changed since they were last notified.
+     */
     @CalledByNative
     private fun onRefresh(height: Int, timestamp: Long, balanceChanged: Boolean) {
         balanceListenersLock.withLock {
             if (balanceListeners.isNotEmpty()) {
                 val blockchainTime = network.blockchainTime(height, timestamp)
-                val call = if (balanceChanged) {
-                    val txList = getTxHistorySnapshot()
+                val changes =
+                    if (balanceChanged) getTxHistoryChangesSince(notifiedTxHistoryGeneration)
+                    else null
+                val call = if (changes != null) {
+                    notifiedTxHistoryGeneration = changes.generation
+                    val subAddresses = getSubAddresses()
+                    fun(listener: IBalanceListener) {
+                        notifyBalanceInBatchesUnlock(
+                            listener, changes.txs, changes.replacedFromHeight, subAddresses,
+                            blockchainTime,
+                        )
+                    }
+                } else if (balanceChanged) {
                     val subAddresses = getSubAddresses()
                     fun(listener: IBalanceListener) {
-                        notifyBalanceInBatchesUnlock(listener, txList, subAddresses, blockchainTime)
+                        listener.onSubAddressListUpdated(subAddresses)
+                        listener.onWalletRefreshed(blockchainTime)
                     }
                 } else {
                     fun(listener: IBalanceListener) {
@@ -386,6 +546,10 @@ internal class NativeWallet private constructor(
     /**
      * Invoked by native code to make a cancellable remote call to a remote node.
      *
+     * The call is abandoned after [timeoutMillis], or never if zero, and reported with
+     * [HttpResponse.CODE_TIMEOUT].  The deadline is also passed on to the RPC client so that
+     * it stops retrying.
+     *
      * Caller must close [HttpResponse.body] upon completion of processing the response.
      */
     @CalledByNative
@@ -394,19 +558,31 @@ internal class NativeWallet private constructor(
         path: String,
         header: String?,
         body: ByteArray?,
+        timeoutMillis: Long,
     ): HttpResponse? = runBlocking {
         pendingRequestLock.withLock {
             if (!requestsAllowed) {
                 return@runBlocking null
             }
-            val httpRequest = HttpRequest(method, path, header, body)
+            val httpRequest = HttpRequest(method, path, header, body, timeoutMillis)
             pendingRequest = async {
                 rpcClient?.newCall(httpRequest)
             }
         }
         try {
             runCatching {
-                pendingRequest?.await()
+                if (timeoutMillis > 0) {
+                    try {
+                        withTimeout(timeoutMillis) {
+                            pendingRequest?.await()
+                        }
+                    } catch (e: TimeoutCancellationException) {
+                        pendingRequest?.cancel()
+                        HttpResponse(code = HttpResponse.CODE_TIMEOUT)
+                    }
+                } else {
+                    pendingRequest?.await()
+                }
             }.onFailure { throwable ->
                 if (throwable is CancellationException) {
                     return@onFailure
@@ -460,6 +636,7 @@ internal class NativeWallet private constructor(
         const val INTERRUPTED: Int = 1
         const val NO_NETWORK_CONNECTIVITY: Int = 2
         const val REFRESH_ERROR: Int = 3
+        const val TIMEOUT: Int = 4
     }
 
     private external fun nativeAddDetachedSubAddress(
@@ -469,7 +646,7 @@ internal class NativeWallet private constructor(
     ): String
 
     private external fun nativeCancelRefresh(handle: Long)
-    private external fun nativeCreate(networkId: Int): Long
+    private external fun nativeCreate(networkId: Int, rpcClientId: Long): Long
     private external fun nativeCreatePayment(
         handle: Long,
         addresses: Array<String>,
@@ -489,6 +666,9 @@ internal class NativeWallet private constructor(
     private external fun nativeCreateSubAddressAccount(handle: Long): String
     private external fun nativeCreateSubAddress(handle: Long, subAddressMajor: Int): String?
     private external fun nativeDispose(handle: Long)
+    private external fun nativeDumpStats(handle: Long): String
+    private external fun nativeEnableCompactTransfers(handle: Long)
+    private external fun nativeEnableBlockCache(handle: Long)
     private external fun nativeGetPublicAddress(handle: Long): String
     private external fun nativeGetSpendSecretKey(handle: Long): ByteArray
     private external fun nativeGetViewSecretKey(handle: Long): ByteArray
@@ -499,14 +679,42 @@ internal class NativeWallet private constructor(
         handle: Long,
     ): Array<String>
 
-    private external fun nativeGetTxHistory(handle: Long): Array<TxInfo>
+    private external fun nativeGetBalance(
+        handle: Long,
+        accountIndex: Int,
+        subAddressIndex: Int,
+    ): LongArray
+    private external fun nativeGetTxHistoryChanges(
+        handle: Long,
+        sinceGeneration: Long,
+        out: LongArray,
+    ): Array<TxInfo>?
+    private external fun nativeQueryTxHistory(
+        handle: Long,
+        accountIndex: Int,
+        subAddressIndex: Int,
+        direction: Int,
+        stateMask: Int,
+        minHeight: Long,
+        maxHeight: Long,
+        minTimestamp: Long,
+        maxTimestamp: Long,
+        order: Int,
+        cursor: Long,
+        limit: Int,
+        nextCursor: LongArray,
+    ): Array<TxInfo>?
     private external fun nativeFetchBaseFeeEstimate(handle: Long): LongArray
     private external fun nativeLoad(handle: Long, fd: Int): Boolean
-    private external fun nativeNonReentrantRefresh(handle: Long, skipCoinbase: Boolean): Int
     private external fun nativeRestoreAccount(
         handle: Long, secretScalar: ByteArray, restorePoint: Long
     )
 
     private external fun nativeSave(handle: Long, fd: Int): Boolean
+    private external fun nativeScheduleRefresh(
+        handle: Long,
+        skipCoinbase: Boolean,
+        background: Boolean,
+    )
     private external fun nativeSetRefreshSince(handle: Long, heightOrTimestamp: Long)
 }
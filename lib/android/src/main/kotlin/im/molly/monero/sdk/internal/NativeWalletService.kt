@@ -8,6 +8,7 @@ import im.molly.monero.sdk.isIsolatedProcess
 import im.molly.monero.sdk.randomSecretKey
 import im.molly.monero.sdk.setLoggingAdapter
 import kotlinx.coroutines.CoroutineScope
+import java.io.File
 
 internal class NativeWalletService(
     private val service: Service,
@@ -18,19 +19,43 @@ internal class NativeWalletService(
 
     init {
         NativeLoader.loadWalletLibrary(logger = logger)
+        NativeBlockTimeTable.loadBundled(service.assets)
         if (isServiceIsolated) {
             setLoggingAdapter(this)
+        } else {
+            // Isolated processes have no writable storage to keep the samples learned
+            // on top of the bundled tables.
+            if (!NativeBlockTimeTable.open(File(service.filesDir, "monero_block_times"))) {
+                logger.w("Block time table unavailable")
+            }
         }
     }
 
     private var listener: IWalletServiceListener? = null
 
+    /** Opened on first use by a wallet whose config enables it. */
+    private val blockCacheOpened: Boolean by lazy {
+        // Isolated processes have no writable storage for the block cache.
+        if (isServiceIsolated) {
+            return@lazy false
+        }
+        NativeBlockCache.open(File(service.cacheDir, "monero_blocks")).also { opened ->
+            if (!opened) {
+                logger.w("Block cache unavailable")
+            }
+        }
+    }
+
     override fun setListener(l: IWalletServiceListener) {
         listener = l
     }
 
     override fun isServiceIsolated(): Boolean = service.application.isIsolatedProcess()
 
+    override fun loadCheckpoints(networkId: Int, checkpointsFd: ParcelFileDescriptor): Boolean {
+        return checkpointsFd.use { NativeCheckpointChain.load(networkId, it.fd) }
+    }
+
     override fun createWallet(
         config: WalletConfig,
         rpcClient: IHttpRpcClient?,
@@ -71,6 +96,8 @@ internal class NativeWalletService(
                 networkId = config.networkId,
                 rpcClient = rpcClient,
                 walletDataFd = inputFd,
+                compactTransfers = config.compactTransfers,
+                blockCache = config.blockCache && blockCacheOpened,
                 coroutineContext = serviceScope.coroutineContext,
             )
         }
@@ -88,6 +115,8 @@ internal class NativeWalletService(
             rpcClient = rpcClient,
             secretSpendKey = secretSpendKey,
             restorePoint = restorePoint,
+            compactTransfers = config.compactTransfers,
+            blockCache = config.blockCache && blockCacheOpened,
             coroutineContext = serviceScope.coroutineContext,
         )
     }
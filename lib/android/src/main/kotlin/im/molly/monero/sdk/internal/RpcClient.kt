@@ -8,8 +8,11 @@ import im.molly.monero.sdk.loadbalancer.Rule
 import kotlinx.coroutines.CancellationException
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Job
+import kotlinx.coroutines.TimeoutCancellationException
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.suspendCancellableCoroutine
+import kotlinx.coroutines.withTimeout
 import okhttp3.Call
 import okhttp3.Callback
 import okhttp3.Headers
@@ -23,9 +26,7 @@ import okhttp3.Response
 import java.io.FileOutputStream
 import java.io.IOException
 import java.util.concurrent.ConcurrentHashMap
-import kotlin.coroutines.resume
 import kotlin.coroutines.resumeWithException
-import kotlin.coroutines.suspendCoroutine
 
 class RpcClient internal constructor(
     private val loadBalancer: LoadBalancer,
@@ -44,7 +45,13 @@ class RpcClient internal constructor(
 
         val requestJob = requestsScope.launch {
             runCatching {
-                requestWithRetry(request, callId)
+                if (request.timeoutMillis > 0) {
+                    withTimeout(request.timeoutMillis) {
+                        requestWithRetry(request, callId)
+                    }
+                } else {
+                    requestWithRetry(request, callId)
+                }
             }.onSuccess { response ->
                 val status = response.code
                 val responseBody = response.body
@@ -55,6 +62,7 @@ class RpcClient internal constructor(
                 } else {
                     responseBody.use { body ->
                         val contentType = body.contentType()?.toString()
+                        val contentEncoding = response.header("Content-Encoding")
                         val pipe = ParcelFileDescriptor.createPipe()
                         pipe[0].use { readSize ->
                             pipe[1].use { writeSide ->
@@ -62,6 +70,7 @@ class RpcClient internal constructor(
                                     code = status,
                                     contentType = contentType,
                                     body = readSize,
+                                    contentEncoding = contentEncoding,
                                 )
                                 callback.onResponse(httpResponse)
                                 FileOutputStream(writeSide.fileDescriptor).use { out ->
@@ -74,6 +83,11 @@ class RpcClient internal constructor(
                 // TODO: Log response times
             }.onFailure { throwable ->
                 when (throwable) {
+                    is TimeoutCancellationException -> {
+                        logger.w("[$callId] Timed out after ${request.timeoutMillis} ms: $request")
+                        callback.onResponse(HttpResponse(code = HttpResponse.CODE_TIMEOUT))
+                    }
+
                     is CancellationException -> callback.onRequestCanceled()
                     else -> {
                         logger.e("[$callId] Failed to dispatch $request", throwable)
@@ -100,6 +114,9 @@ class RpcClient internal constructor(
         val contentType = headers["Content-Type"]?.toMediaType()
         // TODO: Log unsupported headers
         val requestBuilder = createRequestBuilder(request, contentType)
+        // Setting Accept-Encoding turns off OkHttp's transparent gzip, so compressed
+        // bodies are piped as they are and decoded on the native side.
+        headers["Accept-Encoding"]?.let { requestBuilder.header("Accept-Encoding", it) }
 
         val attempts = mutableMapOf<Uri, Int>()
 
@@ -167,16 +184,24 @@ class RpcClient internal constructor(
         }
     }
 
-    private suspend fun Call.await() = suspendCoroutine { continuation ->
+    /**
+     * Cancelling the coroutine aborts the HTTP call, so that deadlines and stopped refreshes
+     * do not leave connections hanging. A response that races with the cancellation is closed
+     * instead of being dropped with its connection still leased.
+     */
+    private suspend fun Call.await() = suspendCancellableCoroutine { continuation ->
         enqueue(object : Callback {
             override fun onResponse(call: Call, response: Response) {
-                continuation.resume(response)
+                continuation.resume(response) { response.close() }
             }
 
             override fun onFailure(call: Call, e: IOException) {
                 continuation.resumeWithException(e)
             }
         })
+        continuation.invokeOnCancellation {
+            cancel()
+        }
     }
 
 //    private val Response.roundTripMillis: Long
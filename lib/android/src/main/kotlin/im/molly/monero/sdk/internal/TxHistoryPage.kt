@@ -0,0 +1,19 @@
+package im.molly.monero.sdk.internal
+
+import android.os.Parcelable
+import kotlinx.parcelize.Parcelize
+
+/**
+ * A page of [TxInfo] entries.  [nextCursor] resumes the query, or is null once all
+ * matching entries were returned.
+ */
+@Parcelize
+internal class TxHistoryPage(
+    val txs: List<TxInfo>,
+    val nextCursor: Long?,
+) : Parcelable {
+    companion object {
+        const val CURSOR_START = 0L
+        const val CURSOR_END = -1L
+    }
+}
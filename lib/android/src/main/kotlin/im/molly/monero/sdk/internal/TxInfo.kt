@@ -6,6 +6,7 @@ import im.molly.monero.sdk.BlockchainTime
 import im.molly.monero.sdk.Enote
 import im.molly.monero.sdk.EnoteOrigin
 import im.molly.monero.sdk.HashDigest
+import im.molly.monero.sdk.HistoryEntry
 import im.molly.monero.sdk.MoneroAmount
 import im.molly.monero.sdk.PaymentDetail
 import im.molly.monero.sdk.PublicAddress
@@ -64,6 +65,33 @@ internal data class TxInfo @CalledByNative constructor(
     }
 }
 
+/**
+ * Applies an incremental history export to this one: keeps the confirmed entries below
+ * [height] and appends [changes], which hold every entry from [height] up, unconfirmed last.
+ */
+internal fun List<TxInfo>.replaceFrom(height: Long, changes: List<TxInfo>): List<TxInfo> =
+    filter { it.height != 0 && it.height < height } + changes
+
+internal fun TxInfo.toHistoryEntry(): HistoryEntry {
+    return HistoryEntry(
+        txId = txHash,
+        state = when (state) {
+            TxInfo.STATE_OFF_CHAIN -> TxState.OffChain
+            TxInfo.STATE_PENDING -> TxState.InMemoryPool
+            TxInfo.STATE_FAILED -> TxState.Failed
+            TxInfo.STATE_ON_CHAIN -> TxState.OnChain(BlockHeader(height, timestamp))
+            else -> error("Invalid tx state value: $state")
+        },
+        incoming = incoming,
+        amount = MoneroAmount(atomicUnits = amount),
+        accountIndex = subAddressMajor.takeIf { incoming },
+        subAddressIndex = subAddressMinor.takeIf { incoming },
+        recipient = recipient?.let { PublicAddress.parse(it) },
+        keyImage = keyImage?.let { HashDigest(it) },
+        fee = MoneroAmount(atomicUnits = fee),
+    )
+}
+
 internal fun List<TxInfo>.consolidateTransactions(
     accounts: List<WalletAccount>,
     blockchainContext: BlockchainTime,
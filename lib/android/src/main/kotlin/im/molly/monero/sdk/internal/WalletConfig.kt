@@ -6,4 +6,7 @@ import kotlinx.parcelize.Parcelize
 @Parcelize
 internal data class WalletConfig(
     val networkId: Int,
+    val compactTransfers: Boolean = false,
+    /** Serve block requests from the on-disk [NativeBlockCache] shared with other wallets. */
+    val blockCache: Boolean = false,
 ) : Parcelable
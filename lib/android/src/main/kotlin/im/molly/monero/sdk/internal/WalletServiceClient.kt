@@ -5,6 +5,7 @@ import android.content.Context
 import android.content.Intent
 import android.content.ServiceConnection
 import android.os.IBinder
+import android.os.ParcelFileDescriptor
 import androidx.annotation.VisibleForTesting
 import im.molly.monero.sdk.BlockchainTime
 import im.molly.monero.sdk.MoneroNetwork
@@ -17,8 +18,11 @@ import im.molly.monero.sdk.WalletProvider
 import im.molly.monero.sdk.service.BaseWalletService
 import kotlinx.coroutines.CancellableContinuation
 import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.ExperimentalCoroutinesApi
 import kotlinx.coroutines.suspendCancellableCoroutine
+import kotlinx.coroutines.withContext
+import java.io.File
 
 internal class WalletServiceClient(
     private val context: Context,
@@ -125,6 +129,13 @@ internal class WalletServiceClient(
         }
     }
 
+    override suspend fun loadCheckpoints(network: MoneroNetwork, checkpoints: File): Boolean =
+        withContext(Dispatchers.IO) {
+            ParcelFileDescriptor.open(checkpoints, ParcelFileDescriptor.MODE_READ_ONLY).use { fd ->
+                service.loadCheckpoints(network.id, fd)
+            }
+        }
+
     private fun buildConfig(network: MoneroNetwork): WalletConfig {
         return WalletConfig(network.id)
     }
@@ -0,0 +1,174 @@
+// Test of the C API of the wallet core, through the shared library hosts
+// link against.  The node is unreachable: every transport call fails, so
+// refreshes end without a block and payments cannot be built.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "wallet/monero_wallet_core.h"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                          \
+  do {                                                       \
+    if (!(cond)) {                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n",           \
+              __FILE__, __LINE__, #cond);                    \
+      ++failures;                                            \
+    }                                                        \
+  } while (0)
+
+struct Node {
+  std::atomic<int> calls{0};
+};
+
+int UnreachableTransport(void* user_data,
+                         const char* method,
+                         const char* uri,
+                         const char* headers,
+                         const uint8_t* body,
+                         size_t body_size,
+                         int64_t timeout_ms,
+                         monero_http_response* response) {
+  static_cast<Node*>(user_data)->calls++;
+  return 0;
+}
+
+struct RefreshResult {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+  int status = -1;
+};
+
+void OnRefreshResult(void* user_data, int status) {
+  auto* result = static_cast<RefreshResult*>(user_data);
+  std::lock_guard<std::mutex> lock(result->mutex);
+  result->done = true;
+  result->status = status;
+  result->cond.notify_all();
+}
+
+std::string PublicAddress(const monero_wallet* wallet) {
+  char buf[128];
+  size_t size = monero_wallet_public_address(wallet, buf, sizeof(buf));
+  return std::string(buf, std::min(size, sizeof(buf) - 1));
+}
+
+// Returns an open fd to an empty file, removed from the directory already.
+int TempFile() {
+  char path[] = "/tmp/monero_wallet_core_test.XXXXXX";
+  int fd = mkstemp(path);
+  if (fd >= 0) {
+    unlink(path);
+  }
+  return fd;
+}
+
+void TestRestoreAndQuery(monero_wallet* wallet) {
+  uint8_t secret_spend_key[32] = {1};
+  CHECK(monero_wallet_restore(wallet, secret_spend_key, 0) == 1);
+
+  const std::string address = PublicAddress(wallet);
+  CHECK(address.size() == 95);
+  CHECK(address[0] == '4');
+  CHECK(monero_wallet_height(wallet) >= 1);
+
+  uint64_t unlocked = 1, pending = 1, locked = 1;
+  CHECK(monero_wallet_balance(wallet, -1, -1, &unlocked, &pending, &locked) == 1);
+  CHECK(unlocked == 0 && pending == 0 && locked == 0);
+
+  monero_tx_info info;
+  CHECK(monero_wallet_tx_history(wallet, &info, 1) == 0);
+
+  monero_tx_query query;
+  monero_tx_query_init(&query);
+  uint64_t next_cursor = 0;
+  CHECK(monero_wallet_query_tx_history(
+      wallet, &query, MONERO_TX_CURSOR_START, &info, 1, &next_cursor) == 0);
+  CHECK(next_cursor == MONERO_TX_CURSOR_END);
+}
+
+void TestCreatePaymentFails(monero_wallet* wallet) {
+  const char* addresses[] = {"not an address"};
+  const uint64_t amounts[] = {1000000};
+  char error[256] = "";
+  monero_pending_transfer* transfer = monero_wallet_create_payment(
+      wallet, addresses, amounts, 1, 0, 0, error, sizeof(error));
+  CHECK(transfer == nullptr);
+  CHECK(strlen(error) > 0);
+}
+
+void TestSaveAndLoad(monero_wallet* wallet, Node* node) {
+  int fd = TempFile();
+  CHECK(fd >= 0);
+  CHECK(monero_wallet_save(wallet, fd) == 1);
+  CHECK(lseek(fd, 0, SEEK_SET) == 0);
+
+  monero_wallet* loaded = monero_wallet_create(
+      MONERO_MAINNET, UnreachableTransport, node, nullptr);
+  CHECK(monero_wallet_load(loaded, fd) == 1);
+  CHECK(PublicAddress(loaded) == PublicAddress(wallet));
+  monero_wallet_destroy(loaded);
+  close(fd);
+
+  // Neither garbage nor a closed fd may throw across the API.
+  fd = TempFile();
+  CHECK(write(fd, "garbage", 7) == 7);
+  CHECK(lseek(fd, 0, SEEK_SET) == 0);
+  monero_wallet* corrupt = monero_wallet_create(
+      MONERO_MAINNET, UnreachableTransport, node, nullptr);
+  CHECK(monero_wallet_load(corrupt, fd) == 0);
+  close(fd);
+  CHECK(monero_wallet_load(corrupt, fd) == 0);
+  monero_wallet_destroy(corrupt);
+}
+
+void TestRefreshWithoutNode(monero_wallet* wallet, Node* node, RefreshResult* result) {
+  CHECK(monero_wallet_refresh(wallet, 1, 0) == 1);
+  std::unique_lock<std::mutex> lock(result->mutex);
+  CHECK(result->cond.wait_for(lock, std::chrono::seconds(60),
+                              [&] { return result->done; }));
+  CHECK(result->status != MONERO_REFRESH_OK);
+  CHECK(node->calls.load() > 0);
+}
+
+}  // namespace
+
+int main() {
+  Node node;
+  RefreshResult result;
+  monero_wallet_callbacks callbacks;
+  memset(&callbacks, 0, sizeof(callbacks));
+  callbacks.user_data = &result;
+  callbacks.on_refresh_result = OnRefreshResult;
+
+  monero_wallet* wallet = monero_wallet_create(
+      MONERO_MAINNET, UnreachableTransport, &node, &callbacks);
+  CHECK(wallet != nullptr);
+
+  TestRestoreAndQuery(wallet);
+  TestCreatePaymentFails(wallet);
+  TestSaveAndLoad(wallet, &node);
+  TestRefreshWithoutNode(wallet, &node, &result);
+
+  monero_wallet_destroy(wallet);
+
+  if (failures > 0) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,156 @@
+// Memory benchmark of TxHistory against the std::vector<TxInfo> it
+// replaced, at 100k entries.  Exits non-zero if the columns do not take
+// less than half the memory of the rows.
+//
+// The history is shaped like a wallet that receives and spends in turn.
+// Every incoming tx adds one output row.  Every outgoing tx adds two ring
+// rows spending earlier outputs, one row per recipient, and a change row.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "wallet/tx_history.h"
+
+namespace {
+
+using monero::TxHistory;
+using monero::TxHistoryPage;
+using monero::TxHistoryQuery;
+using monero::TxInfo;
+
+constexpr size_t kEntries = 100000;
+constexpr size_t kRecipients = 16;
+
+template<typename T>
+T Key(uint64_t n, uint8_t tag) {
+  T key;
+  memset(&key, 0, sizeof(key));
+  memcpy(&key, &n, sizeof(n));
+  reinterpret_cast<uint8_t*>(&key)[sizeof(key) - 1] = tag;
+  return key;
+}
+
+std::vector<TxInfo> MakeRows() {
+  std::vector<std::string> recipients;
+  for (size_t i = 0; i < kRecipients; ++i) {
+    // Standard addresses are 95 characters.
+    recipients.push_back("4" + std::string(94, static_cast<char>('A' + i)));
+  }
+  std::vector<TxInfo> rows;
+  std::vector<crypto::key_image> unspent;
+  uint64_t height = 3000000;
+  uint64_t tx_id = 0;
+  uint64_t output_id = 0;
+  auto add_output = [&](const crypto::hash& tx_hash, uint64_t amount, uint64_t fee) {
+    TxInfo recv(tx_hash, TxInfo::INCOMING);
+    recv.m_public_key = Key<crypto::public_key>(output_id, 1);
+    recv.m_public_key_known = true;
+    recv.m_key_image = Key<crypto::key_image>(output_id, 2);
+    recv.m_key_image_known = true;
+    recv.m_subaddress_major = output_id % 3;
+    recv.m_subaddress_minor = output_id % 5;
+    recv.m_amount = amount;
+    recv.m_height = height;
+    recv.m_timestamp = 1600000000 + height * 120;
+    recv.m_fee = fee;
+    recv.m_state = TxInfo::ON_CHAIN;
+    rows.push_back(recv);
+    unspent.push_back(recv.m_key_image);
+    ++output_id;
+  };
+  while (rows.size() < kEntries) {
+    add_output(Key<crypto::hash>(tx_id++, 0), 1000000000 + tx_id, 30000000);
+    height += 7;
+
+    const crypto::hash tx_hash = Key<crypto::hash>(tx_id++, 0);
+    for (int i = 0; i < 2 && !unspent.empty(); ++i) {
+      TxInfo spent(tx_hash, TxInfo::OUTGOING);
+      spent.m_key_image = unspent.back();
+      spent.m_key_image_known = true;
+      spent.m_height = height;
+      spent.m_timestamp = 1600000000 + height * 120;
+      spent.m_fee = 30000000;
+      spent.m_change = 400000000;
+      spent.m_state = TxInfo::ON_CHAIN;
+      rows.push_back(spent);
+      unspent.pop_back();
+    }
+    TxInfo dest(tx_hash, TxInfo::OUTGOING);
+    dest.m_recipient = recipients[tx_id % kRecipients];
+    dest.m_amount = 600000000;
+    dest.m_height = height;
+    dest.m_timestamp = 1600000000 + height * 120;
+    dest.m_fee = 30000000;
+    dest.m_change = 400000000;
+    dest.m_state = TxInfo::ON_CHAIN;
+    rows.push_back(dest);
+    add_output(tx_hash, 400000000, 30000000);
+    height += 11;
+  }
+  rows.erase(rows.begin() + kEntries, rows.end());
+  // Best case for the rows: no spare capacity.
+  rows.shrink_to_fit();
+  return rows;
+}
+
+size_t RowBytes(const std::vector<TxInfo>& rows) {
+  size_t bytes = rows.capacity() * sizeof(TxInfo);
+  for (const TxInfo& row: rows) {
+    if (row.m_recipient.capacity() > sizeof(std::string)) {
+      bytes += row.m_recipient.capacity() + 1;
+    }
+  }
+  return bytes;
+}
+
+double MillisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<TxInfo> rows = MakeRows();
+
+  auto start = std::chrono::steady_clock::now();
+  TxHistory history;
+  history.reserve(rows.size());
+  for (const TxInfo& row: rows) {
+    history.append(row);
+  }
+  history.seal();
+  const double build_ms = MillisSince(start);
+
+  start = std::chrono::steady_clock::now();
+  uint64_t account_balance = 0;
+  const auto& amounts = history.amounts();
+  for (size_t i = 0; i < history.size(); ++i) {
+    if (history.subaddress_major(i) == 1 && history.type(i) == TxInfo::INCOMING) {
+      account_balance += amounts[i];
+    }
+  }
+  const double scan_ms = MillisSince(start);
+
+  TxHistoryQuery query;
+  query.account = 1;
+  TxHistoryPage page;
+  history.query(query, monero::kTxHistoryCursorStart, 50, &page);
+
+  const size_t row_bytes = RowBytes(rows);
+  const size_t column_bytes = history.memory_usage();
+  printf("entries: %zu\n", history.size());
+  printf("std::vector<TxInfo>: %zu bytes, %.1f per entry\n",
+         row_bytes, static_cast<double>(row_bytes) / rows.size());
+  printf("TxHistory: %zu bytes, %.1f per entry (%.0f%% of rows)\n",
+         column_bytes, static_cast<double>(column_bytes) / history.size(),
+         100.0 * column_bytes / row_bytes);
+  printf("build and seal: %.1f ms, account scan: %.2f ms (balance %llu, page %zu)\n",
+         build_ms, scan_ms, static_cast<unsigned long long>(account_balance),
+         page.rows.size());
+
+  return column_bytes * 2 < row_bytes ? 0 : 1;
+}
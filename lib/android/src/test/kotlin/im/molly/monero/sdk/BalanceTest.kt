@@ -26,6 +26,17 @@ class BalanceTest {
         assertThat(balance.totalAmount).isEqualTo(6.xmr)
     }
 
+    @Test
+    fun `sum of balances keeps every time-locked value`() {
+        val current = BlockchainTime(100, Instant.now(), Mainnet)
+        val sum = Balance(listOf(2.xmr.unlocked()), pendingAmount = 1.xmr) +
+                Balance(listOf(TimeLocked(3.xmr, Mainnet.unlockAtBlock(150))))
+
+        assertThat(sum.totalAmount).isEqualTo(6.xmr)
+        assertThat(sum.pendingAmount).isEqualTo(1.xmr)
+        assertThat(sum.unlockedAmountAt(current)).isEqualTo(2.xmr)
+    }
+
     @Test
     fun `empty balance returns zero amounts`() {
         assertThat(Balance.EMPTY.totalAmount).isEqualTo(0.xmr)
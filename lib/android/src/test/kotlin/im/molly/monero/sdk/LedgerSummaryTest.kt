@@ -0,0 +1,97 @@
+package im.molly.monero.sdk
+
+import com.google.common.truth.Truth.assertThat
+import java.io.ByteArrayInputStream
+import java.io.ByteArrayOutputStream
+import kotlin.test.Test
+
+class LedgerSummaryTest {
+
+    private val address =
+        "44Kbx4sJ7JDRDV5aAhLJzQCjDz2ViLRduE3ijDZu3osWKBjMGkV1XPk4pfDUMqt1Aiezvephdqm6YD19GKFD9ZcXVUTp6BW"
+
+    private val txId = ByteArray(32) { it.toByte() }
+
+    private fun ByteArrayOutputStream.varint(value: Long) {
+        var v = value
+        while (v >= 0x80) {
+            write(((v and 0x7f) or 0x80).toInt())
+            v = v ushr 7
+        }
+        write(v.toInt())
+    }
+
+    private fun ByteArrayOutputStream.bytesField(field: Int, bytes: ByteArray) {
+        varint((field shl 3 or 2).toLong())
+        varint(bytes.size.toLong())
+        write(bytes)
+    }
+
+    private fun ByteArrayOutputStream.varintField(field: Int, value: Long) {
+        varint((field shl 3).toLong())
+        varint(value)
+    }
+
+    private fun ownedTxOut(amount: Long, height: Long, spentHeight: Long, spentInPool: Boolean = false) =
+        ByteArrayOutputStream().apply {
+            bytesField(1, txId)
+            varintField(2, amount)
+            varintField(3, height)
+            if (spentHeight != 0L) varintField(4, spentHeight)
+            if (spentInPool) varintField(5, 1)
+        }.toByteArray()
+
+    private fun savedWalletData(): ByteArray {
+        val proto = ByteArrayOutputStream().apply {
+            bytesField(1, address.toByteArray())
+            varintField(2, 3_100_000)
+            bytesField(3, ownedTxOut(1_000_000_000_000, 3_000_000, 0))
+            bytesField(3, ownedTxOut(250_000_000_000, 3_000_100, 3_050_000))
+            bytesField(3, ownedTxOut(50_000_000_000, 3_000_200, 0, spentInPool = true))
+            // Unknown fields are skipped.
+            varintField(15, 42)
+        }.toByteArray()
+        return ByteArrayOutputStream().apply {
+            write(byteArrayOf(0xff.toByte(), 'L'.code.toByte(), 'G'.code.toByte(), 'R'.code.toByte()))
+            write(byteArrayOf(proto.size.toByte(), (proto.size shr 8).toByte(), 0, 0))
+            write(proto)
+            // Start of the wallet archive.
+            write(byteArrayOf(0, 1, 2, 3))
+        }.toByteArray()
+    }
+
+    @Test
+    fun `reads summary header and stops at the wallet archive`() {
+        val input = ByteArrayInputStream(savedWalletData())
+        val summary = LedgerSummary.readFrom(input)!!
+
+        assertThat(summary.publicAddress).isEqualTo(PublicAddress.parse(address))
+        assertThat(summary.blockHeight).isEqualTo(3_100_000)
+        assertThat(summary.ownedTxOuts).hasSize(3)
+        assertThat(summary.ownedTxOuts[0].txId).isEqualTo(HashDigest(txId))
+        assertThat(summary.ownedTxOuts[0].isSpent).isFalse()
+        assertThat(summary.ownedTxOuts[1].spentHeight).isEqualTo(3_050_000)
+        assertThat(summary.ownedTxOuts[2].spentHeight).isNull()
+        assertThat(summary.ownedTxOuts[2].isSpent).isTrue()
+        assertThat(summary.unspentAmount).isEqualTo(MoneroAmount(1_000_000_000_000))
+        assertThat(input.readBytes()).isEqualTo(byteArrayOf(0, 1, 2, 3))
+    }
+
+    @Test
+    fun `returns null for data saved without a summary`() {
+        val input = ByteArrayInputStream(byteArrayOf(0, 1, 2, 3, 4, 5, 6, 7, 8))
+
+        assertThat(LedgerSummary.readFrom(input)).isNull()
+    }
+
+    @Test
+    fun `returns null for a summary size out of bounds`() {
+        for (sizeLe in listOf(byteArrayOf(0, 0, 0, 0x40), byteArrayOf(0, 0, 0, 0x80.toByte()))) {
+            val input = ByteArrayInputStream(
+                byteArrayOf(0xff.toByte(), 'L'.code.toByte(), 'G'.code.toByte(), 'R'.code.toByte()) + sizeLe
+            )
+
+            assertThat(LedgerSummary.readFrom(input)).isNull()
+        }
+    }
+}
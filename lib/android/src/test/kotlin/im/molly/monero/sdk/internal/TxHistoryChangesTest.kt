@@ -0,0 +1,52 @@
+package im.molly.monero.sdk.internal
+
+import com.google.common.truth.Truth.assertThat
+import org.junit.Test
+
+class TxHistoryChangesTest {
+
+    private fun txInfo(id: Int, height: Int) = TxInfo(
+        txHash = "%064x".format(id),
+        publicKey = null,
+        keyImage = null,
+        subAddressMajor = 0,
+        subAddressMinor = 0,
+        recipient = null,
+        amount = 1000L * id,
+        height = height,
+        unlockTime = 0,
+        timestamp = 0,
+        fee = 0,
+        change = 0,
+        state = if (height != 0) TxInfo.STATE_ON_CHAIN else TxInfo.STATE_PENDING,
+        coinbase = false,
+        incoming = true,
+    )
+
+    private val history = listOf(txInfo(1, 10), txInfo(2, 20), txInfo(3, 20), txInfo(4, 0))
+
+    @Test
+    fun `changes from a height replace entries at and above it`() {
+        val changes = listOf(txInfo(5, 20), txInfo(6, 30))
+
+        assertThat(history.replaceFrom(20, changes))
+            .containsExactly(txInfo(1, 10), txInfo(5, 20), txInfo(6, 30))
+            .inOrder()
+    }
+
+    @Test
+    fun `changes of unconfirmed entries keep every confirmed one`() {
+        val changes = listOf(txInfo(7, 0))
+
+        assertThat(history.replaceFrom(Long.MAX_VALUE, changes))
+            .containsExactly(txInfo(1, 10), txInfo(2, 20), txInfo(3, 20), txInfo(7, 0))
+            .inOrder()
+    }
+
+    @Test
+    fun `changes from height zero replace the whole history`() {
+        val changes = listOf(txInfo(8, 5))
+
+        assertThat(history.replaceFrom(0, changes)).containsExactly(txInfo(8, 5))
+    }
+}
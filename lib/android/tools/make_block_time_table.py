@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Writes the block time table bundled in the library assets for a network.
+
+Reads the timestamp of every 720th block from a monerod JSON-RPC endpoint and
+writes them in the MBTT format read by BlockTimeTable (block_time_table.h):
+
+  magic[4] "MBTT" | version u16 | nettype u16 | interval u32 | count u32
+  first_height u64 | base_timestamp u64 | deltas u32[count]
+
+Run it against a node you trust, e.g.:
+
+  make_block_time_table.py --network mainnet --node http://127.0.0.1:18081 \\
+      src/main/assets/block_times/mainnet.mbtt
+"""
+
+import argparse
+import json
+import struct
+import sys
+import urllib.request
+
+SAMPLE_INTERVAL = 720
+NETWORKS = {"mainnet": 0, "testnet": 1, "stagenet": 2}
+BATCH_SIZE = 100
+
+
+def rpc(node, method, params):
+    body = json.dumps({"jsonrpc": "2.0", "id": "0", "method": method, "params": params})
+    request = urllib.request.Request(node + "/json_rpc", body.encode(),
+                                     {"Content-Type": "application/json"})
+    with urllib.request.urlopen(request, timeout=60) as response:
+        reply = json.load(response)
+    if "error" in reply:
+        raise RuntimeError(f"{method}: {reply['error']}")
+    return reply["result"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--network", choices=NETWORKS, required=True)
+    parser.add_argument("--node", required=True, help="monerod RPC URL")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    info = rpc(args.node, "get_info", {})
+    if info["nettype"] != args.network:
+        sys.exit(f"Node is on {info['nettype']}, not {args.network}")
+    # Leave the last hours out; they may still be reorganized.
+    top = info["height"] - SAMPLE_INTERVAL // 10
+    heights = list(range(0, top, SAMPLE_INTERVAL))
+
+    timestamps = []
+    for i in range(0, len(heights), BATCH_SIZE):
+        batch = heights[i:i + BATCH_SIZE]
+        result = rpc(args.node, "get_block_header_by_height", {"heights": batch})
+        if "block_headers" in result:
+            headers = result["block_headers"]
+        else:
+            # Older nodes take one height per call.
+            headers = [rpc(args.node, "get_block_header_by_height", {"height": height})
+                       ["block_header"] for height in batch]
+        timestamps += [header["timestamp"] for header in headers]
+        print(f"{len(timestamps)}/{len(heights)}", end="\r", file=sys.stderr)
+
+    # Block timestamps are not strictly increasing; keep the series monotonic
+    # so that it can be binary searched, as BlockTimeTable::writeTo() does.
+    base = timestamps[0]
+    deltas = []
+    latest = base
+    for ts in timestamps:
+        latest = max(latest, ts)
+        deltas.append(latest - base)
+
+    with open(args.output, "wb") as output:
+        output.write(struct.pack("<4sHHIIQQ", b"MBTT", 1, NETWORKS[args.network],
+                                 SAMPLE_INTERVAL, len(deltas), 0, base))
+        output.write(struct.pack(f"<{len(deltas)}I", *deltas))
+    print(f"Wrote {len(deltas)} samples up to height {heights[-1]}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()